@@ -60,5 +60,34 @@ namespace WAVM { namespace IR {
 			extendedNamesSection = enableWAVMFeatures;
 			customSectionsInTextFormat = enableWAVMFeatures;
 		}
+
+		friend bool operator==(const FeatureSpec& left, const FeatureSpec& right)
+		{
+			return left.importExportMutableGlobals == right.importExportMutableGlobals
+				   && left.nonTrappingFloatToInt == right.nonTrappingFloatToInt
+				   && left.extendedSignExtension == right.extendedSignExtension
+				   && left.bulkMemoryOperations == right.bulkMemoryOperations
+				   && left.simd == right.simd && left.atomics == right.atomics
+				   && left.exceptionHandling == right.exceptionHandling
+				   && left.multipleResultsAndBlockParams == right.multipleResultsAndBlockParams
+				   && left.referenceTypes == right.referenceTypes
+				   && left.extendedNamesSection == right.extendedNamesSection
+				   && left.multipleMemories == right.multipleMemories
+				   && left.sharedTables == right.sharedTables
+				   && left.requireSharedFlagForAtomicOperators
+						  == right.requireSharedFlagForAtomicOperators
+				   && left.allowLegacyInstructionNames == right.allowLegacyInstructionNames
+				   && left.allowAnyExternKindElemSegments == right.allowAnyExternKindElemSegments
+				   && left.quotedNamesInTextFormat == right.quotedNamesInTextFormat
+				   && left.customSectionsInTextFormat == right.customSectionsInTextFormat
+				   && left.maxLocals == right.maxLocals
+				   && left.maxLabelsPerFunction == right.maxLabelsPerFunction
+				   && left.maxDataSegments == right.maxDataSegments
+				   && left.maxSyntaxRecursion == right.maxSyntaxRecursion;
+		}
+		friend bool operator!=(const FeatureSpec& left, const FeatureSpec& right)
+		{
+			return !(left == right);
+		}
 	};
 }}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <string.h>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+
+namespace WAVM {
+
+	// The BLAKE2b cryptographic hash function, as specified by RFC 7693, without a key. Bytes may
+	// be added incrementally, and the state may be copied to hash several sequences of bytes that
+	// share a prefix.
+	struct BLAKE2b
+	{
+		static constexpr Uptr maxDigestBytes = 64;
+
+		BLAKE2b(Uptr inNumDigestBytes = maxDigestBytes) : numDigestBytes(inNumDigestBytes)
+		{
+			WAVM_ASSERT(numDigestBytes > 0 && numDigestBytes <= maxDigestBytes);
+			for(Uptr index = 0; index < 8; ++index) { state[index] = getIV(index); }
+
+			// Mix the parameter block into the state: the digest length, no key, and a fanout and
+			// depth of 1 for sequential hashing.
+			state[0] ^= 0x01010000 ^ U64(numDigestBytes);
+		}
+
+		void add(const void* data, Uptr numBytes)
+		{
+			const U8* bytes = (const U8*)data;
+			while(numBytes)
+			{
+				// The last block must be compressed with the final block flag, so a full buffered
+				// block is only compressed once there are more bytes to add after it.
+				if(numBufferedBytes == numBlockBytes)
+				{
+					compress(numBlockBytes, false);
+					numBufferedBytes = 0;
+				}
+
+				Uptr numCopiedBytes = numBlockBytes - numBufferedBytes;
+				if(numCopiedBytes > numBytes) { numCopiedBytes = numBytes; }
+				memcpy(buffer + numBufferedBytes, bytes, numCopiedBytes);
+				numBufferedBytes += numCopiedBytes;
+				bytes += numCopiedBytes;
+				numBytes -= numCopiedBytes;
+			}
+		}
+
+		// Writes the digest of the bytes added so far to outDigest, which must have room for the
+		// number of digest bytes passed to the constructor. More bytes may be added afterwards.
+		void getDigest(U8* outDigest) const
+		{
+			BLAKE2b finalState = *this;
+			memset(finalState.buffer + numBufferedBytes, 0, numBlockBytes - numBufferedBytes);
+			finalState.compress(numBufferedBytes, true);
+			for(Uptr byteIndex = 0; byteIndex < numDigestBytes; ++byteIndex)
+			{ outDigest[byteIndex] = U8(finalState.state[byteIndex / 8] >> (byteIndex % 8 * 8)); }
+		}
+
+	private:
+		static constexpr Uptr numBlockBytes = 128;
+
+		U64 state[8];
+		U64 numCompressedBytes[2] = {0, 0};
+		U8 buffer[numBlockBytes];
+		Uptr numBufferedBytes = 0;
+		Uptr numDigestBytes;
+
+		static U64 getIV(Uptr index)
+		{
+			static constexpr U64 iv[8] = {0x6a09e667f3bcc908,
+										  0xbb67ae8584caa73b,
+										  0x3c6ef372fe94f82b,
+										  0xa54ff53a5f1d36f1,
+										  0x510e527fade682d1,
+										  0x9b05688c2b3e6c1f,
+										  0x1f83d9abfb41bd6b,
+										  0x5be0cd19137e2179};
+			return iv[index];
+		}
+
+		static U64 rotateRight(U64 value, Uptr numBits)
+		{
+			return (value >> numBits) | (value << (64 - numBits));
+		}
+
+		static void mix(U64* v, Uptr a, Uptr b, Uptr c, Uptr d, U64 x, U64 y)
+		{
+			v[a] = v[a] + v[b] + x;
+			v[d] = rotateRight(v[d] ^ v[a], 32);
+			v[c] = v[c] + v[d];
+			v[b] = rotateRight(v[b] ^ v[c], 24);
+			v[a] = v[a] + v[b] + y;
+			v[d] = rotateRight(v[d] ^ v[a], 16);
+			v[c] = v[c] + v[d];
+			v[b] = rotateRight(v[b] ^ v[c], 63);
+		}
+
+		// Compresses the buffered block, which contains numNewBytes bytes that weren't counted
+		// yet, followed by zero padding if it is the last block.
+		void compress(Uptr numNewBytes, bool isLastBlock)
+		{
+			static constexpr U8 sigma[12][16]
+				= {{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+				   {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+				   {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+				   {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+				   {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+				   {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+				   {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+				   {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+				   {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+				   {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+				   {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+				   {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}};
+
+			numCompressedBytes[0] += numNewBytes;
+			if(numCompressedBytes[0] < numNewBytes) { ++numCompressedBytes[1]; }
+
+			// The message words are little-endian.
+			U64 m[16];
+			for(Uptr wordIndex = 0; wordIndex < 16; ++wordIndex)
+			{
+				m[wordIndex] = 0;
+				for(Uptr byteIndex = 0; byteIndex < 8; ++byteIndex)
+				{ m[wordIndex] |= U64(buffer[wordIndex * 8 + byteIndex]) << (byteIndex * 8); }
+			}
+
+			U64 v[16];
+			for(Uptr index = 0; index < 8; ++index)
+			{
+				v[index] = state[index];
+				v[index + 8] = getIV(index);
+			}
+			v[12] ^= numCompressedBytes[0];
+			v[13] ^= numCompressedBytes[1];
+			if(isLastBlock) { v[14] = ~v[14]; }
+
+			for(Uptr round = 0; round < 12; ++round)
+			{
+				const U8* s = sigma[round];
+				mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+				mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+				mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+				mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+				mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+				mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+				mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+				mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+			}
+
+			for(Uptr index = 0; index < 8; ++index) { state[index] ^= v[index] ^ v[index + 8]; }
+		}
+	};
+}
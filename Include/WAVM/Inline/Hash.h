@@ -4,6 +4,7 @@
 #include <string>
 #include <type_traits>
 #include <vector>
+#include "BLAKE2b.h"
 #include "BasicTypes.h"
 
 #if defined(__GNUC__)
@@ -123,6 +124,60 @@ namespace WAVM {
 		}
 	};
 
+	// A 128-bit hash, for identifying data by its hash without comparing the data itself.
+	struct Hash128
+	{
+		U64 low;
+		U64 high;
+
+		friend bool operator==(const Hash128& left, const Hash128& right)
+		{
+			return left.low == right.low && left.high == right.high;
+		}
+		friend bool operator!=(const Hash128& left, const Hash128& right)
+		{
+			return !(left == right);
+		}
+	};
+
+	template<> struct Hash<Hash128>
+	{
+		Uptr operator()(const Hash128& hash, Uptr seed = 0) const
+		{
+			return Uptr(XXH64_fixed(hash.high, XXH64_fixed(hash.low, U64(seed))));
+		}
+	};
+
+	// Computes a Hash128 of bytes that are added incrementally, so data can be hashed as it is
+	// produced without being buffered. The hash is a 128-bit BLAKE2b digest, so it is impractical
+	// to find two sequences of bytes with the same hash, even for whoever chooses the bytes. That
+	// makes it suitable for identifying data that may come from an attacker, such as WebAssembly
+	// modules submitted for compilation. The state may be copied to hash several sequences of
+	// bytes that share a prefix.
+	struct StreamingHash128
+	{
+		StreamingHash128() : state(sizeof(Hash128)) {}
+
+		void add(const void* data, Uptr numBytes) { state.add(data, numBytes); }
+
+		Hash128 getHash() const
+		{
+			U8 digest[sizeof(Hash128)];
+			state.getDigest(digest);
+
+			Hash128 hash{0, 0};
+			for(Uptr byteIndex = 0; byteIndex < 8; ++byteIndex)
+			{
+				hash.low |= U64(digest[byteIndex]) << (byteIndex * 8);
+				hash.high |= U64(digest[byteIndex + 8]) << (byteIndex * 8);
+			}
+			return hash;
+		}
+
+	private:
+		BLAKE2b state;
+	};
+
 	template<typename Key> struct DefaultHashPolicy
 	{
 		static bool areKeysEqual(const Key& left, const Key& right) { return left == right; }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -54,15 +55,88 @@ namespace WAVM { namespace LLVMJIT {
 
 	WAVM_API Version getVersion();
 
+	enum class CompileTier
+	{
+		// Compile with the full optimization pipeline.
+		optimized,
+
+		// Compile as quickly as possible: skip the LLVM IR optimization passes, and generate
+		// machine code without optimization. Baseline-tier code counts how often each function is
+		// executed, and forwards calls to a function to its optimized-tier code once that has been
+		// loaded by loadTierUpCode.
+		baseline,
+	};
+
+	// Options that control how a module is compiled to object code.
+	struct CompileOptions
+	{
+		// The maximum number of threads to use to compile a module. If greater than 1, the
+		// module's function definitions are split into partitions that are emitted, optimized, and
+		// compiled concurrently, each to a separate object file.
+		Uptr numThreads = 1;
+
+		// The tier to compile the module's functions at.
+		CompileTier tier = CompileTier::optimized;
+
+		// The number of calls and loop iterations after which a baseline-tier function is
+		// recompiled at the optimized tier.
+		U64 tierUpHotnessThreshold = 10000;
+
+		// If true, the compiled code deterministically meters the WebAssembly operators it
+		// executes: each operator costs one unit of fuel, and the total cost of the operators in
+		// each basic block is subtracted from ContextRuntimeData::fuel before the block runs. The
+		// code calls out to the runtime when the fuel is exhausted.
+		bool meterFuel = false;
+
+		// If true, the compiled code checks at each function entry and loop header whether the
+		// current epoch has reached the epoch deadline of the context it is running in, and calls
+		// out to the runtime to interrupt it if so. See Runtime::setContextEpochDeadline.
+		bool checkEpochDeadlines = false;
+	};
+
 	// Compile a module to object code with the host target spec.
 	// Cannot fail if validateTarget(targetSpec, irModule.featureSpec) == valid.
 	WAVM_API std::vector<U8> compileModule(const IR::Module& irModule,
-										   const TargetSpec& targetSpec);
+										   const TargetSpec& targetSpec,
+										   const CompileOptions& options = CompileOptions());
+
+	// Compiles the function definitions in [beginFunctionDefIndex, endFunctionDefIndex) to an
+	// object file. The module's other function definitions are declared as external functions,
+	// and their bodies aren't used, so they don't need to have been loaded yet.
+	WAVM_API std::vector<U8> compileModulePartition(const IR::Module& irModule,
+													const TargetSpec& targetSpec,
+													Uptr beginFunctionDefIndex,
+													Uptr endFunctionDefIndex,
+													CompileTier tier = CompileTier::optimized,
+													bool meterFuel = false,
+													bool checkEpochDeadlines = false);
+
+	// A reference to the bytes of an object file.
+	struct ObjectFileBytes
+	{
+		const U8* bytes;
+		Uptr numBytes;
+	};
+
+	// Combines the object files compiled by compileModulePartition for contiguous partitions that
+	// cover all of a module's function definitions into object code for the module.
+	WAVM_API std::vector<U8> linkModulePartitions(
+		const std::vector<ObjectFileBytes>& partitionObjectFiles);
 
 	WAVM_API std::string emitLLVMIR(const IR::Module& irModule,
 									const TargetSpec& targetSpec,
 									bool optimize);
 
+	// Compiles a single function definition of a module at the optimized tier, to object code that
+	// may be loaded by loadTierUpCode into an instance of the module compiled at the baseline tier.
+	// meterFuel and checkEpochDeadlines must match the CompileOptions the baseline-tier code was
+	// compiled with.
+	WAVM_API std::vector<U8> compileTierUpFunction(const IR::Module& irModule,
+												   const TargetSpec& targetSpec,
+												   Uptr functionDefIndex,
+												   bool meterFuel = false,
+												   bool checkEpochDeadlines = false);
+
 	// An opaque type that can be used to reference a loaded JIT module.
 	struct Module;
 
@@ -105,9 +179,21 @@ namespace WAVM { namespace LLVMJIT {
 		Uptr id;
 	};
 
+	// Information about object code that doesn't depend on the bindings it is loaded with: the
+	// functions defined by each object file, and the map from each function's code offsets to
+	// WebAssembly op indices. The first loadModule call that is passed an ObjectCodeInfo fills it
+	// in, and later calls that load the same object code reuse it instead of parsing the object's
+	// symbols and debug info again. Only this metadata is shared: each loadModule call still maps
+	// its own relocated copy of the code, since the Runtime::Function objects that identify the
+	// loaded functions are emitted in front of their code, and are specific to each instance.
+	struct ObjectCodeInfo;
+	WAVM_API std::shared_ptr<ObjectCodeInfo> createObjectCodeInfo();
+
 	// Loads a module from object code, and binds its undefined symbols to the provided bindings.
+	// The object code is only read during the call, so it may be e.g. memory-mapped by the caller.
 	WAVM_API std::shared_ptr<Module> loadModule(
-		const std::vector<U8>& objectFileBytes,
+		const U8* objectBytes,
+		Uptr numObjectBytes,
 		HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
 		std::vector<IR::FunctionType>&& types,
 		std::vector<FunctionBinding>&& functionImports,
@@ -117,7 +203,23 @@ namespace WAVM { namespace LLVMJIT {
 		std::vector<ExceptionTypeBinding>&& exceptionTypes,
 		ModuleInstanceBinding moduleInstance,
 		Uptr tableReferenceBias,
-		const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas);
+		Uptr uninitializedTableElement,
+		Uptr epochAddress,
+		const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas,
+		ObjectCodeInfo* objectCodeInfo = nullptr);
+
+	// Returns the number of bytes of memory committed for a module's loaded code and data sections,
+	// not including tier-up code loaded into it by loadTierUpCode.
+	WAVM_API Uptr getNumLoadedBytes(const Module* jitModule);
+
+	// Loads object code produced by compileTierUpFunction into a module that was compiled at the
+	// baseline tier, and redirects calls to the baseline-tier function to the optimized code. The
+	// optimized code is unloaded with the baseline-tier module. Before redirecting any calls,
+	// chargeLoadedBytes is called with the number of bytes committed for the loaded code; if it
+	// returns false, the code is unloaded, and loadTierUpCode returns false.
+	WAVM_API bool loadTierUpCode(Module* jitModule,
+								 const std::vector<U8>& objectCode,
+								 const std::function<bool(Uptr numLoadedBytes)>& chargeLoadedBytes);
 
 	struct InstructionSource
 	{
@@ -125,10 +227,58 @@ namespace WAVM { namespace LLVMJIT {
 		Uptr instructionIndex;
 	};
 
+	// Keeps JIT modules from being unloaded while it exists: unloading a module waits for the
+	// guards that were created before the module was unloaded to be destroyed. It doesn't lock, so
+	// creating one doesn't contend with loading and unloading modules. A thread must not unload a
+	// module while it holds a guard.
+	struct GlobalModuleState;
+	struct ModuleUnloadGuard
+	{
+		WAVM_API ModuleUnloadGuard();
+		WAVM_API ~ModuleUnloadGuard();
+
+		ModuleUnloadGuard(const ModuleUnloadGuard&) = delete;
+		ModuleUnloadGuard& operator=(const ModuleUnloadGuard&) = delete;
+
+	private:
+		std::shared_ptr<GlobalModuleState> globalModuleState;
+		Uptr readerSlotIndex;
+	};
+
 	// Finds the JIT function and instruction index at the given address. If no JIT function
-	// contains the given address, returns an InstructionSourceInfo with function==nullptr.
+	// contains the given address, returns an InstructionSourceInfo with function==nullptr. The
+	// function, and its FunctionMutableData, may only be used while the caller holds a
+	// ModuleUnloadGuard that was created before the lookup.
 	WAVM_API bool getInstructionSourceByAddress(Uptr address, InstructionSource& outSource);
 
+	// Returns a number that identifies the loaded JIT module that contains the given address, or 0
+	// if no loaded JIT module contains it. Each module is given a different number when it is
+	// loaded, so a sampling profiler can record the number for each of a sample's addresses, and
+	// check that the address is still in the same module when it is looked up under a
+	// ModuleUnloadGuard. It doesn't lock, and may be called from a signal handler.
+	WAVM_API U64 getModuleLoadNumberByAddress(Uptr address);
+
+	// Formats of the files that Linux perf reads to attribute samples in JIT code to functions.
+	enum class PerfMapFormat
+	{
+		// /tmp/perf-<pid>.map: the name and address range of each loaded function. perf reads the
+		// file after the samples are recorded, so functions aren't removed from it when they are
+		// unloaded.
+		perfMap,
+
+		// /tmp/jit-<pid>.dump: a timestamped record of each loaded function's name, address range,
+		// and code, and of the WebAssembly op index each range of its code was generated for.
+		// `perf inject --jit` uses the timestamps to attribute each sample to the code that was
+		// loaded at its address when it was taken, so unloaded code and code later loaded at the
+		// same address are told apart. The samples must be recorded with `perf record -k mono`.
+		jitdump,
+	};
+
+	// Writes the functions in modules that are loaded after this call to a file in the given
+	// format. Returns false if the file couldn't be created, or the format isn't supported on this
+	// platform.
+	WAVM_API bool enablePerfMap(PerfMapFormat format);
+
 	// Generates an invoke thunk for a specific function type.
 	WAVM_API Runtime::InvokeThunkPointer getInvokeThunk(IR::FunctionType functionType);
 
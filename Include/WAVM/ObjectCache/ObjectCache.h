@@ -19,6 +19,11 @@ namespace WAVM { namespace ObjectCache {
 		tooManyReaders,
 	};
 
+	// Opens an object cache database. Large cached objects are returned without copying them out
+	// of the database's memory map, which keeps a read transaction open until the returned object
+	// code is released. The database allows 1024 concurrent read transactions, shared by all the
+	// processes that use it. At most half of them are held by the object code returned by each
+	// opened cache, and large objects are copied while that many are held.
 	WAVM_API OpenResult open(const char* path,
 							 Uptr maxBytes,
 							 U64 codeKey,
@@ -47,9 +47,16 @@ namespace WAVM { namespace Platform {
 		}
 	};
 
-	// Captures the execution context of the caller.
-	WAVM_API CallStack captureCallStack(Uptr numOmittedFramesFromTop = 0);
+	// Captures the execution context of the caller. Unwinding stops once maxFrames frames have been
+	// captured, so a smaller maxFrames makes the capture cheaper, and 0 skips it entirely.
+	WAVM_API CallStack captureCallStack(Uptr numOmittedFramesFromTop = 0,
+										Uptr maxFrames = CallStack::maxFrames);
 
 	// Looks up the source of an instruction from a native module.
 	WAVM_API bool getInstructionSourceByAddress(Uptr ip, InstructionSource& outSource);
+
+	// Looks up the address of the native function that contains an instruction, or of the module
+	// that contains it if it isn't in a named function. This is cheaper than
+	// getInstructionSourceByAddress, since it doesn't need the function's name.
+	WAVM_API bool getFunctionAddressByInstructionAddress(Uptr ip, Uptr& outFunctionAddress);
 }}
@@ -18,7 +18,9 @@ namespace WAVM { namespace Platform {
 		void operator=(Event&&) = delete;
 
 		// Wait for the event to be signaled. Cancels the wait after waitDuration has elapsed.
-		// Returns true if the event was signaled, false if the wait was cancelled.
+		// Returns true if the event was signaled, false if the wait was cancelled. The event is
+		// reset when a wait returns true, and a signal with no thread waiting is kept until the
+		// next wait.
 		WAVM_API bool wait(Time waitDuration);
 		WAVM_API void signal();
 
@@ -63,6 +65,11 @@ namespace WAVM { namespace Platform {
 		} pthreadCond;
 #else
 #error unsupported platform
+#endif
+
+#ifndef WIN32
+		// Protected by pthreadMutex.
+		bool isSignaled;
 #endif
 	};
 }}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	// Returns true if the platform supports futexWait and futexWake.
+	WAVM_API bool isFutexSupported();
+
+	enum class FutexWaitResult
+	{
+		woken,
+		valueMismatch,
+		timedOut,
+		accessViolation
+	};
+
+	// If the 32-bit value at address equals expectedValue, blocks the calling thread until another
+	// thread calls futexWake for the same address, or until waitDuration has elapsed. The value is
+	// compared and the thread is queued atomically with respect to futexWake.
+	WAVM_API FutexWaitResult futexWait(U32* address, U32 expectedValue, Time waitDuration);
+
+	// Wakes up to numToWake threads that are blocked in futexWait for address, and returns the
+	// number of threads that were woken.
+	WAVM_API Uptr futexWake(U32* address, Uptr numToWake);
+}}
@@ -48,6 +48,12 @@ namespace WAVM { namespace Platform {
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	WAVM_API void decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages);
 
+	// Decommits the physical memory that was committed to the specified virtual pages, and makes
+	// them inaccessible, without replacing their mapping. This is cheaper than
+	// decommitVirtualPages, but a copy-on-write mapping of an image is only reset to the image's
+	// contents. baseVirtualAddress must be a multiple of the preferred page size.
+	WAVM_API void discardVirtualPages(U8* baseVirtualAddress, Uptr numPages);
+
 	// Frees virtual addresses. baseVirtualAddress must also be the address returned by
 	// allocateVirtualPages.
 	WAVM_API void freeVirtualPages(U8* baseVirtualAddress, Uptr numPages);
@@ -59,6 +65,27 @@ namespace WAVM { namespace Platform {
 										  Uptr numPages,
 										  Uptr alignmentLog2);
 
+	// An anonymous in-memory file that may be mapped copy-on-write into the address space.
+	struct CopyOnWriteImage;
+
+	// Creates a copy-on-write image that contains a copy of the specified virtual pages.
+	// Returns nullptr if the platform doesn't support copy-on-write images.
+	WAVM_API CopyOnWriteImage* createCopyOnWriteImage(const U8* baseVirtualAddress, Uptr numPages);
+
+	// Destroys a copy-on-write image. Existing mappings of the image remain valid.
+	WAVM_API void destroyCopyOnWriteImage(CopyOnWriteImage* image);
+
+	// Replaces the specified virtual pages with a readable and writable copy-on-write mapping of
+	// the first numPages pages of the image. The pages must be within an allocation returned by
+	// allocateVirtualPages, and numPages must not exceed the number of pages in the image.
+	WAVM_API void mapCopyOnWriteImage(CopyOnWriteImage* image,
+									  U8* baseVirtualAddress,
+									  Uptr numPages);
+
+	// Returns true if none of the specified pages of a copy-on-write image mapping have been
+	// written to since they were mapped. Returns false if that can't be determined.
+	WAVM_API bool isCopyOnWriteMappingUnmodified(U8* baseVirtualAddress, Uptr numPages);
+
 	// Gets memory usage information for this process.
 	WAVM_API Uptr getPeakMemoryUsageBytes();
 }}
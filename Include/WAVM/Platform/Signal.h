@@ -26,9 +26,26 @@ namespace WAVM { namespace Platform {
 		};
 	};
 
+	// Calls thunk(argument), and returns true if it raised a signal that filter caught. filter is
+	// called from the signal handler, and returns whether to catch the signal. If it does, the
+	// signal's call stack is captured into outCallStack, up to the number of frames that filter
+	// writes to outMaxCallStackFrames.
 	WAVM_API bool catchSignals(void (*thunk)(void*),
-							   bool (*filter)(void*, Signal, CallStack&&),
-							   void* argument);
+							   bool (*filter)(void*, Signal, Uptr& outMaxCallStackFrames),
+							   void* argument,
+							   CallStack& outCallStack);
+
+	// Starts calling sampleCallback with the call stack of whichever thread is running each time
+	// the process has used another 1/samplesPerSecond seconds of CPU time. The call stack is
+	// captured by following the frame pointers, so it omits the callers of code that doesn't keep
+	// a frame pointer, and its frames aren't symbolized. sampleCallback is called from a signal
+	// handler on the sampled thread, so it must be async-signal-safe. Returns false if sampling
+	// has already been started, or isn't supported on this platform.
+	WAVM_API bool startSampling(Uptr samplesPerSecond, void (*sampleCallback)(const CallStack&));
+
+	// Stops calling the sample callback. Once this returns, the callback isn't running on any
+	// thread.
+	WAVM_API void stopSampling();
 
 	WAVM_API void registerEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes);
 	WAVM_API void deregisterEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes);
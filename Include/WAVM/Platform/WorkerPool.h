@@ -0,0 +1,23 @@
+#pragma once
+
+#include <functional>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	// A process-wide pool of worker threads that is shared by everything in WAVM that runs work in
+	// parallel or in the background. A job is started on an idle worker thread if there is one, or
+	// on a new worker thread if there are fewer worker threads than hardware threads. Otherwise,
+	// the job is queued until a worker thread finishes its current job. Worker threads exit after
+	// they have been idle for a while.
+
+	// Runs a job asynchronously on a worker thread.
+	WAVM_API void runAsyncJob(std::function<void()>&& job);
+
+	// Calls job(jobIndex) for each jobIndex in [0, numJobs), on up to maxParallelism threads, and
+	// returns once all the calls have returned. The calling thread runs jobs too, so this makes
+	// progress even if it is called from a worker thread.
+	WAVM_API void runParallelJobs(Uptr numJobs,
+								  Uptr maxParallelism,
+								  const std::function<void(Uptr)>& job);
+}}
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Time.h"
 #include "WAVM/Platform/Diagnostics.h"
 
 // Declare some types to avoid including the full definition.
@@ -15,6 +19,9 @@ namespace WAVM {
 	namespace IR {
 		struct Module;
 	}
+	namespace LLVMJIT {
+		struct CompileOptions;
+	}
 	namespace WASM {
 		struct LoadError;
 	}
@@ -142,6 +149,24 @@ namespace WAVM { namespace Runtime {
 	// root references that can reach it.
 	WAVM_API bool tryCollectCompartment(GCPointer<Compartment>&& compartment);
 
+	struct GCMetrics
+	{
+		// The number of garbage collections.
+		U64 numCollections;
+
+		// The total and longest time that garbage collections held a compartment's lock.
+		U64 totalPauseNanoseconds;
+		U64 maxPauseNanoseconds;
+
+		// The number of times a collection scanned a table's elements because they were written
+		// since the previous collection, the number of times it reused the references found by the
+		// previous scan instead, and the total number of table elements scanned.
+		U64 numScannedTables;
+		U64 numReusedTables;
+		U64 numScannedTableElements;
+	};
+	WAVM_API GCMetrics getGCMetrics();
+
 	//
 	// Exception types
 	//
@@ -168,7 +193,9 @@ namespace WAVM { namespace Runtime {
 	visit(calledUnimplementedIntrinsic);                                                           \
 	visit(outOfMemory);                                                                            \
 	visit(misalignedAtomicMemoryAccess, WAVM::IR::ValueType::i64);                                 \
-	visit(invalidArgument);
+	visit(invalidArgument);                                                                        \
+	visit(interrupted);                                                                            \
+	visit(outOfFuel);
 
 	// Information about a runtime exception.
 	namespace ExceptionTypes {
@@ -188,6 +215,14 @@ namespace WAVM { namespace Runtime {
 	// Returns the parameter types for an exception type instance.
 	WAVM_API IR::TypeTuple getExceptionTypeParameters(const ExceptionType* type);
 
+	// Sets the maximum number of call stack frames captured when WebAssembly code, throwException,
+	// or a trap caught from a signal creates an exception of the given type. Capturing fewer frames
+	// makes throwing the exception cheaper, and 0 skips capturing the call stack. The intrinsic
+	// exception types are shared by all compartments, so setting their call stack depth affects
+	// all compartments.
+	WAVM_API void setExceptionTypeCallStackDepth(ExceptionType* type, Uptr maxFrames);
+	WAVM_API Uptr getExceptionTypeCallStackDepth(const ExceptionType* type);
+
 	//
 	// Resource quotas
 	//
@@ -208,6 +243,22 @@ namespace WAVM { namespace Runtime {
 	WAVM_API Uptr getResourceQuotaCurrentMemoryPages(ResourceQuotaConstRefParam);
 	WAVM_API void setResourceQuotaMaxMemoryPages(ResourceQuotaRefParam, Uptr maxMemoryPages);
 
+	WAVM_API Uptr getResourceQuotaMaxModuleInstances(ResourceQuotaConstRefParam);
+	WAVM_API Uptr getResourceQuotaCurrentModuleInstances(ResourceQuotaConstRefParam);
+	WAVM_API void setResourceQuotaMaxModuleInstances(ResourceQuotaRefParam,
+													 Uptr maxModuleInstances);
+
+	WAVM_API Uptr getResourceQuotaMaxContexts(ResourceQuotaConstRefParam);
+	WAVM_API Uptr getResourceQuotaCurrentContexts(ResourceQuotaConstRefParam);
+	WAVM_API void setResourceQuotaMaxContexts(ResourceQuotaRefParam, Uptr maxContexts);
+
+	// The JIT code charged to a quota is the memory committed for the code and data sections loaded
+	// for each module instance, including optimized-tier code loaded into it later. If loading
+	// optimized-tier code would exceed the quota, the instance keeps running its baseline code.
+	WAVM_API Uptr getResourceQuotaMaxJITCodeBytes(ResourceQuotaConstRefParam);
+	WAVM_API Uptr getResourceQuotaCurrentJITCodeBytes(ResourceQuotaConstRefParam);
+	WAVM_API void setResourceQuotaMaxJITCodeBytes(ResourceQuotaRefParam, Uptr maxJITCodeBytes);
+
 	//
 	// Exceptions
 	//
@@ -282,7 +333,8 @@ namespace WAVM { namespace Runtime {
 
 	WAVM_API std::string asString(const InstructionSource& source);
 
-	// Looks up the source of an instruction from either a native or WASM module.
+	// Looks up the source of an instruction from either a native or WASM module. A WASM function
+	// is only valid until the module that contains it is unloaded.
 	bool getInstructionSourceByAddress(Uptr ip, InstructionSource& outSource);
 
 	// Describes a call stack.
@@ -361,6 +413,13 @@ namespace WAVM { namespace Runtime {
 	// Unmaps a range of memory pages within the memory's address-space.
 	WAVM_API void unmapMemoryPages(Memory* memory, Uptr pageIndex, Uptr numPages);
 
+	// Copies the memory's contents into a snapshot, and maps the memory's pages copy-on-write from
+	// it. Until the memory is written to, cloning it maps the clone from the same snapshot, without
+	// copying its contents, so a template compartment can be cloned in time independent of the
+	// size of its memories. No code may access the memory while it is being snapshotted. Returns
+	// false if the platform doesn't support copy-on-write snapshots.
+	WAVM_API bool snapshotMemory(Memory* memory);
+
 	// Validates that an offset range is wholly inside a Memory's virtual address range.
 	// Note that this returns an address range that may fault on access, though it's guaranteed not
 	// to be mapped by anything other than the given Memory.
@@ -383,6 +442,40 @@ namespace WAVM { namespace Runtime {
 		return (Value*)getValidatedMemoryOffsetRange(memory, offset, numElements * sizeof(Value));
 	}
 
+	// Configures the pool of address-space reservations that destroyed memories return their
+	// reservation to, and that new memories take their reservation from.
+	struct MemoryPoolConfig
+	{
+		// The number of reservations that are allocated up front when the config is set.
+		Uptr numPrereservedReservations = 0;
+
+		// The maximum number of unused reservations kept in the pool.
+		Uptr maxPooledReservations = 16;
+	};
+	WAVM_API void setMemoryPoolConfig(const MemoryPoolConfig& config);
+
+	struct MemoryPoolMetrics
+	{
+		// The number of memories that were created using a pooled reservation.
+		U64 numHits;
+
+		// The number of memories that had to allocate a new reservation.
+		U64 numMisses;
+
+		// The number of unused reservations in the pool.
+		Uptr numPooledReservations;
+
+		// The number of bytes in the committed pages of all memories that haven't been destroyed.
+		// This is an upper bound on the memories' resident bytes: pages that were never touched
+		// are committed, but not resident.
+		Uptr numCommittedBytes;
+
+		// The number of snapshots that memory contents have been copied into, by snapshotMemory,
+		// or by cloning a memory that isn't an unmodified mapping of a snapshot.
+		U64 numSnapshots;
+	};
+	WAVM_API MemoryPoolMetrics getMemoryPoolMetrics();
+
 	//
 	// Globals
 	//
@@ -427,6 +520,26 @@ namespace WAVM { namespace Runtime {
 								   const IR::FeatureSpec& featureSpec = IR::FeatureSpec(),
 								   WASM::LoadError* outError = nullptr);
 
+	// Loads and compiles a binary module that is provided in chunks, for example as it is
+	// downloaded. The module's sections are loaded and validated as their bytes arrive, and its
+	// function definitions are compiled in batches as soon as their bodies have been loaded.
+	struct StreamingModuleLoader;
+
+	WAVM_API StreamingModuleLoader* createStreamingModuleLoader(
+		const IR::FeatureSpec& featureSpec = IR::FeatureSpec());
+
+	// Adds the next chunk of the binary module's bytes. The bytes are copied. Returns false if the
+	// load has already failed, in which case the rest of the module doesn't need to be added.
+	WAVM_API bool addStreamingModuleBytes(StreamingModuleLoader* loader,
+										  const U8* bytes,
+										  Uptr numBytes);
+
+	// Indicates that all the module's bytes have been added, waits for the load and compile to
+	// finish, and destroys the loader. The result is returned as it is for loadBinaryModule.
+	WAVM_API bool finishStreamingModuleLoad(StreamingModuleLoader* loader,
+											ModuleRef& outModule,
+											WASM::LoadError* outError = nullptr);
+
 	// Loads a previously compiled module from a combination of an IR module and the object code
 	// returned by getObjectCode for the previously compiled module.
 	WAVM_API ModuleRef loadPrecompiledModule(const IR::Module& irModule,
@@ -498,6 +611,12 @@ namespace WAVM { namespace Runtime {
 
 	WAVM_API Compartment* cloneCompartment(const Compartment* compartment);
 
+	// Sets the call stack depth of the compartment's exception types, including those created
+	// later. The intrinsic exception types are shared by all compartments, so this doesn't change
+	// their depth, but exceptions of those types that are thrown while code in the compartment is
+	// running capture at most this many frames. See setExceptionTypeCallStackDepth.
+	WAVM_API void setCompartmentExceptionCallStackDepth(Compartment* compartment, Uptr maxFrames);
+
 	WAVM_API Object* remapToClonedCompartment(Object* object, const Compartment* newCompartment);
 	WAVM_API Function* remapToClonedCompartment(Function* function,
 												const Compartment* newCompartment);
@@ -515,7 +634,8 @@ namespace WAVM { namespace Runtime {
 	// Contexts
 	//
 
-	WAVM_API Context* createContext(Compartment* compartment);
+	WAVM_API Context* createContext(Compartment* compartment,
+									ResourceQuotaRefParam resourceQuota = ResourceQuotaRef());
 
 	WAVM_API struct ContextRuntimeData* getContextRuntimeData(const Context* context);
 	WAVM_API Context* getContextFromRuntimeData(struct ContextRuntimeData* contextRuntimeData);
@@ -524,9 +644,111 @@ namespace WAVM { namespace Runtime {
 
 	WAVM_API Compartment* getCompartment(const Context* context);
 
-	// Creates a new context, initializing its mutable global state from the given context.
+	// Creates a new context, initializing its mutable global state, epoch deadline, fuel, and fuel
+	// exhausted handler from the given context.
 	WAVM_API Context* cloneContext(const Context* context, Compartment* newCompartment);
 
+	//
+	// Epochs
+	//
+	// Code compiled with LLVMJIT::CompileOptions::checkEpochDeadlines checks at each function entry
+	// and loop header whether the current epoch has reached the epoch deadline of the context it is
+	// running in, and if so, throws an ExceptionTypes::interrupted exception. Other code is never
+	// interrupted. The epoch is shared by all compartments, and is only advanced by
+	// incrementEpoch, so an embedder can enforce time limits by calling it from a timer thread. All
+	// these functions may be called from any thread, including while the context is executing code.
+	//
+
+	WAVM_API U64 getCurrentEpoch();
+
+	// Increments the current epoch, and returns the new epoch.
+	WAVM_API U64 incrementEpoch();
+
+	// Sets the epoch at which code running in the context will be interrupted. A context's epoch
+	// deadline is initially UINT64_MAX, which never interrupts it.
+	WAVM_API void setContextEpochDeadline(Context* context, U64 epochDeadline);
+	WAVM_API U64 getContextEpochDeadline(const Context* context);
+
+	// Interrupts code running in the context at its next function entry or loop header, by setting
+	// its epoch deadline to 0. The context's code will keep being interrupted until its epoch
+	// deadline is set again.
+	WAVM_API void interruptContext(Context* context);
+
+	//
+	// Fuel
+	//
+	// Code compiled with LLVMJIT::CompileOptions::meterFuel charges the context it runs in one unit
+	// of fuel for each WebAssembly operator. The cost of each basic block is charged before the
+	// block runs, so a context's fuel may be negative while its fuel exhausted handler is called.
+	// If the handler returns false or there is no handler, the cost of the block is refunded and
+	// an ExceptionTypes::outOfFuel exception is thrown, so the context is left with the fuel it had
+	// before the block that didn't run.
+	//
+	// A context's fuel should only be changed while it isn't running code, or by its fuel
+	// exhausted handler. A context's fuel is initially INT64_MAX.
+	//
+
+	WAVM_API void setContextFuel(Context* context, I64 fuel);
+	WAVM_API I64 getContextFuel(const Context* context);
+
+	// Adds fuel to the context, and returns the context's new fuel.
+	WAVM_API I64 addContextFuel(Context* context, I64 deltaFuel);
+
+	// Sets the function called on the thread running the context's code when its fuel is
+	// exhausted. The handler may add fuel to the context, e.g. after yielding to other work, and
+	// returns true to continue running the code if the context's fuel is no longer negative.
+	typedef std::function<bool(Context*)> FuelExhaustedHandler;
+	WAVM_API void setContextFuelExhaustedHandler(Context* context, FuelExhaustedHandler&& handler);
+
+	//
+	// Profiling
+	//
+	// A sampling profiler that periodically captures the call stack of whichever thread is using
+	// CPU time, and maps its frames to WebAssembly functions and operators. Compiled code doesn't
+	// need to be instrumented to be profiled. Samples without any WebAssembly frames are ignored.
+	// The samples are accumulated in a single profile for the process.
+	//
+
+	// Starts taking samplesPerSecond samples for each second of CPU time used by the process.
+	// Returns false if the profiler is already running, or sampling isn't supported on the
+	// platform.
+	WAVM_API bool startProfiling(Uptr samplesPerSecond = 1000);
+
+	// Stops taking samples, and adds the samples that were taken to the profile.
+	WAVM_API void stopProfiling();
+
+	// Discards the samples in the profile.
+	WAVM_API void resetProfile();
+
+	// Returns the number of samples in the profile.
+	WAVM_API U64 getProfileNumSamples();
+
+	// Returns the profile as collapsed stacks: a line for each distinct call stack that was
+	// sampled, with its frames from outermost to innermost separated by semicolons, followed by the
+	// number of samples of it. This is the input format of flamegraph.pl and similar tools.
+	WAVM_API std::string getProfileCollapsedStacks();
+
+	struct ProfiledFunction
+	{
+		std::string debugName;
+
+		// The number of samples in which this was the innermost WebAssembly function, including
+		// samples taken in host functions it called.
+		U64 numSelfSamples = 0;
+
+		// The number of samples in which this function was anywhere on the call stack.
+		U64 numTotalSamples = 0;
+
+		// The number of self samples taken at each of the function's operators, by operator index
+		// in the function's code. Sorted by decreasing number of samples.
+		std::vector<std::pair<Uptr, U64>> opIndexSamples;
+	};
+
+	// Returns the WebAssembly functions in the profile, sorted by decreasing number of self
+	// samples. Functions are identified by their debug name, so the samples of a function in
+	// different instances of a module are combined.
+	WAVM_API std::vector<ProfiledFunction> getProfiledFunctions();
+
 	//
 	// Foreign objects
 	//
@@ -539,15 +761,118 @@ namespace WAVM { namespace Runtime {
 	// Object caching
 	//
 
+	// An immutable, reference-counted view of object code. The bytes are kept alive by the view's
+	// owner, which may be a heap buffer, or e.g. a read transaction on a memory-mapped database.
+	struct ObjectCodeView
+	{
+		const U8* bytes = nullptr;
+		Uptr numBytes = 0;
+		std::shared_ptr<const void> owner;
+
+		ObjectCodeView() {}
+		ObjectCodeView(const U8* inBytes, Uptr inNumBytes, std::shared_ptr<const void>&& inOwner)
+		: bytes(inBytes), numBytes(inNumBytes), owner(std::move(inOwner))
+		{
+		}
+
+		// Creates a view that owns a heap buffer of object code.
+		ObjectCodeView(std::vector<U8>&& inBytes)
+		{
+			std::shared_ptr<const std::vector<U8>> ownedBytes
+				= std::make_shared<const std::vector<U8>>(std::move(inBytes));
+			bytes = ownedBytes->data();
+			numBytes = ownedBytes->size();
+			owner = std::move(ownedBytes);
+		}
+	};
+
 	struct ObjectCacheInterface
 	{
 		virtual ~ObjectCacheInterface() {}
 
-		virtual std::vector<U8> getCachedObject(const U8* wasmBytes,
-												Uptr numWASMBytes,
-												std::function<std::vector<U8>()>&& compileThunk)
+		// Returns the object code cached for a key, or calls compileThunk and caches the object
+		// code it returns. The key is a hash of everything that affects the object code, such as
+		// a partition of a module's function definitions. It is the only thing used to identify
+		// the object code, so the cache doesn't need to store or compare the data it was computed
+		// from. Whoever submits a module chooses the bytes that are hashed, so the key is computed
+		// by a collision-resistant hash (StreamingHash128): otherwise, an attacker could submit a
+		// module with the same key as another module, and have their object code used for it.
+		virtual ObjectCodeView getCachedObject(const Hash128& key,
+											   std::function<std::vector<U8>()>&& compileThunk)
 			= 0;
 	};
 
 	WAVM_API void setGlobalObjectCache(std::shared_ptr<ObjectCacheInterface>&& objectCache);
+
+	//
+	// Compilation options
+	//
+
+	// Sets the options used to compile modules to object code.
+	WAVM_API void setGlobalCompileOptions(const LLVMJIT::CompileOptions& compileOptions);
+
+	//
+	// Asynchronous compilation
+	//
+
+	enum class CompilePriority
+	{
+		low,
+		normal,
+		high,
+
+		num
+	};
+
+	enum class CompileStatus
+	{
+		pending,
+		succeeded,
+		failed,
+		cancelled
+	};
+
+	struct AsyncCompileConfig
+	{
+		// The maximum number of threads in the pool that runs asynchronous compiles.
+		Uptr numThreads = 1;
+	};
+	// Returns false if the config is invalid, in which case the previous config is kept.
+	WAVM_API bool setAsyncCompileConfig(const AsyncCompileConfig& config);
+
+	struct CompileRequest;
+	typedef std::shared_ptr<CompileRequest> CompileRequestRef;
+
+	// Loads and compiles a binary module on the async compile thread pool. The WASM bytes are
+	// copied, so the caller doesn't need to keep them alive. Requests to compile the same bytes
+	// with the same feature spec share a single compile while it is pending, which runs at the
+	// highest priority of the requests that share it.
+	// If onComplete is provided, it is called when the request is completed or cancelled, on the
+	// thread that completed or cancelled it.
+	WAVM_API CompileRequestRef
+	loadBinaryModuleAsync(const U8* wasmBytes,
+						  Uptr numWASMBytes,
+						  const IR::FeatureSpec& featureSpec = IR::FeatureSpec(),
+						  CompilePriority priority = CompilePriority::normal,
+						  std::function<void(CompileStatus)>&& onComplete = nullptr);
+
+	// Returns the status of a compile request without blocking.
+	WAVM_API CompileStatus getCompileStatus(const CompileRequestRef& request);
+
+	// Waits until a compile request is no longer pending, or until waitDuration has elapsed.
+	// Returns the status of the request when the wait returned.
+	WAVM_API CompileStatus waitForCompile(const CompileRequestRef& request,
+										  Time waitDuration = Time::infinity());
+
+	// Returns the status of a compile request. If it succeeded, outModule is set to the compiled
+	// module. If it failed and outError != nullptr, *outError is set to the error.
+	WAVM_API CompileStatus getCompileResult(const CompileRequestRef& request,
+											ModuleRef& outModule,
+											WASM::LoadError* outError = nullptr);
+
+	// Cancels a pending compile request. The compile is skipped if no other pending requests
+	// share it, and it hasn't started yet. Cancellation is best-effort: a compile that has
+	// started runs to completion, although the cancelled request completes immediately and
+	// doesn't receive its result.
+	WAVM_API void cancelCompile(const CompileRequestRef& request);
 }}
@@ -5,7 +5,6 @@
 //
 
 #include <atomic>
-#include <map>
 #include "WAVM/IR/Types.h"
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/BasicTypes.h"
@@ -57,9 +56,10 @@ namespace WAVM { namespace Runtime {
 	static constexpr Uptr wavmCompartmentReservedBytes = Uptr(2) * 1024 * 1024 * 1024;
 	static constexpr Uptr maxThunkArgAndReturnBytes = 256;
 	static constexpr Uptr maxMutableGlobals
-		= (4096 - maxThunkArgAndReturnBytes - sizeof(Context*)) / sizeof(IR::UntaggedValue);
+		= (4096 - maxThunkArgAndReturnBytes - sizeof(Context*) - sizeof(U64) - sizeof(I64))
+		  / sizeof(IR::UntaggedValue);
 	static constexpr Uptr maxMemories = 255;
-	static constexpr Uptr maxTables = 128 * 1024 - maxMemories - 1;
+	static constexpr Uptr maxTables = 128 * 1024 - maxMemories * 2 - 1;
 	static constexpr Uptr compartmentRuntimeDataAlignmentLog2 = 31;
 	static constexpr Uptr contextRuntimeDataAlignment = 4096;
 
@@ -71,6 +71,15 @@ namespace WAVM { namespace Runtime {
 	{
 		U8 thunkArgAndReturnData[maxThunkArgAndReturnBytes];
 		Context* context;
+
+		// Compiled code throws ExceptionTypes::interrupted at a function entry or loop header once
+		// the current epoch is greater than or equal to this.
+		std::atomic<U64> epochDeadline;
+
+		// Code compiled with CompileOptions::meterFuel subtracts the cost of each basic block from
+		// this before running it, and calls out to the runtime if the result is negative.
+		std::atomic<I64> fuel;
+
 		IR::UntaggedValue mutableGlobals[maxMutableGlobals];
 	};
 
@@ -80,6 +89,11 @@ namespace WAVM { namespace Runtime {
 	{
 		Compartment* compartment;
 		void* memoryBases[maxMemories];
+
+		// The number of bytes in each memory. Compiled code loads this to bounds check memory
+		// accesses while other threads may be growing the memory.
+		std::atomic<Uptr> memoryNumBytes[maxMemories];
+
 		void* tableBases[maxTables];
 		ContextRuntimeData contexts[1]; // Actually [maxContexts], but at least MSVC doesn't allow
 										// declaring arrays that large.
@@ -95,6 +109,18 @@ namespace WAVM { namespace Runtime {
 					  == wavmCompartmentReservedBytes,
 				  "CompartmentRuntimeData isn't the expected size");
 
+	// Data about a table that compiled code accesses without calling into the runtime. It is stored
+	// immediately before the table's elements, so it is at a fixed offset from the table's entry in
+	// CompartmentRuntimeData::tableBases.
+	struct TableRuntimeData
+	{
+		std::atomic<Uptr> numElements;
+
+		// Set to 1 when an element is written, so the garbage collector knows that it must rescan
+		// the table's elements. See Table::gcReferences.
+		std::atomic<U8> gcReferencesAreStale;
+	};
+
 	struct Exception
 	{
 		Uptr typeId;
@@ -137,15 +163,36 @@ namespace WAVM { namespace Runtime {
 															   const IR::UntaggedValue* arguments,
 															   IR::UntaggedValue* results);
 
+	// State used by baseline-tier code to count how often a function is executed, and to forward
+	// calls to the function to its optimized-tier code once it has been compiled.
+	struct FunctionTierUpState
+	{
+		// Incremented by baseline-tier code on each call to the function and each loop iteration.
+		std::atomic<U64> hotness{0};
+
+		// When hotness reaches this value, baseline-tier code calls the requestTierUp intrinsic.
+		U64 hotnessThreshold = UINT64_MAX;
+
+		// The index of the function's definition in its module.
+		Uptr functionDefIndex = 0;
+
+		// Identifies the baseline-tier instance of the module that the function was loaded in.
+		U64 baselineInstanceId = 0;
+
+		// Once the function has been recompiled with full optimization, points to the optimized
+		// function's code.
+		std::atomic<const U8*> optimizedCode{nullptr};
+	};
+
 	// Metadata about a function, used to hold data that can't be emitted directly in an object
 	// file, or must be mutable.
 	struct FunctionMutableData
 	{
+		FunctionTierUpState tierUpState;
 		LLVMJIT::Module* jitModule = nullptr;
 		Runtime::Function* function = nullptr;
 		Uptr numCodeBytes = 0;
 		std::atomic<Uptr> numRootReferences{0};
-		std::map<U32, U32> offsetToOpIndexMap;
 		std::string debugName;
 		std::atomic<InvokeThunkPointer> invokeThunk{nullptr};
 		void* userData{nullptr};
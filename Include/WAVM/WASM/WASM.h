@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Logging/Logging.h"
@@ -33,7 +34,23 @@ namespace WAVM { namespace WASM {
 		Type type;
 		std::string message;
 	};
+	struct LoadOptions
+	{
+		// The number of threads used to decode and validate function bodies. If greater than 1,
+		// each function body is decoded on the worker pool as soon as its boundaries are found.
+		// Errors are reported as if the bodies were decoded in order.
+		Uptr numThreads = 1;
+
+		// If set, called after each function body has been decoded and validated, in the order
+		// of the function definitions. The function body is read from the input stream as it is
+		// decoded, instead of after the whole code section is available, so a caller that
+		// streams the input can start using each function body while the rest of the module is
+		// still arriving. The module's declarations and the function definitions that have been
+		// loaded won't change for the rest of the load.
+		std::function<void(Uptr functionDefIndex)> onFunctionBodyLoaded;
+	};
 	WAVM_API bool loadBinaryModule(Serialization::InputStream& stream,
 								   IR::Module& outModule,
-								   LoadError* outError = nullptr);
+								   LoadError* outError = nullptr,
+								   const LoadOptions& options = LoadOptions());
 }}
@@ -70,7 +70,8 @@ namespace WAVM { namespace WAST {
 		uninitializedTableElement,
 		outOfMemory,
 		misalignedAtomicMemoryAccess,
-		invalidArgument
+		invalidArgument,
+		outOfFuel
 	};
 
 	struct Action
@@ -39,6 +39,7 @@ typedef struct wasm_memory_t wasm_memory_t;
 typedef struct wasm_global_t wasm_global_t;
 typedef struct wasm_extern_t wasm_extern_t;
 typedef struct wasm_instance_t wasm_instance_t;
+typedef struct wasm_compile_request_t wasm_compile_request_t;
 
 typedef struct wasm_shared_module_t wasm_shared_module_t;
 typedef struct wasm_shared_func_t wasm_shared_func_t;
@@ -387,6 +388,52 @@ WASM_C_API void wasm_module_export(const wasm_module_t* module,
 								   size_t index,
 								   own wasm_export_t* out_export);
 
+// Asynchronous module compilation
+
+WASM_DECLARE_OWN(compile_request)
+
+typedef uint8_t wasm_compile_priority_t;
+enum wasm_compile_priority_enum
+{
+	WASM_COMPILE_PRIORITY_LOW,
+	WASM_COMPILE_PRIORITY_NORMAL,
+	WASM_COMPILE_PRIORITY_HIGH,
+};
+
+typedef uint8_t wasm_compile_status_t;
+enum wasm_compile_status_enum
+{
+	WASM_COMPILE_PENDING,
+	WASM_COMPILE_SUCCEEDED,
+	WASM_COMPILE_FAILED,
+	WASM_COMPILE_CANCELLED,
+};
+
+typedef void (*wasm_compile_callback_t)(void* env, wasm_compile_status_t status);
+
+// Sets the maximum number of threads used to compile modules asynchronously. Returns false if
+// num_threads is zero.
+WASM_C_API bool wasm_compile_set_num_threads(size_t num_threads);
+
+WASM_C_API own wasm_compile_request_t* wasm_module_compile_async(wasm_engine_t*,
+																 const char* binary,
+																 size_t num_binary_bytes,
+																 wasm_compile_priority_t priority,
+																 wasm_compile_callback_t callback,
+																 void* env);
+
+WASM_C_API wasm_compile_status_t wasm_compile_request_status(const wasm_compile_request_t*);
+
+// Waits for the request to complete, or until timeout_ns nanoseconds have elapsed. A negative
+// timeout waits indefinitely.
+WASM_C_API wasm_compile_status_t wasm_compile_request_wait(const wasm_compile_request_t*,
+														   int64_t timeout_ns);
+
+// Returns the compiled module if the request succeeded, or NULL otherwise.
+WASM_C_API own wasm_module_t* wasm_compile_request_module(const wasm_compile_request_t*);
+
+WASM_C_API void wasm_compile_request_cancel(wasm_compile_request_t*);
+
 // Function Instances
 
 WASM_DECLARE_SHAREABLE_REF(func)
@@ -74,6 +74,11 @@ void EmitFunctionContext::loop(ControlStructureImm imm)
 	irBuilder.CreateBr(loopBodyBlock);
 	irBuilder.SetInsertPoint(loopBodyBlock);
 
+	// Count each iteration of the loop toward the function's hotness in baseline-tier code.
+	if(tierUpState) { emitTierUpHotnessIncrement(); }
+
+	if(moduleContext.checkEpochDeadlines) { emitEpochDeadlineCheck(); }
+
 	// Push a control context that ends at the end block/phi.
 	pushControlStack(ControlContext::Type::loop, blockType.results(), endBlock, endPHIs);
 
@@ -370,11 +375,7 @@ void EmitFunctionContext::call_indirect(CallIndirectImm imm)
 	// Zero extend the function index to the pointer size.
 	auto functionIndexZExt = zext(tableElementIndex, llvmContext.iptrType);
 
-	auto tableBasePointer = loadFromUntypedPointer(
-		irBuilder.CreateInBoundsGEP(getCompartmentAddress(),
-									{moduleContext.tableOffsets[imm.tableIndex]}),
-		llvmContext.iptrType->getPointerTo(),
-		sizeof(Uptr));
+	auto tableBasePointer = getTableBasePointer(imm.tableIndex);
 
 	// Load the funcref referenced by the table.
 	auto elementPointer = irBuilder.CreateInBoundsGEP(tableBasePointer, {functionIndexZExt});
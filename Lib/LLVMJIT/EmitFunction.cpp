@@ -312,6 +312,142 @@ private:
 	Uptr unreachableControlDepth;
 };
 
+void EmitFunctionContext::emitTierUpHotnessIncrement()
+{
+	WAVM_ASSERT(tierUpState);
+
+	// Increment the counter with a separate atomic load and store instead of an atomic
+	// read-modify-write: losing some increments to races between threads is acceptable for a
+	// heuristic, and is much cheaper.
+	llvm::Value* hotnessPointer = irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(
+			tierUpState,
+			{emitLiteral(llvmContext, Uptr(offsetof(Runtime::FunctionTierUpState, hotness)))}),
+		llvmContext.i64Type->getPointerTo());
+	llvm::LoadInst* hotness = irBuilder.CreateLoad(hotnessPointer);
+	hotness->setAtomic(llvm::AtomicOrdering::Monotonic);
+	hotness->setAlignment(sizeof(U64));
+	llvm::Value* newHotness = irBuilder.CreateAdd(hotness, emitLiteral(llvmContext, U64(1)));
+	llvm::StoreInst* store = irBuilder.CreateStore(newHotness, hotnessPointer);
+	store->setAtomic(llvm::AtomicOrdering::Monotonic);
+	store->setAlignment(sizeof(U64));
+
+	// When the counter reaches the function's hotness threshold, call out to the runtime to
+	// request the function's optimized-tier code.
+	llvm::Value* hotnessThreshold = irBuilder.CreateLoad(irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(
+			tierUpState,
+			{emitLiteral(llvmContext,
+						 Uptr(offsetof(Runtime::FunctionTierUpState, hotnessThreshold)))}),
+		llvmContext.i64Type->getPointerTo()));
+
+	auto thresholdReachedBlock
+		= llvm::BasicBlock::Create(llvmContext, "tierUpThresholdReached", function);
+	auto continueBlock = llvm::BasicBlock::Create(llvmContext, "tierUpContinue", function);
+	irBuilder.CreateCondBr(irBuilder.CreateICmpEQ(newHotness, hotnessThreshold),
+						   thresholdReachedBlock,
+						   continueBlock,
+						   moduleContext.likelyFalseBranchWeights);
+
+	irBuilder.SetInsertPoint(thresholdReachedBlock);
+	emitRuntimeIntrinsic(
+		"requestTierUp",
+		FunctionType({}, {ValueType::funcref}, IR::CallingConvention::intrinsic),
+		{llvm::ConstantExpr::getSub(
+			llvm::ConstantExpr::getPtrToInt(function, llvmContext.iptrType),
+			emitLiteral(llvmContext, Uptr(offsetof(Runtime::Function, code))))});
+	irBuilder.CreateBr(continueBlock);
+
+	irBuilder.SetInsertPoint(continueBlock);
+}
+
+void EmitFunctionContext::emitEpochDeadlineCheck()
+{
+	llvm::LoadInst* epoch = irBuilder.CreateLoad(
+		irBuilder.CreatePointerCast(moduleContext.epoch, llvmContext.i64Type->getPointerTo()));
+	epoch->setAtomic(llvm::AtomicOrdering::Monotonic);
+	epoch->setAlignment(sizeof(U64));
+
+	llvm::LoadInst* epochDeadline = irBuilder.CreateLoad(irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(
+			irBuilder.CreateLoad(contextPointerVariable),
+			{emitLiteral(llvmContext,
+						 Uptr(offsetof(Runtime::ContextRuntimeData, epochDeadline)))}),
+		llvmContext.i64Type->getPointerTo()));
+	epochDeadline->setAtomic(llvm::AtomicOrdering::Monotonic);
+	epochDeadline->setAlignment(sizeof(U64));
+
+	// If the deadline has been reached, call out to the runtime, which throws an exception if the
+	// deadline wasn't moved since it was loaded.
+	auto deadlineReachedBlock
+		= llvm::BasicBlock::Create(llvmContext, "epochDeadlineReached", function);
+	auto continueBlock = llvm::BasicBlock::Create(llvmContext, "epochDeadlineContinue", function);
+	irBuilder.CreateCondBr(irBuilder.CreateICmpUGE(epoch, epochDeadline),
+						   deadlineReachedBlock,
+						   continueBlock,
+						   moduleContext.likelyFalseBranchWeights);
+
+	irBuilder.SetInsertPoint(deadlineReachedBlock);
+	emitRuntimeIntrinsic(
+		"epochDeadlineReached", FunctionType({}, {}, IR::CallingConvention::intrinsic), {});
+	irBuilder.CreateBr(continueBlock);
+
+	irBuilder.SetInsertPoint(continueBlock);
+}
+
+void EmitFunctionContext::beginFuelMeteredBlock()
+{
+	WAVM_ASSERT(!fuelCostSubtract);
+
+	llvm::Value* fuelPointer = irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(
+			irBuilder.CreateLoad(contextPointerVariable),
+			{emitLiteral(llvmContext, Uptr(offsetof(Runtime::ContextRuntimeData, fuel)))}),
+		llvmContext.i64Type->getPointerTo());
+	llvm::LoadInst* fuel = irBuilder.CreateLoad(fuelPointer);
+	fuel->setAtomic(llvm::AtomicOrdering::Monotonic);
+	fuel->setAlignment(sizeof(I64));
+
+	// Subtract a placeholder cost that endFuelMeteredBlock replaces with the block's cost.
+	fuelCostSubtract = llvm::cast<llvm::BinaryOperator>(
+		irBuilder.CreateSub(fuel, emitLiteral(llvmContext, I64(0))));
+	llvm::StoreInst* store = irBuilder.CreateStore(fuelCostSubtract, fuelPointer);
+	store->setAtomic(llvm::AtomicOrdering::Monotonic);
+	store->setAlignment(sizeof(I64));
+
+	// If the fuel is exhausted, call out to the runtime, which either adds more fuel to the context
+	// or throws an exception.
+	auto fuelExhaustedBlock = llvm::BasicBlock::Create(llvmContext, "fuelExhausted", function);
+	auto continueBlock = llvm::BasicBlock::Create(llvmContext, "fuelContinue", function);
+	irBuilder.CreateCondBr(
+		irBuilder.CreateICmpSLT(fuelCostSubtract, emitLiteral(llvmContext, I64(0))),
+		fuelExhaustedBlock,
+		continueBlock,
+		moduleContext.likelyFalseBranchWeights);
+
+	// Pass the block's cost to the runtime, so it can refund it if the block doesn't run.
+	irBuilder.SetInsertPoint(fuelExhaustedBlock);
+	emitRuntimeIntrinsic(
+		"fuelExhausted",
+		FunctionType({}, {ValueType::i64}, IR::CallingConvention::intrinsic),
+		{irBuilder.CreateSub(fuel, fuelCostSubtract)});
+	irBuilder.CreateBr(continueBlock);
+
+	irBuilder.SetInsertPoint(continueBlock);
+	fuelMeteredBlock = continueBlock;
+	fuelMeteredBlockCost = 0;
+}
+
+void EmitFunctionContext::endFuelMeteredBlock()
+{
+	if(fuelCostSubtract)
+	{
+		fuelCostSubtract->setOperand(1, emitLiteral(llvmContext, I64(fuelMeteredBlockCost)));
+		fuelCostSubtract = nullptr;
+	}
+	fuelMeteredBlock = nullptr;
+}
+
 void EmitFunctionContext::emit()
 {
 	// Create debug info for the function.
@@ -379,6 +515,45 @@ void EmitFunctionContext::emit()
 		}
 	}
 
+	if(tierUpState)
+	{
+		// If the function has been recompiled at the optimized tier, forward the call to the
+		// optimized code.
+		llvm::LoadInst* optimizedCode = irBuilder.CreateLoad(irBuilder.CreatePointerCast(
+			irBuilder.CreateInBoundsGEP(
+				tierUpState,
+				{emitLiteral(llvmContext,
+							 Uptr(offsetof(Runtime::FunctionTierUpState, optimizedCode)))}),
+			function->getType()->getPointerTo()));
+		optimizedCode->setAtomic(llvm::AtomicOrdering::Acquire);
+		optimizedCode->setAlignment(sizeof(Uptr));
+
+		auto forwardBlock = llvm::BasicBlock::Create(llvmContext, "tierUpForward", function);
+		auto bodyBlock = llvm::BasicBlock::Create(llvmContext, "body", function);
+		irBuilder.CreateCondBr(
+			irBuilder.CreateIsNotNull(optimizedCode), forwardBlock, bodyBlock);
+
+		irBuilder.SetInsertPoint(forwardBlock);
+		llvm::SmallVector<llvm::Value*, 8> forwardArgs;
+		for(llvm::Argument& arg : function->args()) { forwardArgs.push_back(&arg); }
+		llvm::CallInst* forwardCall = irBuilder.CreateCall(optimizedCode, forwardArgs);
+		forwardCall->setCallingConv(function->getCallingConv());
+		forwardCall->setTailCall();
+		if(forwardCall->getType()->isVoidTy()) { irBuilder.CreateRetVoid(); }
+		else
+		{
+			irBuilder.CreateRet(forwardCall);
+		}
+
+		// Otherwise, count the call toward the function's hotness, and run the baseline code.
+		irBuilder.SetInsertPoint(bodyBlock);
+		emitTierUpHotnessIncrement();
+	}
+
+	if(moduleContext.checkEpochDeadlines) { emitEpochDeadlineCheck(); }
+
+	if(moduleContext.meterFuel) { beginFuelMeteredBlock(); }
+
 	if(EMIT_ENTER_EXIT_HOOKS)
 	{
 		emitRuntimeIntrinsic(
@@ -402,12 +577,26 @@ void EmitFunctionContext::emit()
 		irBuilder.SetCurrentDebugLocation(
 			llvm::DILocation::get(llvmContext, (unsigned int)opIndex++, 0, diFunction));
 
-		if(controlStack.back().isReachable) { decoder.decodeOp(*this); }
+		if(controlStack.back().isReachable)
+		{
+			if(moduleContext.meterFuel) { ++fuelMeteredBlockCost; }
+			decoder.decodeOp(*this);
+		}
 		else
 		{
 			decoder.decodeOp(unreachableOpVisitor);
 		}
+
+		// If the operator started a new basic block, end the fuel-metered block, and begin a new
+		// one. Any branch into the new basic block will then pay for the operators after it.
+		if(moduleContext.meterFuel && irBuilder.GetInsertBlock() != fuelMeteredBlock)
+		{
+			endFuelMeteredBlock();
+			if(controlStack.size() && controlStack.back().isReachable)
+			{ beginFuelMeteredBlock(); }
+		}
 	};
+	if(moduleContext.meterFuel) { endFuelMeteredBlock(); }
 	WAVM_ASSERT(irBuilder.GetInsertBlock() == returnBlock);
 
 	if(EMIT_ENTER_EXIT_HOOKS)
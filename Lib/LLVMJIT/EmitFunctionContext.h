@@ -26,6 +26,16 @@ namespace WAVM { namespace LLVMJIT {
 
 		llvm::DISubprogram* diFunction;
 
+		// For baseline-tier code, a pointer to the function's Runtime::FunctionTierUpState.
+		llvm::Constant* tierUpState;
+
+		// For fuel-metered code, the basic block that the current fuel-metered block of operators
+		// starts in, the instruction that subtracts the block's cost from the context's fuel, and
+		// the cost of the block's operators that have been emitted so far.
+		llvm::BasicBlock* fuelMeteredBlock = nullptr;
+		llvm::BinaryOperator* fuelCostSubtract = nullptr;
+		U64 fuelMeteredBlockCost = 0;
+
 		// Information about an in-scope control structure.
 		struct ControlContext
 		{
@@ -66,18 +76,33 @@ namespace WAVM { namespace LLVMJIT {
 							EmitModuleContext& inModuleContext,
 							const IR::Module& inIRModule,
 							const IR::FunctionDef& inFunctionDef,
-							llvm::Function* inLLVMFunction)
+							llvm::Function* inLLVMFunction,
+							llvm::Constant* inTierUpState = nullptr)
 		: EmitContext(inLLVMContext, inModuleContext.memoryOffsets)
 		, moduleContext(inModuleContext)
 		, irModule(inIRModule)
 		, functionDef(inFunctionDef)
 		, functionType(inIRModule.types[inFunctionDef.type.index])
 		, function(inLLVMFunction)
+		, tierUpState(inTierUpState)
 		{
 		}
 
 		void emit();
 
+		// Emits code to increment the hotness counter in the function's FunctionTierUpState.
+		void emitTierUpHotnessIncrement();
+
+		// Emits code to interrupt the function if the current epoch has reached the context's epoch
+		// deadline.
+		void emitEpochDeadlineCheck();
+
+		// Emits code to subtract the cost of a block of operators from the context's fuel, and to
+		// call out to the runtime if the fuel is exhausted. The cost is filled in by
+		// endFuelMeteredBlock once all the block's operators have been emitted.
+		void beginFuelMeteredBlock();
+		void endFuelMeteredBlock();
+
 		// Operand stack manipulation
 		llvm::Value* pop()
 		{
@@ -138,6 +163,12 @@ namespace WAVM { namespace LLVMJIT {
 											llvm::Type* memoryType,
 											Uptr memoryIndex);
 
+		// Loads the current number of bytes in a memory.
+		llvm::Value* getMemoryNumBytes(Uptr memoryIndex);
+
+		// Loads the address of a table's elements.
+		llvm::Value* getTableBasePointer(Uptr tableIndex);
+
 		// Traps a divide-by-zero
 		void trapDivideByZero(llvm::Value* divisor);
 
@@ -62,10 +62,45 @@ llvm::Value* EmitFunctionContext::coerceAddressToPointer(llvm::Value* boundedAdd
 	return irBuilder.CreatePointerCast(bytePointer, memoryType->getPointerTo());
 }
 
+llvm::Value* EmitFunctionContext::getMemoryNumBytes(Uptr memoryIndex)
+{
+	// The memory's entry in CompartmentRuntimeData::memoryNumBytes is at a fixed offset from its
+	// entry in CompartmentRuntimeData::memoryBases.
+	llvm::Constant* memoryNumBytesOffset = llvm::ConstantExpr::getAdd(
+		moduleContext.memoryOffsets[memoryIndex],
+		emitLiteral(llvmContext,
+					Uptr(offsetof(Runtime::CompartmentRuntimeData, memoryNumBytes)
+						 - offsetof(Runtime::CompartmentRuntimeData, memoryBases))));
+	auto load = irBuilder.CreateLoad(irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(getCompartmentAddress(), {memoryNumBytesOffset}),
+		llvmContext.iptrType->getPointerTo()));
+	load->setAlignment(sizeof(Uptr));
+
+	// The memory may be grown by another thread.
+	load->setAtomic(llvm::AtomicOrdering::Monotonic);
+	return zext(load, llvmContext.i64Type);
+}
+
+// If numBytes is a constant that can be copied by a single integer load and store, returns the
+// integer type to use.
+static llvm::Type* getSmallConstantCopyType(LLVMContext& llvmContext, llvm::Value* numBytes)
+{
+	auto constantNumBytes = llvm::dyn_cast<llvm::ConstantInt>(numBytes);
+	if(!constantNumBytes) { return nullptr; }
+	switch(constantNumBytes->getZExtValue())
+	{
+	case 1: return llvmContext.i8Type;
+	case 2: return llvmContext.i16Type;
+	case 4: return llvmContext.i32Type;
+	case 8: return llvmContext.i64Type;
+	default: return nullptr;
+	}
+}
+
 //
 // Memory size operators
-// These just call out to wavmIntrinsics.growMemory/currentMemory, passing a pointer to the default
-// memory for the module.
+// memory.grow calls out to the memory.grow intrinsic, but memory.size is computed from the
+// memory's entry in CompartmentRuntimeData::memoryNumBytes.
 //
 
 void EmitFunctionContext::memory_grow(MemoryImm imm)
@@ -83,14 +118,10 @@ void EmitFunctionContext::memory_grow(MemoryImm imm)
 }
 void EmitFunctionContext::memory_size(MemoryImm imm)
 {
-	ValueVector currentNumPages = emitRuntimeIntrinsic(
-		"memory.size",
-		FunctionType(TypeTuple(ValueType::i32),
-					 TypeTuple(inferValueType<Uptr>()),
-					 IR::CallingConvention::intrinsic),
-		{getMemoryIdFromOffset(llvmContext, moduleContext.memoryOffsets[imm.memoryIndex])});
-	WAVM_ASSERT(currentNumPages.size() == 1);
-	push(currentNumPages[0]);
+	llvm::Value* numBytes = getMemoryNumBytes(imm.memoryIndex);
+	push(irBuilder.CreateTrunc(
+		irBuilder.CreateLShr(numBytes, emitLiteral(llvmContext, U64(IR::numBytesPerPageLog2))),
+		llvmContext.i32Type));
 }
 
 //
@@ -136,6 +167,55 @@ void EmitFunctionContext::memory_copy(MemoryCopyImm imm)
 	auto sourceAddress = pop();
 	auto destAddress = pop();
 
+	// Check whether both the source and destination ranges are within their memories.
+	llvm::Value* numBytes64 = zext(numBytes, llvmContext.i64Type);
+	llvm::Value* sourceAddress64 = zext(sourceAddress, llvmContext.i64Type);
+	llvm::Value* destAddress64 = zext(destAddress, llvmContext.i64Type);
+	llvm::Value* isInBounds = irBuilder.CreateAnd(
+		irBuilder.CreateICmpULE(irBuilder.CreateAdd(destAddress64, numBytes64),
+								getMemoryNumBytes(imm.destMemoryIndex)),
+		irBuilder.CreateICmpULE(irBuilder.CreateAdd(sourceAddress64, numBytes64),
+								getMemoryNumBytes(imm.sourceMemoryIndex)));
+
+	auto inBoundsBlock = llvm::BasicBlock::Create(llvmContext, "memoryCopyInBounds", function);
+	auto outOfBoundsBlock
+		= llvm::BasicBlock::Create(llvmContext, "memoryCopyOutOfBounds", function);
+	auto endBlock = llvm::BasicBlock::Create(llvmContext, "memoryCopyEnd", function);
+	irBuilder.CreateCondBr(
+		isInBounds, inBoundsBlock, outOfBoundsBlock, moduleContext.likelyTrueBranchWeights);
+
+	// If the ranges are in bounds, copy the bytes inline.
+	irBuilder.SetInsertPoint(inBoundsBlock);
+	if(llvm::Type* copyType = getSmallConstantCopyType(llvmContext, numBytes))
+	{
+		// Copy small constant numbers of bytes with a single load and store, which is correct even
+		// if the ranges overlap.
+		auto load = irBuilder.CreateLoad(
+			coerceAddressToPointer(sourceAddress64, copyType, imm.sourceMemoryIndex));
+		load->setAlignment(1);
+		load->setVolatile(true);
+		auto store = irBuilder.CreateStore(
+			load, coerceAddressToPointer(destAddress64, copyType, imm.destMemoryIndex));
+		store->setAlignment(1);
+		store->setVolatile(true);
+	}
+	else
+	{
+		llvm::Value* sourcePointer = coerceAddressToPointer(
+			sourceAddress64, llvmContext.i8Type, imm.sourceMemoryIndex);
+		llvm::Value* destPointer
+			= coerceAddressToPointer(destAddress64, llvmContext.i8Type, imm.destMemoryIndex);
+#if LLVM_VERSION_MAJOR >= 7
+		irBuilder.CreateMemMove(destPointer, 1, sourcePointer, 1, numBytes64, true);
+#else
+		irBuilder.CreateMemMove(destPointer, sourcePointer, numBytes64, 1, true);
+#endif
+	}
+	irBuilder.CreateBr(endBlock);
+
+	// If either range is out of bounds, call the runtime intrinsic, which copies the bytes up to
+	// the out-of-bounds address before trapping.
+	irBuilder.SetInsertPoint(outOfBoundsBlock);
 	emitRuntimeIntrinsic(
 		"memory.copy",
 		FunctionType({},
@@ -150,6 +230,9 @@ void EmitFunctionContext::memory_copy(MemoryCopyImm imm)
 		 numBytes,
 		 getMemoryIdFromOffset(llvmContext, moduleContext.memoryOffsets[imm.destMemoryIndex]),
 		 getMemoryIdFromOffset(llvmContext, moduleContext.memoryOffsets[imm.sourceMemoryIndex])});
+	irBuilder.CreateBr(endBlock);
+
+	irBuilder.SetInsertPoint(endBlock);
 }
 
 void EmitFunctionContext::memory_fill(MemoryImm imm)
@@ -158,6 +241,51 @@ void EmitFunctionContext::memory_fill(MemoryImm imm)
 	auto value = pop();
 	auto destAddress = pop();
 
+	// Check whether the destination range is within the memory.
+	llvm::Value* numBytes64 = zext(numBytes, llvmContext.i64Type);
+	llvm::Value* destAddress64 = zext(destAddress, llvmContext.i64Type);
+	llvm::Value* isInBounds
+		= irBuilder.CreateICmpULE(irBuilder.CreateAdd(destAddress64, numBytes64),
+								  getMemoryNumBytes(imm.memoryIndex));
+
+	auto inBoundsBlock = llvm::BasicBlock::Create(llvmContext, "memoryFillInBounds", function);
+	auto outOfBoundsBlock
+		= llvm::BasicBlock::Create(llvmContext, "memoryFillOutOfBounds", function);
+	auto endBlock = llvm::BasicBlock::Create(llvmContext, "memoryFillEnd", function);
+	irBuilder.CreateCondBr(
+		isInBounds, inBoundsBlock, outOfBoundsBlock, moduleContext.likelyTrueBranchWeights);
+
+	// If the range is in bounds, fill the bytes inline.
+	irBuilder.SetInsertPoint(inBoundsBlock);
+	llvm::Value* byteValue = trunc(value, llvmContext.i8Type);
+	if(llvm::Type* fillType = getSmallConstantCopyType(llvmContext, numBytes))
+	{
+		// Fill small constant numbers of bytes with a single store of the byte value splatted to
+		// an integer of that size.
+		const U32 numFillBits = fillType->getIntegerBitWidth();
+		llvm::Value* splatValue = irBuilder.CreateMul(
+			zext(byteValue, fillType),
+			llvm::ConstantInt::get(fillType,
+								   llvm::APInt::getSplat(numFillBits, llvm::APInt(8, 1))));
+		auto store = irBuilder.CreateStore(
+			splatValue, coerceAddressToPointer(destAddress64, fillType, imm.memoryIndex));
+		store->setAlignment(1);
+		store->setVolatile(true);
+	}
+	else
+	{
+		irBuilder.CreateMemSet(
+			coerceAddressToPointer(destAddress64, llvmContext.i8Type, imm.memoryIndex),
+			byteValue,
+			numBytes64,
+			1,
+			true);
+	}
+	irBuilder.CreateBr(endBlock);
+
+	// If the range is out of bounds, call the runtime intrinsic, which fills the bytes up to the
+	// out-of-bounds address before trapping.
+	irBuilder.SetInsertPoint(outOfBoundsBlock);
 	emitRuntimeIntrinsic(
 		"memory.fill",
 		FunctionType(
@@ -168,6 +296,9 @@ void EmitFunctionContext::memory_fill(MemoryImm imm)
 		 value,
 		 numBytes,
 		 getMemoryIdFromOffset(llvmContext, moduleContext.memoryOffsets[imm.memoryIndex])});
+	irBuilder.CreateBr(endBlock);
+
+	irBuilder.SetInsertPoint(endBlock);
 }
 
 //
@@ -111,10 +111,20 @@ static llvm::Constant* createImportedConstant(llvm::Module& llvmModule, llvm::Tw
 void LLVMJIT::emitModule(const IR::Module& irModule,
 						 LLVMContext& llvmContext,
 						 llvm::Module& outLLVMModule,
-						 llvm::TargetMachine* targetMachine)
+						 llvm::TargetMachine* targetMachine,
+						 Uptr beginFunctionDefIndex,
+						 Uptr endFunctionDefIndex,
+						 CompileTier tier,
+						 bool meterFuel,
+						 bool checkEpochDeadlines)
 {
+	WAVM_ASSERT(beginFunctionDefIndex <= endFunctionDefIndex);
+	WAVM_ASSERT(endFunctionDefIndex <= irModule.functions.defs.size());
+
 	Timing::Timer emitTimer;
 	EmitModuleContext moduleContext(irModule, llvmContext, &outLLVMModule, targetMachine);
+	moduleContext.meterFuel = meterFuel;
+	moduleContext.checkEpochDeadlines = checkEpochDeadlines;
 
 	// Set the module data layout for the target machine.
 	outLLVMModule.setDataLayout(targetMachine->createDataLayout());
@@ -188,6 +198,17 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 	moduleContext.tableReferenceBias = llvm::ConstantExpr::getPtrToInt(
 		createImportedConstant(outLLVMModule, "tableReferenceBias"), llvmContext.iptrType);
 
+	// Create a LLVM external global that will point to the sentinel object for null table elements,
+	// and compute the biased value that represents it in a table.
+	moduleContext.uninitializedTableElementBiasedValue = llvm::ConstantExpr::getSub(
+		llvm::ConstantExpr::getPtrToInt(
+			createImportedConstant(outLLVMModule, "uninitializedTableElement"),
+			llvmContext.iptrType),
+		moduleContext.tableReferenceBias);
+
+	// Create a LLVM external global that will point to the current epoch.
+	moduleContext.epoch = createImportedConstant(outLLVMModule, "epoch");
+
 	// Create a LLVM external global that will point to the std::type_info for Runtime::Exception.
 	if(moduleContext.useWindowsSEH)
 	{
@@ -240,8 +261,9 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 		moduleContext.functions[functionIndex] = function;
 	}
 
-	// Compile each function in the module.
-	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
+	// Compile each function in the module's partition. The functions defined by other partitions
+	// are left as external declarations that are resolved when the partitions are loaded.
+	for(Uptr functionDefIndex = beginFunctionDefIndex; functionDefIndex < endFunctionDefIndex;
 		++functionDefIndex)
 	{
 		const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
@@ -262,11 +284,24 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 								 moduleContext.typeIds[functionDef.type.index]);
 		setFunctionAttributes(targetMachine, function);
 
-		EmitFunctionContext(llvmContext, moduleContext, irModule, functionDef, function).emit();
+		// Baseline-tier code references the function's FunctionTierUpState.
+		llvm::Constant* tierUpState = nullptr;
+		if(tier == CompileTier::baseline)
+		{
+			tierUpState = createImportedConstant(
+				outLLVMModule, getExternalName("functionDefTierUpStates", functionDefIndex));
+		}
+
+		EmitFunctionContext(
+			llvmContext, moduleContext, irModule, functionDef, function, tierUpState)
+			.emit();
 	}
 
 	// Finalize the debug info.
 	moduleContext.diBuilder.finalize();
 
-	Timing::logRatePerSecond("Emitted LLVM IR", emitTimer, (F64)outLLVMModule.size(), "functions");
+	Timing::logRatePerSecond("Emitted LLVM IR",
+							 emitTimer,
+							 (F64)(endFunctionDefIndex - beginFunctionDefIndex),
+							 "functions");
 }
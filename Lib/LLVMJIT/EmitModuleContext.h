@@ -27,6 +27,14 @@ namespace WAVM { namespace LLVMJIT {
 
 		llvm::Constant* moduleInstanceId;
 		llvm::Constant* tableReferenceBias;
+		llvm::Constant* uninitializedTableElementBiasedValue;
+		llvm::Constant* epoch;
+
+		// Whether to emit code that meters fuel. See CompileOptions::meterFuel.
+		bool meterFuel = false;
+
+		// Whether to emit epoch deadline checks. See CompileOptions::checkEpochDeadlines.
+		bool checkEpochDeadlines = false;
 
 		llvm::DIBuilder diBuilder;
 		llvm::DICompileUnit* diCompileUnit;
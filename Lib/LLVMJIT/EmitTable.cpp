@@ -19,6 +19,7 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/IR/Value.h>
 POP_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 
+using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::LLVMJIT;
 
@@ -45,30 +46,145 @@ void EmitFunctionContext::ref_func(FunctionImm imm)
 	push(anyref);
 }
 
+llvm::Value* EmitFunctionContext::getTableBasePointer(Uptr tableIndex)
+{
+	return loadFromUntypedPointer(
+		irBuilder.CreateInBoundsGEP(getCompartmentAddress(),
+									{moduleContext.tableOffsets[tableIndex]}),
+		llvmContext.iptrType->getPointerTo(),
+		sizeof(Uptr));
+}
+
+// Returns a pointer to a field of the TableRuntimeData that is stored immediately before a table's
+// elements.
+static llvm::Value* getTableRuntimeDataFieldPointer(EmitFunctionContext& functionContext,
+													llvm::Value* tableBasePointer,
+													Uptr fieldOffset,
+													llvm::Type* fieldType)
+{
+	LLVMContext& llvmContext = functionContext.llvmContext;
+	const I64 offsetFromBase = I64(fieldOffset) - I64(sizeof(Runtime::TableRuntimeData));
+	return functionContext.irBuilder.CreatePointerCast(
+		functionContext.irBuilder.CreateInBoundsGEP(
+			functionContext.irBuilder.CreatePointerCast(tableBasePointer, llvmContext.i8PtrType),
+			{emitLiteral(llvmContext, offsetFromBase)}),
+		fieldType->getPointerTo());
+}
+
 void EmitFunctionContext::table_get(TableImm imm)
 {
 	llvm::Value* index = pop();
-	llvm::Value* result = emitRuntimeIntrinsic(
-		"table.get",
-		FunctionType({ValueType::anyref},
+
+	// Load the biased value of the element. Elements past the end of the table are either in
+	// committed pages that contain the out-of-bounds element, or in uncommitted pages of the
+	// table's reserved address space, which fault and are translated to an outOfBoundsTableAccess
+	// trap by the runtime.
+	llvm::Value* elementPointer = irBuilder.CreateInBoundsGEP(
+		getTableBasePointer(imm.tableIndex), {zext(index, llvmContext.iptrType)});
+	llvm::LoadInst* biasedValue = irBuilder.CreateLoad(elementPointer);
+	biasedValue->setAtomic(llvm::AtomicOrdering::Acquire);
+	biasedValue->setAlignment(sizeof(Uptr));
+
+	// The out-of-bounds element has a biased value of zero.
+	emitConditionalTrapIntrinsic(
+		irBuilder.CreateICmpEQ(biasedValue, emitLiteral(llvmContext, Uptr(0))),
+		"outOfBoundsTableAccessTrap",
+		FunctionType({},
 					 TypeTuple({ValueType::i32, inferValueType<Uptr>()}),
 					 IR::CallingConvention::intrinsic),
-		{index, getTableIdFromOffset(llvmContext, moduleContext.tableOffsets[imm.tableIndex])})[0];
-	push(result);
+		{index, getTableIdFromOffset(llvmContext, moduleContext.tableOffsets[imm.tableIndex])});
+
+	// Translate the uninitialized element to null.
+	llvm::Value* element = irBuilder.CreateIntToPtr(
+		irBuilder.CreateAdd(biasedValue, moduleContext.tableReferenceBias),
+		llvmContext.anyrefType);
+	push(irBuilder.CreateSelect(
+		irBuilder.CreateICmpEQ(biasedValue, moduleContext.uninitializedTableElementBiasedValue),
+		llvm::Constant::getNullValue(llvmContext.anyrefType),
+		element));
 }
 
 void EmitFunctionContext::table_set(TableImm imm)
 {
 	llvm::Value* value = pop();
 	llvm::Value* index = pop();
-	emitRuntimeIntrinsic(
-		"table.set",
+
+	llvm::Value* tableBasePointer = getTableBasePointer(imm.tableIndex);
+	llvm::Value* elementPointer
+		= irBuilder.CreateInBoundsGEP(tableBasePointer, {zext(index, llvmContext.iptrType)});
+
+	// Translate null to the uninitialized element, and bias the new element.
+	llvm::Value* newBiasedValue = irBuilder.CreateSelect(
+		irBuilder.CreateICmpEQ(value, llvm::Constant::getNullValue(llvmContext.anyrefType)),
+		moduleContext.uninitializedTableElementBiasedValue,
+		irBuilder.CreateSub(irBuilder.CreatePtrToInt(value, llvmContext.iptrType),
+							moduleContext.tableReferenceBias));
+
+	// Replace the element with a compare-and-swap loop that traps if the element being replaced is
+	// the out-of-bounds element, so a concurrent table.grow can't be overwritten.
+	llvm::LoadInst* initialBiasedValue = irBuilder.CreateLoad(elementPointer);
+	initialBiasedValue->setAtomic(llvm::AtomicOrdering::Monotonic);
+	initialBiasedValue->setAlignment(sizeof(Uptr));
+
+	llvm::BasicBlock* preLoopBlock = irBuilder.GetInsertBlock();
+	llvm::BasicBlock* loopBlock = llvm::BasicBlock::Create(llvmContext, "tableSetLoop", function);
+	llvm::BasicBlock* storedBlock
+		= llvm::BasicBlock::Create(llvmContext, "tableSetStored", function);
+	irBuilder.CreateBr(loopBlock);
+
+	irBuilder.SetInsertPoint(loopBlock);
+	llvm::PHINode* oldBiasedValue = irBuilder.CreatePHI(llvmContext.iptrType, 2);
+	oldBiasedValue->addIncoming(initialBiasedValue, preLoopBlock);
+	emitConditionalTrapIntrinsic(
+		irBuilder.CreateICmpEQ(oldBiasedValue, emitLiteral(llvmContext, Uptr(0))),
+		"outOfBoundsTableAccessTrap",
 		FunctionType({},
-					 TypeTuple({ValueType::i32, ValueType::anyref, inferValueType<Uptr>()}),
+					 TypeTuple({ValueType::i32, inferValueType<Uptr>()}),
 					 IR::CallingConvention::intrinsic),
-		{index,
-		 value,
-		 getTableIdFromOffset(llvmContext, moduleContext.tableOffsets[imm.tableIndex])});
+		{index, getTableIdFromOffset(llvmContext, moduleContext.tableOffsets[imm.tableIndex])});
+	llvm::Value* cmpxchg
+		= irBuilder.CreateAtomicCmpXchg(elementPointer,
+										oldBiasedValue,
+										newBiasedValue,
+										llvm::AtomicOrdering::SequentiallyConsistent,
+										llvm::AtomicOrdering::SequentiallyConsistent);
+	oldBiasedValue->addIncoming(irBuilder.CreateExtractValue(cmpxchg, {0}),
+								irBuilder.GetInsertBlock());
+	irBuilder.CreateCondBr(irBuilder.CreateExtractValue(cmpxchg, {1}),
+						   storedBlock,
+						   loopBlock,
+						   moduleContext.likelyTrueBranchWeights);
+
+	// Mark the table's GC references as stale if they aren't already. Like
+	// markTableGCReferencesStale, this is sequentially consistent with the element write, so a
+	// concurrent garbage collection either sees the new element, or sees the stale flag.
+	irBuilder.SetInsertPoint(storedBlock);
+	llvm::Value* gcReferencesAreStalePointer = getTableRuntimeDataFieldPointer(
+		*this,
+		tableBasePointer,
+		offsetof(Runtime::TableRuntimeData, gcReferencesAreStale),
+		llvmContext.i8Type);
+	llvm::LoadInst* gcReferencesAreStale = irBuilder.CreateLoad(gcReferencesAreStalePointer);
+	gcReferencesAreStale->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+	gcReferencesAreStale->setAlignment(1);
+
+	llvm::BasicBlock* markStaleBlock
+		= llvm::BasicBlock::Create(llvmContext, "tableSetMarkStale", function);
+	llvm::BasicBlock* endBlock = llvm::BasicBlock::Create(llvmContext, "tableSetEnd", function);
+	irBuilder.CreateCondBr(
+		irBuilder.CreateICmpEQ(gcReferencesAreStale, llvm::ConstantInt::get(llvmContext.i8Type, 0)),
+		markStaleBlock,
+		endBlock,
+		moduleContext.likelyFalseBranchWeights);
+
+	irBuilder.SetInsertPoint(markStaleBlock);
+	llvm::StoreInst* markStale = irBuilder.CreateStore(
+		llvm::ConstantInt::get(llvmContext.i8Type, 1), gcReferencesAreStalePointer);
+	markStale->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+	markStale->setAlignment(1);
+	irBuilder.CreateBr(endBlock);
+
+	irBuilder.SetInsertPoint(endBlock);
 }
 
 void EmitFunctionContext::table_init(ElemSegmentAndTableImm imm)
@@ -161,12 +277,13 @@ void EmitFunctionContext::table_grow(TableImm imm)
 }
 void EmitFunctionContext::table_size(TableImm imm)
 {
-	ValueVector currentNumElements = emitRuntimeIntrinsic(
-		"table.size",
-		FunctionType(TypeTuple(ValueType::i32),
-					 TypeTuple(inferValueType<Uptr>()),
-					 IR::CallingConvention::intrinsic),
-		{getTableIdFromOffset(llvmContext, moduleContext.tableOffsets[imm.tableIndex])});
-	WAVM_ASSERT(currentNumElements.size() == 1);
-	push(currentNumElements[0]);
+	// The table may be grown by another thread.
+	llvm::LoadInst* numElements = irBuilder.CreateLoad(
+		getTableRuntimeDataFieldPointer(*this,
+										getTableBasePointer(imm.tableIndex),
+										offsetof(Runtime::TableRuntimeData, numElements),
+										llvmContext.iptrType));
+	numElements->setAtomic(llvm::AtomicOrdering::Monotonic);
+	numElements->setAlignment(sizeof(Uptr));
+	push(irBuilder.CreateTrunc(numElements, llvmContext.i32Type));
 }
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <system_error>
@@ -13,6 +14,7 @@
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/WorkerPool.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/ADT/SmallVector.h>
@@ -117,7 +119,8 @@ static void optimizeLLVMModule(llvm::Module& llvmModule, bool shouldLogMetrics)
 std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 										   llvm::Module&& llvmModule,
 										   bool shouldLogMetrics,
-										   llvm::TargetMachine* targetMachine)
+										   llvm::TargetMachine* targetMachine,
+										   CompileTier tier)
 {
 	// Verify the module.
 	if(WAVM_ENABLE_ASSERTS)
@@ -131,8 +134,13 @@ std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 		}
 	}
 
-	// Optimize the module;
-	optimizeLLVMModule(llvmModule, shouldLogMetrics);
+	// Optimize the module, unless compiling it at the baseline tier. Baseline-tier code is also
+	// generated without the target machine's optimizations, which uses fast instruction selection.
+	if(tier == CompileTier::optimized) { optimizeLLVMModule(llvmModule, shouldLogMetrics); }
+	else
+	{
+		targetMachine->setOptLevel(llvm::CodeGenOpt::None);
+	}
 
 	// Generate machine code for the module.
 	Timing::Timer machineCodeTimer;
@@ -194,18 +202,184 @@ static std::unique_ptr<llvm::TargetMachine> getAndValidateTargetMachine(
 	return targetMachine;
 }
 
-std::vector<U8> LLVMJIT::compileModule(const IR::Module& irModule, const TargetSpec& targetSpec)
+std::vector<U8> LLVMJIT::packObjectFiles(const std::vector<ObjectFileBytes>& objectFiles)
 {
-	std::unique_ptr<llvm::TargetMachine> targetMachine
-		= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+	Uptr numBytes = sizeof(objectContainerMagic) + sizeof(U64);
+	for(const ObjectFileBytes& objectFile : objectFiles)
+	{ numBytes += sizeof(U64) + objectFile.numBytes; }
+
+	std::vector<U8> objectCode;
+	objectCode.reserve(numBytes);
+	auto appendBytes = [&objectCode](const void* bytes, Uptr numBytes) {
+		objectCode.insert(objectCode.end(), (const U8*)bytes, (const U8*)bytes + numBytes);
+	};
 
-	// Emit LLVM IR for the module.
+	const U64 numObjectFiles = U64(objectFiles.size());
+	appendBytes(objectContainerMagic, sizeof(objectContainerMagic));
+	appendBytes(&numObjectFiles, sizeof(U64));
+	for(const ObjectFileBytes& objectFile : objectFiles)
+	{
+		const U64 numObjectFileBytes = U64(objectFile.numBytes);
+		appendBytes(&numObjectFileBytes, sizeof(U64));
+		appendBytes(objectFile.bytes, objectFile.numBytes);
+	}
+	WAVM_ASSERT(objectCode.size() == numBytes);
+
+	return objectCode;
+}
+
+// A contiguous range of a module's function definitions that is compiled to a separate object file.
+struct CompilePartition
+{
+	CompileTier tier;
+	bool meterFuel;
+	bool checkEpochDeadlines;
+	Uptr beginFunctionDefIndex;
+	Uptr endFunctionDefIndex;
+	std::unique_ptr<llvm::TargetMachine> targetMachine;
+	std::vector<U8> objectBytes;
+};
+
+static void compilePartition(const IR::Module& irModule, CompilePartition& partition)
+{
+	// Emit LLVM IR for the partition's function definitions.
 	LLVMContext llvmContext;
 	llvm::Module llvmModule("", llvmContext);
-	emitModule(irModule, llvmContext, llvmModule, targetMachine.get());
+	emitModule(irModule,
+			   llvmContext,
+			   llvmModule,
+			   partition.targetMachine.get(),
+			   partition.beginFunctionDefIndex,
+			   partition.endFunctionDefIndex,
+			   partition.tier,
+			   partition.meterFuel,
+			   partition.checkEpochDeadlines);
 
 	// Compile the LLVM IR to object code.
-	return compileLLVMModule(llvmContext, std::move(llvmModule), true, targetMachine.get());
+	partition.objectBytes = compileLLVMModule(llvmContext,
+											  std::move(llvmModule),
+											  false,
+											  partition.targetMachine.get(),
+											  partition.tier);
+}
+
+std::vector<U8> LLVMJIT::compileModule(const IR::Module& irModule,
+									   const TargetSpec& targetSpec,
+									   const CompileOptions& options)
+{
+	const Uptr numFunctionDefs = irModule.functions.defs.size();
+	const Uptr numPartitions = std::min(options.numThreads, numFunctionDefs);
+	if(numPartitions <= 1)
+	{
+		std::unique_ptr<llvm::TargetMachine> targetMachine
+			= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+
+		// Emit LLVM IR for the module.
+		LLVMContext llvmContext;
+		llvm::Module llvmModule("", llvmContext);
+		emitModule(irModule,
+				   llvmContext,
+				   llvmModule,
+				   targetMachine.get(),
+				   0,
+				   numFunctionDefs,
+				   options.tier,
+				   options.meterFuel,
+				   options.checkEpochDeadlines);
+
+		// Compile the LLVM IR to object code.
+		return compileLLVMModule(
+			llvmContext, std::move(llvmModule), true, targetMachine.get(), options.tier);
+	}
+
+	Timing::Timer compileTimer;
+
+	// Split the function definitions into contiguous partitions with roughly equal amounts of
+	// WebAssembly code.
+	Uptr numCodeBytes = 0;
+	for(const FunctionDef& functionDef : irModule.functions.defs)
+	{ numCodeBytes += functionDef.code.size() + 1; }
+
+	std::vector<CompilePartition> partitions;
+	Uptr functionDefIndex = 0;
+	Uptr numPartitionedCodeBytes = 0;
+	for(Uptr partitionIndex = 0; partitionIndex < numPartitions; ++partitionIndex)
+	{
+		// Each partition gets at least one function definition, and leaves at least one function
+		// definition for each subsequent partition.
+		const Uptr numRemainingPartitions = numPartitions - partitionIndex - 1;
+		const Uptr partitionEndCodeBytes = numCodeBytes * (partitionIndex + 1) / numPartitions;
+
+		CompilePartition partition;
+		partition.tier = options.tier;
+		partition.meterFuel = options.meterFuel;
+		partition.checkEpochDeadlines = options.checkEpochDeadlines;
+		partition.beginFunctionDefIndex = functionDefIndex;
+		do
+		{
+			numPartitionedCodeBytes += irModule.functions.defs[functionDefIndex].code.size() + 1;
+			++functionDefIndex;
+		} while(functionDefIndex < numFunctionDefs - numRemainingPartitions
+				&& numPartitionedCodeBytes < partitionEndCodeBytes);
+		partition.endFunctionDefIndex = functionDefIndex;
+
+		// Create a target machine for each partition, since a target machine may not be used by
+		// multiple threads concurrently.
+		partition.targetMachine = getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+
+		partitions.push_back(std::move(partition));
+	}
+	WAVM_ASSERT(functionDefIndex == numFunctionDefs);
+
+	// Compile the partitions on the worker pool.
+	Platform::runParallelJobs(numPartitions, numPartitions, [&](Uptr partitionIndex) {
+		compilePartition(irModule, partitions[partitionIndex]);
+	});
+
+	// Combine the partitions' object files.
+	std::vector<ObjectFileBytes> objectFiles;
+	for(const CompilePartition& partition : partitions)
+	{ objectFiles.push_back({partition.objectBytes.data(), partition.objectBytes.size()}); }
+
+	Timing::logRatePerSecond(
+		"Compiled module partitions", compileTimer, (F64)numFunctionDefs, "functions");
+
+	return packObjectFiles(objectFiles);
+}
+
+std::vector<U8> LLVMJIT::compileModulePartition(const IR::Module& irModule,
+												const TargetSpec& targetSpec,
+												Uptr beginFunctionDefIndex,
+												Uptr endFunctionDefIndex,
+												CompileTier tier,
+												bool meterFuel,
+												bool checkEpochDeadlines)
+{
+	WAVM_ASSERT(beginFunctionDefIndex <= endFunctionDefIndex);
+	WAVM_ASSERT(endFunctionDefIndex <= irModule.functions.defs.size());
+
+	CompilePartition partition;
+	partition.tier = tier;
+	partition.meterFuel = meterFuel;
+	partition.checkEpochDeadlines = checkEpochDeadlines;
+	partition.beginFunctionDefIndex = beginFunctionDefIndex;
+	partition.endFunctionDefIndex = endFunctionDefIndex;
+	partition.targetMachine = getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+	compilePartition(irModule, partition);
+	return std::move(partition.objectBytes);
+}
+
+std::vector<U8> LLVMJIT::linkModulePartitions(
+	const std::vector<ObjectFileBytes>& partitionObjectFiles)
+{
+	// A single partition's object file can be loaded directly.
+	WAVM_ASSERT(partitionObjectFiles.size());
+	if(partitionObjectFiles.size() == 1)
+	{
+		const ObjectFileBytes& objectFile = partitionObjectFiles[0];
+		return std::vector<U8>(objectFile.bytes, objectFile.bytes + objectFile.numBytes);
+	}
+	return packObjectFiles(partitionObjectFiles);
 }
 
 std::string LLVMJIT::emitLLVMIR(const IR::Module& irModule,
@@ -218,7 +392,15 @@ std::string LLVMJIT::emitLLVMIR(const IR::Module& irModule,
 	// Emit LLVM IR for the module.
 	LLVMContext llvmContext;
 	llvm::Module llvmModule("", llvmContext);
-	emitModule(irModule, llvmContext, llvmModule, targetMachine.get());
+	emitModule(irModule,
+			   llvmContext,
+			   llvmModule,
+			   targetMachine.get(),
+			   0,
+			   irModule.functions.defs.size(),
+			   CompileTier::optimized,
+			   false,
+			   false);
 
 	// Optimize the LLVM IR.
 	if(optimize) { optimizeLLVMModule(llvmModule, true); }
@@ -226,3 +408,30 @@ std::string LLVMJIT::emitLLVMIR(const IR::Module& irModule,
 	// Print the LLVM IR.
 	return printModule(llvmModule);
 }
+
+std::vector<U8> LLVMJIT::compileTierUpFunction(const IR::Module& irModule,
+											   const TargetSpec& targetSpec,
+											   Uptr functionDefIndex,
+											   bool meterFuel,
+											   bool checkEpochDeadlines)
+{
+	std::unique_ptr<llvm::TargetMachine> targetMachine
+		= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+
+	// Emit LLVM IR for the function. The module's other functions are declared as external
+	// functions that will be bound to their baseline-tier code.
+	LLVMContext llvmContext;
+	llvm::Module llvmModule("", llvmContext);
+	emitModule(irModule,
+			   llvmContext,
+			   llvmModule,
+			   targetMachine.get(),
+			   functionDefIndex,
+			   functionDefIndex + 1,
+			   CompileTier::optimized,
+			   meterFuel,
+			   checkEpochDeadlines);
+
+	// Compile the LLVM IR to object code.
+	return compileLLVMModule(llvmContext, std::move(llvmModule), false, targetMachine.get());
+}
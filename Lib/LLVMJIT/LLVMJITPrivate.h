@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <cctype>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "WAVM/IR/Module.h"
@@ -301,12 +304,15 @@ namespace WAVM { namespace LLVMJIT {
 		{
 			auto attrs = function->getAttributes();
 
-			// LLVM 9+ has a more general purpose frame-pointer=(all|non-leaf|none) attribute that
-			// WAVM should use once we can depend on it.
+			// Keep the frame pointer in all functions, so the profiler's signal handler can walk
+			// the stack by following frame pointers. LLVM 9+ replaced no-frame-pointer-elim with
+			// frame-pointer=(all|non-leaf|none), so set both.
 			attrs = attrs.addAttribute(function->getContext(),
 									   llvm::AttributeList::FunctionIndex,
 									   "no-frame-pointer-elim",
 									   "true");
+			attrs = attrs.addAttribute(
+				function->getContext(), llvm::AttributeList::FunctionIndex, "frame-pointer", "all");
 
 			// Set the probe-stack attribute: this will cause functions that allocate more than a
 			// page of stack space to call the wavm_probe_stack function defined in POSIX.S
@@ -346,11 +352,18 @@ namespace WAVM { namespace LLVMJIT {
 #endif
 	}
 
-	// Emits LLVM IR for a module.
+	// Emits LLVM IR for a module. Only the function definitions in the range
+	// [beginFunctionDefIndex, endFunctionDefIndex) are emitted; the rest are declared as external
+	// functions.
 	void emitModule(const IR::Module& irModule,
 					LLVMContext& llvmContext,
 					llvm::Module& outLLVMModule,
-					llvm::TargetMachine* targetMachine);
+					llvm::TargetMachine* targetMachine,
+					Uptr beginFunctionDefIndex,
+					Uptr endFunctionDefIndex,
+					CompileTier tier,
+					bool meterFuel,
+					bool checkEpochDeadlines);
 
 	// Used to override LLVM's default behavior of looking up unresolved symbols in DLL exports.
 	llvm::JITEvaluatedSymbol resolveJITImport(llvm::StringRef name);
@@ -358,22 +371,110 @@ namespace WAVM { namespace LLVMJIT {
 	struct ModuleMemoryManager;
 	struct GlobalModuleState;
 
+	// A compact map from offsets in a function's code to the index of the WebAssembly op that the
+	// code at each offset was generated for. The entries are sorted by offset, and each entry is
+	// encoded as the LEB128 differences between its offset and op index and those of the previous
+	// entry.
+	struct OffsetToOpIndexTable
+	{
+		// Creates the table from (offset, op index) pairs. If multiple pairs have the same offset,
+		// the first is used.
+		OffsetToOpIndexTable(std::vector<std::pair<U32, U32>>&& entries);
+
+		// Returns the op index of the last entry whose offset is <= the given offset, or 0 if
+		// there is no such entry.
+		Uptr getOpIndex(U32 offset) const;
+
+		// Returns the table's (offset, op index) pairs, sorted by offset.
+		std::vector<std::pair<U32, U32>> getEntries() const;
+
+	private:
+		std::vector<U8> encodedEntries;
+	};
+
+	struct ObjectCodeInfo
+	{
+		// A function defined by an object file: its symbol name, the ordinal of the section that
+		// contains it, its offset within that section, and the size of its code. Without
+		// LAZY_PARSE_DWARF_LINE_INFO, the DWARF line info isn't available after the object is
+		// loaded, so its offset to op index table is built when the object is parsed.
+		struct FunctionInfo
+		{
+			std::string name;
+			Uptr sectionOrdinal;
+			Uptr sectionOffset;
+			Uptr numCodeBytes;
+#if !LAZY_PARSE_DWARF_LINE_INFO
+			std::shared_ptr<const OffsetToOpIndexTable> offsetToOpIndexTable;
+#endif
+		};
+
+		Platform::Mutex mutex;
+		bool isInitialized = false;
+		std::vector<std::vector<FunctionInfo>> objectFunctions;
+	};
+
 	// Encapsulates a loaded module.
 	struct Module
 	{
 		HashMap<std::string, Runtime::Function*> nameToFunctionMap;
-		std::map<Uptr, Runtime::Function*> addressToFunctionMap;
+
+		// The module's functions, sorted by the end address of their code. The array isn't
+		// modified after the module is loaded, so it may be searched without locking.
+		struct FunctionCodeRange
+		{
+			Uptr endAddress;
+			Runtime::Function* function;
+
+			// The function's offset to op index table, or null if it hasn't been built. With
+			// LAZY_PARSE_DWARF_LINE_INFO, the table is built from the DWARF line info the first
+			// time an address in the function is looked up. Otherwise, the tables are built when
+			// the object code is first loaded, and shared by all modules that load it. Once set,
+			// it isn't changed, so it may be read without locking.
+			std::atomic<const OffsetToOpIndexTable*> offsetToOpIndexTable{nullptr};
+		};
+		std::unique_ptr<FunctionCodeRange[]> functionCodeRanges;
+		Uptr numFunctionCodeRanges = 0;
 
 #if LAZY_PARSE_DWARF_LINE_INFO
+		// The DWARF context for each of the module's images, and the end address of each image.
 		Platform::Mutex dwarfContextMutex;
-		std::unique_ptr<llvm::DWARFContext> dwarfContext;
+		std::vector<std::unique_ptr<llvm::DWARFContext>> dwarfContexts;
+		std::vector<Uptr> imageEndAddresses;
 #endif
 
-		Module(const std::vector<U8>& inObjectBytes,
-			   const HashMap<std::string, Uptr>& importedSymbolMap,
-			   bool shouldLogMetrics);
+		// The symbol bindings the module was loaded with, which are reused to load tier-up code
+		// for the module.
+		const HashMap<std::string, Uptr> importedSymbolMap;
+
+		// Optimized-tier code loaded for functions in this module by loadTierUpCode.
+		Platform::Mutex tierUpModulesMutex;
+		std::vector<std::unique_ptr<Module>> tierUpModules;
+
+		// Tier-up code shares its functions' FunctionMutableData with the baseline-tier code.
+		const bool isTierUpCode;
+
+		// Owns the tables referenced by functionCodeRanges. Protected by
+		// offsetToOpIndexTablesMutex, which also serializes building tables.
+		Platform::Mutex offsetToOpIndexTablesMutex;
+		std::vector<std::shared_ptr<const OffsetToOpIndexTable>> ownedOffsetToOpIndexTables;
+
+		Module(const U8* inObjectBytes,
+			   Uptr numObjectBytes,
+			   const HashMap<std::string, Uptr>& inImportedSymbolMap,
+			   bool shouldLogMetrics,
+			   bool inIsTierUpCode = false,
+			   ObjectCodeInfo* objectCodeInfo = nullptr);
 		~Module();
 
+		// Returns the offset to op index table for one of the module's functions, building it if
+		// necessary. Returns null if the table isn't available.
+		const OffsetToOpIndexTable* getOffsetToOpIndexTable(FunctionCodeRange& functionCodeRange);
+
+		// Returns the number of bytes of memory committed for the module's loaded sections, not
+		// including its tier-up code.
+		Uptr getNumLoadedBytes() const;
+
 	private:
 		ModuleMemoryManager* memoryManager;
 
@@ -381,14 +482,31 @@ namespace WAVM { namespace LLVMJIT {
 		// destructed until after all Modules have been destructed.
 		std::shared_ptr<GlobalModuleState> globalModuleState;
 
-		// Have to keep copies of these around because until LLVM 8, GDB registration listener uses
-		// their pointers as keys for deregistration.
+		// The object files loaded for the module. Until LLVM 8, the GDB registration listener uses
+		// their pointers as keys for deregistration, so they and a copy of the object bytes must
+		// be kept around. Later versions use the image base addresses as keys, so the object
+		// bytes aren't referenced after the module is loaded.
 #if LLVM_VERSION_MAJOR < 8
 		std::vector<U8> objectBytes;
-		std::unique_ptr<llvm::object::ObjectFile> object;
+		std::vector<std::unique_ptr<llvm::object::ObjectFile>> objects;
 #endif
 	};
 
+	// Object code for a module that was compiled in multiple partitions is a container of the
+	// partitions' object files: objectContainerMagic, followed by a U64 number of object files,
+	// followed by each object file prefixed by its U64 size in bytes.
+	static constexpr U8 objectContainerMagic[8] = {'W', 'A', 'V', 'M', 'O', 'B', 'J', 'S'};
+
+	std::vector<U8> packObjectFiles(const std::vector<ObjectFileBytes>& objectFiles);
+
+	// Returns the object files contained in some object code. If the object code isn't a container
+	// of multiple object files, returns the object code as a single object file.
+	std::vector<llvm::StringRef> unpackObjectFiles(const U8* objectCode, Uptr numObjectCodeBytes);
+
+	// Writes the functions of a module that was just loaded to the perf map files enabled by
+	// enablePerfMap.
+	void addFunctionsToPerfMaps(Module& module);
+
 	extern std::unique_ptr<llvm::TargetMachine> getTargetMachine(const TargetSpec& targetSpec);
 	extern TargetValidationResult validateTargetMachine(
 		const std::unique_ptr<llvm::TargetMachine>& targetMachine,
@@ -397,7 +515,8 @@ namespace WAVM { namespace LLVMJIT {
 	extern std::vector<U8> compileLLVMModule(LLVMContext& llvmContext,
 											 llvm::Module&& llvmModule,
 											 bool shouldLogMetrics,
-											 llvm::TargetMachine* targetMachine);
+											 llvm::TargetMachine* targetMachine,
+											 CompileTier tier = CompileTier::optimized);
 
 	extern void processSEHTables(U8* imageBase,
 								 const llvm::LoadedObjectInfo& loadedObject,
@@ -1,6 +1,10 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <string>
@@ -15,13 +19,15 @@
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/LEB128.h"
+#include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
-#include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Platform/Signal.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
@@ -61,14 +67,53 @@ namespace WAVM { namespace Runtime {
 using namespace WAVM;
 using namespace WAVM::LLVMJIT;
 
+// Counts the modules that have been loaded, to give each module a different load number.
+static std::atomic<U64> numLoadedModules{0};
+
+// The GlobalModuleState, for lookups from signal handlers, which can't initialize it. It is null
+// before the GlobalModuleState is created, and after it is destroyed.
+static std::atomic<GlobalModuleState*> signalSafeGlobalModuleState{nullptr};
+
 struct LLVMJIT::GlobalModuleState
 {
 	Platform::Mutex gdbRegistrationListenerMutex;
 	llvm::JITEventListener* gdbRegistrationListener = nullptr;
 
-	// A map from address to loaded JIT symbols.
-	Platform::RWMutex addressToModuleMapMutex;
-	std::map<Uptr, LLVMJIT::Module*> addressToModuleMap;
+	// An immutable index of the address ranges of the loaded modules' images, sorted by end
+	// address. Loading or unloading a module publishes a new index, so lookups never lock.
+	struct ImageRange
+	{
+		Uptr beginAddress;
+		Uptr endAddress;
+		LLVMJIT::Module* module;
+		U64 moduleLoadNumber;
+	};
+	typedef std::vector<ImageRange> ImageIndex;
+	std::atomic<const ImageIndex*> imageIndex{nullptr};
+
+	// Lookups and ModuleUnloadGuards are counted as readers in the slot for the current reader
+	// epoch. Readers that start after the epoch is advanced see the indices published before it
+	// was advanced, so once the readers counted in an epoch's slot have finished, the indices
+	// replaced before the next epoch can't be in use.
+	//
+	// Removing a module's images advances the epoch, and waits for the readers in both slots to
+	// finish, so once a module has been removed from the index, no reader can still be using it.
+	// Adding images doesn't wait for readers: the replaced index is retired, and deleted once the
+	// epoch can be advanced without waiting.
+	std::atomic<Uptr> readerEpoch{0};
+	std::atomic<Uptr> numReaders[2]{{0}, {0}};
+
+	// Serializes updates to imageIndex, and protects retiredImageIndices.
+	Platform::Mutex imageIndexUpdateMutex;
+
+	// The indices that have been replaced, but may still be in use by readers, with the epoch that
+	// they were replaced in.
+	struct RetiredImageIndex
+	{
+		const ImageIndex* imageIndex;
+		Uptr epoch;
+	};
+	std::vector<RetiredImageIndex> retiredImageIndices;
 
 	static const std::shared_ptr<GlobalModuleState>& get()
 	{
@@ -81,61 +126,208 @@ struct LLVMJIT::GlobalModuleState
 	GlobalModuleState()
 	{
 		gdbRegistrationListener = llvm::JITEventListener::createGDBRegistrationListener();
+		signalSafeGlobalModuleState.store(this, std::memory_order_seq_cst);
+	}
+	~GlobalModuleState()
+	{
+		signalSafeGlobalModuleState.store(nullptr, std::memory_order_seq_cst);
+		delete gdbRegistrationListener;
+
+		WAVM_ASSERT(!numReaders[0].load(std::memory_order_seq_cst));
+		WAVM_ASSERT(!numReaders[1].load(std::memory_order_seq_cst));
+		delete imageIndex.load(std::memory_order_seq_cst);
+		for(const RetiredImageIndex& retiredImageIndex : retiredImageIndices)
+		{ delete retiredImageIndex.imageIndex; }
+	}
+
+	// Adds or removes the address ranges of a module's images, and publishes the new index.
+	void addImages(const std::vector<ImageRange>& imageRanges)
+	{
+		Platform::Mutex::Lock imageIndexUpdateLock(imageIndexUpdateMutex);
+		const ImageIndex* oldImageIndex = imageIndex.load(std::memory_order_seq_cst);
+		ImageIndex* newImageIndex = oldImageIndex ? new ImageIndex(*oldImageIndex) : new ImageIndex;
+		newImageIndex->insert(newImageIndex->end(), imageRanges.begin(), imageRanges.end());
+		std::sort(newImageIndex->begin(),
+				  newImageIndex->end(),
+				  [](const ImageRange& left, const ImageRange& right) {
+					  return left.endAddress < right.endAddress;
+				  });
+		publishImageIndex(newImageIndex, false);
+	}
+	void removeImages(LLVMJIT::Module* module)
+	{
+		Platform::Mutex::Lock imageIndexUpdateLock(imageIndexUpdateMutex);
+		const ImageIndex* oldImageIndex = imageIndex.load(std::memory_order_seq_cst);
+		WAVM_ASSERT(oldImageIndex);
+		ImageIndex* newImageIndex = new ImageIndex;
+		for(const ImageRange& imageRange : *oldImageIndex)
+		{
+			if(imageRange.module != module) { newImageIndex->push_back(imageRange); }
+		}
+		publishImageIndex(newImageIndex, true);
+	}
+
+	// Counts a reader in the slot for the current epoch, and returns the slot's index.
+	Uptr beginRead()
+	{
+		while(true)
+		{
+			// If the epoch advanced before the reader was counted, the writer that advanced it
+			// may not have seen the reader, so count it in the new epoch's slot instead.
+			const Uptr epoch = readerEpoch.load(std::memory_order_seq_cst);
+			const Uptr slotIndex = epoch & 1;
+			numReaders[slotIndex].fetch_add(1, std::memory_order_seq_cst);
+			if(readerEpoch.load(std::memory_order_seq_cst) == epoch) { return slotIndex; }
+			numReaders[slotIndex].fetch_sub(1, std::memory_order_seq_cst);
+		}
+	}
+	void endRead(Uptr slotIndex) { numReaders[slotIndex].fetch_sub(1, std::memory_order_seq_cst); }
+
+	// Finds the image that contains an address, without locking. The caller must be counted as a
+	// reader while it uses the image's module.
+	const ImageRange* getImageRangeByAddress(Uptr address)
+	{
+		const ImageIndex* currentImageIndex = imageIndex.load(std::memory_order_seq_cst);
+		if(!currentImageIndex) { return nullptr; }
+
+		auto imageIt = std::upper_bound(
+			currentImageIndex->begin(),
+			currentImageIndex->end(),
+			address,
+			[](Uptr address, const ImageRange& imageRange) {
+				return address < imageRange.endAddress;
+			});
+		if(imageIt == currentImageIndex->end() || address < imageIt->beginAddress)
+		{ return nullptr; }
+		return &*imageIt;
+	}
+	LLVMJIT::Module* getModuleByAddress(Uptr address)
+	{
+		const ImageRange* imageRange = getImageRangeByAddress(address);
+		return imageRange ? imageRange->module : nullptr;
+	}
+
+private:
+	void waitForReaders(Uptr slotIndex)
+	{
+		while(numReaders[slotIndex].load(std::memory_order_seq_cst))
+		{ Platform::yieldToAnotherThread(); }
+	}
+
+	// Publishes a new index, and retires the index it replaces. If waitForOldReaders is true,
+	// waits until no reader can be using any replaced index.
+	void publishImageIndex(const ImageIndex* newImageIndex, bool waitForOldReaders)
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(imageIndexUpdateMutex);
+		const ImageIndex* oldImageIndex
+			= imageIndex.exchange(newImageIndex, std::memory_order_seq_cst);
+
+		// Only this thread advances the epoch while imageIndexUpdateMutex is locked.
+		const Uptr epoch = readerEpoch.load(std::memory_order_seq_cst);
+		if(oldImageIndex) { retiredImageIndices.push_back({oldImageIndex, epoch}); }
+
+		// The epoch can be advanced once the readers counted in the next epoch's slot, which
+		// started two epochs ago, have finished. A reader that counts itself in that slot after
+		// it was checked will see that the epoch isn't the one it read, and recount itself, so it
+		// doesn't need to be waited for.
+		const Uptr nextSlotIndex = (epoch + 1) & 1;
+		if(waitForOldReaders)
+		{
+			// Advance the epoch, and wait for the readers in the current epoch's slot, which may
+			// be using any retired index.
+			waitForReaders(nextSlotIndex);
+			readerEpoch.store(epoch + 1, std::memory_order_seq_cst);
+			waitForReaders(epoch & 1);
+
+			for(const RetiredImageIndex& retiredImageIndex : retiredImageIndices)
+			{ delete retiredImageIndex.imageIndex; }
+			retiredImageIndices.clear();
+		}
+		else if(!numReaders[nextSlotIndex].load(std::memory_order_seq_cst))
+		{
+			// Advance the epoch without waiting. The readers in the current epoch's slot may still
+			// be using the indices retired in the current epoch, but the indices retired in
+			// earlier epochs could only be used by readers that have finished.
+			readerEpoch.store(epoch + 1, std::memory_order_seq_cst);
+
+			Uptr numRemainingIndices = 0;
+			for(const RetiredImageIndex& retiredImageIndex : retiredImageIndices)
+			{
+				if(retiredImageIndex.epoch < epoch) { delete retiredImageIndex.imageIndex; }
+				else
+				{
+					retiredImageIndices[numRemainingIndices++] = retiredImageIndex;
+				}
+			}
+			retiredImageIndices.resize(numRemainingIndices);
+		}
 	}
-	~GlobalModuleState() { delete gdbRegistrationListener; }
 };
 
-// Allocates memory for the LLVM object loader.
+ModuleUnloadGuard::ModuleUnloadGuard()
+: globalModuleState(GlobalModuleState::get())
+, readerSlotIndex(globalModuleState->beginRead())
+{
+}
+
+ModuleUnloadGuard::~ModuleUnloadGuard() { globalModuleState->endRead(readerSlotIndex); }
+
+U64 LLVMJIT::getModuleLoadNumberByAddress(Uptr address)
+{
+	// Only atomic operations are used, so this may be called from a signal handler. The reader
+	// slot keeps the image index from being deleted while it is used.
+	GlobalModuleState* globalModuleState
+		= signalSafeGlobalModuleState.load(std::memory_order_seq_cst);
+	if(!globalModuleState) { return 0; }
+
+	const Uptr readerSlotIndex = globalModuleState->beginRead();
+	const GlobalModuleState::ImageRange* imageRange
+		= globalModuleState->getImageRangeByAddress(address);
+	const U64 moduleLoadNumber = imageRange ? imageRange->moduleLoadNumber : 0;
+	globalModuleState->endRead(readerSlotIndex);
+	return moduleLoadNumber;
+}
+
+// Allocates memory for the LLVM object loader. Each object file loaded by the loader is allocated
+// a separate image that contains its code, read-only data, and read-write data sections.
 struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 {
-	ModuleMemoryManager()
-	: imageBaseAddress(nullptr)
-	, isFinalized(false)
-	, codeSection({nullptr, 0, 0})
-	, readOnlySection({nullptr, 0, 0})
-	, readWriteSection({nullptr, 0, 0})
-	, hasRegisteredEHFrames(false)
-	{
-	}
+	ModuleMemoryManager() : isFinalized(false) {}
 	virtual ~ModuleMemoryManager() override
 	{
 		// Deregister the exception handling frame info.
 		deregisterEHFrames();
 
-		if(!KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED)
-		{ Platform::freeVirtualPages(imageBaseAddress, numAllocatedImagePages); }
-		else
+		for(std::unique_ptr<Image>& imagePointer : images)
 		{
-			// Decommit the image pages, but leave them reserved to catch any references to them
-			// that might erroneously remain.
-			Platform::decommitVirtualPages(imageBaseAddress, numAllocatedImagePages);
+			Image& image = *imagePointer;
+			if(!image.numPages) { continue; }
+			if(!KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED)
+			{ Platform::freeVirtualPages(image.baseAddress, image.numPages); }
+			else
+			{
+				// Decommit the image pages, but leave them reserved to catch any references to
+				// them that might erroneously remain.
+				Platform::decommitVirtualPages(image.baseAddress, image.numPages);
+			}
 		}
 	}
 
 	void registerEHFrames(U8* addr, U64 loadAddr, uintptr_t numBytes) override
 	{
-		if(!USE_WINDOWS_SEH)
-		{
-			Platform::registerEHFrames(imageBaseAddress, addr, numBytes);
-			hasRegisteredEHFrames = true;
-			ehFramesAddr = addr;
-			ehFramesNumBytes = numBytes;
-		}
+		if(!USE_WINDOWS_SEH) { registerFixedSEHFrames(addr, numBytes); }
 	}
 	void registerFixedSEHFrames(U8* addr, Uptr numBytes)
 	{
+		const U8* imageBaseAddress = getImageBaseAddress(getImageIndexByAddress(addr));
 		Platform::registerEHFrames(imageBaseAddress, addr, numBytes);
-		hasRegisteredEHFrames = true;
-		ehFramesAddr = addr;
-		ehFramesNumBytes = numBytes;
+		ehFrames.push_back({imageBaseAddress, addr, numBytes});
 	}
 	void deregisterEHFrames() override
 	{
-		if(hasRegisteredEHFrames)
-		{
-			hasRegisteredEHFrames = false;
-			Platform::deregisterEHFrames(imageBaseAddress, ehFramesAddr, ehFramesNumBytes);
-		}
+		for(const EHFrames& frames : ehFrames)
+		{ Platform::deregisterEHFrames(frames.imageBaseAddress, frames.addr, frames.numBytes); }
+		ehFrames.clear();
 	}
 
 	virtual bool needsToReserveAllocationSpace() override { return true; }
@@ -146,6 +338,13 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 										uintptr_t numReadWriteBytes,
 										U32 readWriteAlignment) override
 	{
+		WAVM_ASSERT(!isFinalized);
+
+		// reserveAllocationSpace is called once for each object file before allocating its
+		// sections, so create a new image for the object file's sections.
+		images.emplace_back(new Image);
+		Image& image = *images.back();
+
 		if(USE_WINDOWS_SEH)
 		{
 			// Pad the code section to allow for the SEH trampoline.
@@ -153,26 +352,27 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 		}
 
 		// Calculate the number of pages to be used by each section.
-		codeSection.numPages = shrAndRoundUp(numCodeBytes, Platform::getBytesPerPageLog2());
-		readOnlySection.numPages = shrAndRoundUp(numReadOnlyBytes, Platform::getBytesPerPageLog2());
-		readWriteSection.numPages
+		image.codeSection.numPages = shrAndRoundUp(numCodeBytes, Platform::getBytesPerPageLog2());
+		image.readOnlySection.numPages
+			= shrAndRoundUp(numReadOnlyBytes, Platform::getBytesPerPageLog2());
+		image.readWriteSection.numPages
 			= shrAndRoundUp(numReadWriteBytes, Platform::getBytesPerPageLog2());
-		numAllocatedImagePages
-			= codeSection.numPages + readOnlySection.numPages + readWriteSection.numPages;
-		if(numAllocatedImagePages)
+		image.numPages = image.codeSection.numPages + image.readOnlySection.numPages
+						 + image.readWriteSection.numPages;
+		if(image.numPages)
 		{
 			// Reserve enough contiguous pages for all sections.
-			imageBaseAddress = Platform::allocateVirtualPages(numAllocatedImagePages);
-			if(!imageBaseAddress
-			   || !Platform::commitVirtualPages(imageBaseAddress, numAllocatedImagePages))
+			image.baseAddress = Platform::allocateVirtualPages(image.numPages);
+			if(!image.baseAddress
+			   || !Platform::commitVirtualPages(image.baseAddress, image.numPages))
 			{ Errors::fatal("memory allocation for JIT code failed"); }
-			codeSection.baseAddress = imageBaseAddress;
-			readOnlySection.baseAddress
-				= codeSection.baseAddress
-				  + (codeSection.numPages << Platform::getBytesPerPageLog2());
-			readWriteSection.baseAddress
-				= readOnlySection.baseAddress
-				  + (readOnlySection.numPages << Platform::getBytesPerPageLog2());
+			image.codeSection.baseAddress = image.baseAddress;
+			image.readOnlySection.baseAddress
+				= image.codeSection.baseAddress
+				  + (image.codeSection.numPages << Platform::getBytesPerPageLog2());
+			image.readWriteSection.baseAddress
+				= image.readOnlySection.baseAddress
+				  + (image.readOnlySection.numPages << Platform::getBytesPerPageLog2());
 		}
 	}
 	virtual U8* allocateCodeSection(uintptr_t numBytes,
@@ -180,7 +380,9 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 									U32 sectionID,
 									llvm::StringRef sectionName) override
 	{
-		return allocateBytes(sectionName, (Uptr)numBytes, alignment, codeSection);
+		WAVM_ASSERT(images.size());
+		return allocateBytes(
+			sectionName, (Uptr)numBytes, alignment, *images.back(), images.back()->codeSection);
 	}
 	virtual U8* allocateDataSection(uintptr_t numBytes,
 									U32 alignment,
@@ -188,10 +390,22 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 									llvm::StringRef sectionName,
 									bool isReadOnly) override
 	{
+		WAVM_ASSERT(images.size());
+		Image& image = *images.back();
 		return allocateBytes(sectionName,
 							 (Uptr)numBytes,
 							 alignment,
-							 isReadOnly ? readOnlySection : readWriteSection);
+							 image,
+							 isReadOnly ? image.readOnlySection : image.readWriteSection);
+	}
+	U8* allocateCodeBytesInImage(Uptr imageIndex,
+								 Uptr numBytes,
+								 U32 alignment,
+								 llvm::StringRef sectionName)
+	{
+		WAVM_ASSERT(imageIndex < images.size());
+		Image& image = *images[imageIndex];
+		return allocateBytes(sectionName, numBytes, alignment, image, image.codeSection);
 	}
 	virtual bool finalizeMemory(std::string* ErrMsg = nullptr) override
 	{
@@ -204,23 +418,30 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 	{
 		WAVM_ASSERT(!isFinalized);
 		isFinalized = true;
-		if(codeSection.numPages)
-		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(codeSection.baseAddress,
-															 codeSection.numPages,
-															 Platform::MemoryAccess::readExecute));
-		}
-		if(readOnlySection.numPages)
+		for(std::unique_ptr<Image>& imagePointer : images)
 		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(readOnlySection.baseAddress,
-															 readOnlySection.numPages,
-															 Platform::MemoryAccess::readOnly));
-		}
-		if(readWriteSection.numPages)
-		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(readWriteSection.baseAddress,
-															 readWriteSection.numPages,
-															 Platform::MemoryAccess::readWrite));
+			const Image& image = *imagePointer;
+			if(image.codeSection.numPages)
+			{
+				WAVM_ERROR_UNLESS(
+					Platform::setVirtualPageAccess(image.codeSection.baseAddress,
+												   image.codeSection.numPages,
+												   Platform::MemoryAccess::readExecute));
+			}
+			if(image.readOnlySection.numPages)
+			{
+				WAVM_ERROR_UNLESS(
+					Platform::setVirtualPageAccess(image.readOnlySection.baseAddress,
+												   image.readOnlySection.numPages,
+												   Platform::MemoryAccess::readOnly));
+			}
+			if(image.readWriteSection.numPages)
+			{
+				WAVM_ERROR_UNLESS(
+					Platform::setVirtualPageAccess(image.readWriteSection.baseAddress,
+												   image.readWriteSection.numPages,
+												   Platform::MemoryAccess::readWrite));
+			}
 		}
 
 		// Invalidate the instruction cache.
@@ -228,45 +449,75 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 	}
 	virtual void invalidateInstructionCache()
 	{
-		// Invalidate the instruction cache for the whole image.
-		llvm::sys::Memory::InvalidateInstructionCache(
-			imageBaseAddress, numAllocatedImagePages << Platform::getBytesPerPageLog2());
+		// Invalidate the instruction cache for each image.
+		for(std::unique_ptr<Image>& image : images)
+		{
+			llvm::sys::Memory::InvalidateInstructionCache(
+				image->baseAddress, image->numPages << Platform::getBytesPerPageLog2());
+		}
 	}
 
-	U8* getImageBaseAddress() const { return imageBaseAddress; }
-	Uptr getNumImageBytes() const
+	Uptr getNumImages() const { return images.size(); }
+	U8* getImageBaseAddress(Uptr imageIndex) const { return images[imageIndex]->baseAddress; }
+	Uptr getNumImageBytes(Uptr imageIndex) const
+	{
+		return images[imageIndex]->numPages << Platform::getBytesPerPageLog2();
+	}
+	Uptr getImageIndexByAddress(const U8* address) const
 	{
-		return numAllocatedImagePages << Platform::getBytesPerPageLog2();
+		for(Uptr imageIndex = 0; imageIndex < images.size(); ++imageIndex)
+		{
+			const Image& image = *images[imageIndex];
+			if(address >= image.baseAddress
+			   && address < image.baseAddress + (image.numPages << Platform::getBytesPerPageLog2()))
+			{ return imageIndex; }
+		}
+		WAVM_UNREACHABLE();
 	}
 
-	const llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>>& getSectionNameToContentsMap() const
+	const llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>>& getSectionNameToContentsMap(
+		Uptr imageIndex) const
 	{
-		return sectionNameToContentsMap;
+		return images[imageIndex]->sectionNameToContentsMap;
 	}
 
 private:
 	struct Section
 	{
-		U8* baseAddress;
-		Uptr numPages;
-		Uptr numCommittedBytes;
+		U8* baseAddress = nullptr;
+		Uptr numPages = 0;
+		Uptr numCommittedBytes = 0;
 	};
 
-	U8* imageBaseAddress;
-	Uptr numAllocatedImagePages;
-	bool isFinalized;
+	struct Image
+	{
+		U8* baseAddress = nullptr;
+		Uptr numPages = 0;
 
-	Section codeSection;
-	Section readOnlySection;
-	Section readWriteSection;
+		Section codeSection;
+		Section readOnlySection;
+		Section readWriteSection;
+
+		llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> sectionNameToContentsMap;
+	};
 
-	bool hasRegisteredEHFrames;
-	const U8* ehFramesAddr;
-	Uptr ehFramesNumBytes;
+	struct EHFrames
+	{
+		const U8* imageBaseAddress;
+		const U8* addr;
+		Uptr numBytes;
+	};
+
+	std::vector<std::unique_ptr<Image>> images;
+	bool isFinalized;
 
-	llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> sectionNameToContentsMap;
+	std::vector<EHFrames> ehFrames;
 
-	U8* allocateBytes(llvm::StringRef sectionName, Uptr numBytes, Uptr alignment, Section& section)
+	U8* allocateBytes(llvm::StringRef sectionName,
+					  Uptr numBytes,
+					  Uptr alignment,
+					  Image& image,
+					  Section& section)
 	{
 		if(alignment == 0) { alignment = 1; }
 
@@ -293,7 +544,7 @@ private:
 		}
 
 		// Record the address the section was allocated at.
-		sectionNameToContentsMap.insert(std::make_pair(
+		image.sectionNameToContentsMap.insert(std::make_pair(
 			sectionName,
 			llvm::MemoryBuffer::getMemBuffer(
 				llvm::StringRef((const char*)allocationBaseAddress, numBytes), "", false)));
@@ -344,23 +595,201 @@ static void disassembleFunction(U8* bytes, Uptr numBytes)
 	LLVMDisasmDispose(disasmRef);
 }
 
-Module::Module(const std::vector<U8>& objectBytes,
-			   const HashMap<std::string, Uptr>& importedSymbolMap,
-			   bool shouldLogMetrics)
-: memoryManager(new ModuleMemoryManager())
+std::vector<llvm::StringRef> LLVMJIT::unpackObjectFiles(const U8* objectCode,
+														Uptr numObjectCodeBytes)
+{
+	std::vector<llvm::StringRef> objectFiles;
+	if(numObjectCodeBytes < sizeof(objectContainerMagic)
+	   || memcmp(objectCode, objectContainerMagic, sizeof(objectContainerMagic)))
+	{
+		// If the object code doesn't start with the container magic number, it is a single object
+		// file.
+		objectFiles.push_back(llvm::StringRef((const char*)objectCode, numObjectCodeBytes));
+		return objectFiles;
+	}
+
+	Uptr offset = sizeof(objectContainerMagic);
+	auto readU64 = [objectCode, numObjectCodeBytes, &offset]() {
+		WAVM_ERROR_UNLESS(offset + sizeof(U64) <= numObjectCodeBytes);
+		U64 result;
+		memcpy(&result, objectCode + offset, sizeof(U64));
+		offset += sizeof(U64);
+		return result;
+	};
+
+	const U64 numObjectFiles = readU64();
+	for(U64 objectFileIndex = 0; objectFileIndex < numObjectFiles; ++objectFileIndex)
+	{
+		const U64 numObjectFileBytes = readU64();
+		WAVM_ERROR_UNLESS(numObjectFileBytes <= numObjectCodeBytes - offset);
+		objectFiles.push_back(
+			llvm::StringRef((const char*)objectCode + offset, Uptr(numObjectFileBytes)));
+		offset += Uptr(numObjectFileBytes);
+	}
+	WAVM_ERROR_UNLESS(offset == numObjectCodeBytes);
+
+	return objectFiles;
+}
+
+OffsetToOpIndexTable::OffsetToOpIndexTable(std::vector<std::pair<U32, U32>>&& entries)
+{
+	std::stable_sort(
+		entries.begin(),
+		entries.end(),
+		[](const std::pair<U32, U32>& left, const std::pair<U32, U32>& right) {
+			return left.first < right.first;
+		});
+
+	Serialization::ArrayOutputStream stream;
+	U32 previousOffset = 0;
+	U32 previousOpIndex = 0;
+	bool isFirstEntry = true;
+	for(const std::pair<U32, U32>& entry : entries)
+	{
+		if(!isFirstEntry && entry.first == previousOffset) { continue; }
+		isFirstEntry = false;
+
+		U32 offsetDelta = entry.first - previousOffset;
+		I32 opIndexDelta = I32(entry.second - previousOpIndex);
+		serializeVarUInt32(stream, offsetDelta);
+		serializeVarInt32(stream, opIndexDelta);
+		previousOffset = entry.first;
+		previousOpIndex = entry.second;
+	}
+	encodedEntries = stream.getBytes();
+	encodedEntries.shrink_to_fit();
+}
+
+Uptr OffsetToOpIndexTable::getOpIndex(U32 offset) const
+{
+	Serialization::MemoryInputStream stream(encodedEntries.data(), encodedEntries.size());
+	U32 entryOffset = 0;
+	U32 entryOpIndex = 0;
+	Uptr opIndex = 0;
+	while(stream.capacity())
+	{
+		U32 offsetDelta;
+		I32 opIndexDelta;
+		serializeVarUInt32(stream, offsetDelta);
+		serializeVarInt32(stream, opIndexDelta);
+		entryOffset += offsetDelta;
+		entryOpIndex += U32(opIndexDelta);
+		if(entryOffset > offset) { break; }
+		opIndex = entryOpIndex;
+	};
+	return opIndex;
+}
+
+std::vector<std::pair<U32, U32>> OffsetToOpIndexTable::getEntries() const
+{
+	std::vector<std::pair<U32, U32>> entries;
+	Serialization::MemoryInputStream stream(encodedEntries.data(), encodedEntries.size());
+	U32 entryOffset = 0;
+	U32 entryOpIndex = 0;
+	while(stream.capacity())
+	{
+		U32 offsetDelta;
+		I32 opIndexDelta;
+		serializeVarUInt32(stream, offsetDelta);
+		serializeVarInt32(stream, opIndexDelta);
+		entryOffset += offsetDelta;
+		entryOpIndex += U32(opIndexDelta);
+		entries.emplace_back(entryOffset, entryOpIndex);
+	};
+	return entries;
+}
+
+// Finds the functions defined by a loaded object file, and their offset to op index tables.
+static void parseObjectFunctions(const llvm::object::ObjectFile& object,
+								 const llvm::RuntimeDyld::LoadedObjectInfo& loadedObject,
+								 std::vector<ObjectCodeInfo::FunctionInfo>& outFunctions)
+{
+#if !LAZY_PARSE_DWARF_LINE_INFO
+	// Create a DWARF context to interpret the debug information in this compilation unit.
+	auto dwarfContext = llvm::DWARFContext::create(object, &loadedObject);
+#endif
+
+	for(std::pair<llvm::object::SymbolRef, U64> symbolSizePair :
+		llvm::object::computeSymbolSizes(object))
+	{
+		llvm::object::SymbolRef symbol = symbolSizePair.first;
+
+		// Only process global symbols, which excludes SEH funclets.
+		if(!(symbol.getFlags() & llvm::object::SymbolRef::SF_Global)) { continue; }
+
+		// Get the type, name, and address of the symbol. Need to be careful not to get the
+		// Expected<T> for each value unless it will be checked for success before continuing.
+		llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
+		if(!type || *type != llvm::object::SymbolRef::ST_Function) { continue; }
+		llvm::Expected<llvm::StringRef> name = symbol.getName();
+		if(!name) { continue; }
+		llvm::Expected<U64> address = symbol.getAddress();
+		if(!address) { continue; }
+
+		// Only process symbols defined by this object, which excludes the declarations of
+		// functions defined by other partitions of the module.
+		llvm::Expected<llvm::object::section_iterator> symbolSection = symbol.getSection();
+		if(!symbolSection || *symbolSection == object.section_end()) { continue; }
+
+		WAVM_ASSERT(*address <= UINTPTR_MAX);
+		WAVM_ASSERT(symbolSizePair.second <= UINTPTR_MAX);
+		ObjectCodeInfo::FunctionInfo functionInfo;
+		functionInfo.name = name->str();
+		functionInfo.sectionOrdinal
+			= Uptr(std::distance(object.section_begin(), symbolSection.get()));
+		functionInfo.sectionOffset = Uptr(*address);
+		functionInfo.numCodeBytes = Uptr(symbolSizePair.second);
+
+#if !LAZY_PARSE_DWARF_LINE_INFO
+		// Get the DWARF line info for this symbol, which maps machine code addresses to
+		// WebAssembly op indices.
+		const Uptr loadedAddress
+			= Uptr(*address) + (Uptr)loadedObject.getSectionLoadAddress(*symbolSection.get());
+		llvm::DILineInfoTable lineInfoTable
+			= dwarfContext->getLineInfoForAddressRange(loadedAddress, symbolSizePair.second);
+		std::vector<std::pair<U32, U32>> offsetToOpIndexEntries;
+		for(auto lineInfo : lineInfoTable)
+		{
+			offsetToOpIndexEntries.emplace_back(U32(lineInfo.first - loadedAddress),
+												lineInfo.second.Line);
+		}
+		functionInfo.offsetToOpIndexTable
+			= std::make_shared<const OffsetToOpIndexTable>(std::move(offsetToOpIndexEntries));
+#endif
+
+		outFunctions.push_back(std::move(functionInfo));
+	}
+}
+
+Module::Module(const U8* inObjectBytes,
+			   Uptr numObjectBytes,
+			   const HashMap<std::string, Uptr>& inImportedSymbolMap,
+			   bool shouldLogMetrics,
+			   bool inIsTierUpCode,
+			   ObjectCodeInfo* objectCodeInfo)
+: importedSymbolMap(inImportedSymbolMap)
+, isTierUpCode(inIsTierUpCode)
+, memoryManager(new ModuleMemoryManager())
 , globalModuleState(GlobalModuleState::get())
 #if LLVM_VERSION_MAJOR < 8
-, objectBytes(objectBytes)
+, objectBytes(inObjectBytes, inObjectBytes + numObjectBytes)
 #endif
 {
 	Timing::Timer loadObjectTimer;
 
+	// Parse each object file in the object code. A module compiled in multiple partitions has an
+	// object file for each partition.
 #if LLVM_VERSION_MAJOR >= 8
-	std::unique_ptr<llvm::object::ObjectFile> object;
+	const U8* objectCode = inObjectBytes;
+	std::vector<std::unique_ptr<llvm::object::ObjectFile>> objects;
+#else
+	const U8* objectCode = objectBytes.data();
 #endif
-
-	object = cantFail(llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(
-		llvm::StringRef((const char*)objectBytes.data(), objectBytes.size()), "memory")));
+	for(llvm::StringRef objectFileBytes : unpackObjectFiles(objectCode, numObjectBytes))
+	{
+		objects.push_back(cantFail(llvm::object::ObjectFile::createObjectFile(
+			llvm::MemoryBufferRef(objectFileBytes, "memory"))));
+	}
 
 	// Create the LLVM object loader.
 	struct SymbolResolver : llvm::JITSymbolResolver
@@ -436,227 +865,333 @@ Module::Module(const std::vector<U8>& objectBytes,
 	// (https://github.com/llvm-mirror/llvm/blob/e84d8c12d5157a926db15976389f703809c49aa5/lib/ExecutionEngine/RuntimeDyld/Targets/RuntimeDyldCOFFX86_64.h#L96)
 	// Make a copy of those sections before they are clobbered, so we can do the fixup ourselves
 	// later.
-	llvm::object::SectionRef pdataSection;
-	U8* pdataCopy = nullptr;
-	Uptr pdataNumBytes = 0;
-	llvm::object::SectionRef xdataSection;
-	U8* xdataCopy = nullptr;
+	struct SEHSections
+	{
+		llvm::object::SectionRef pdataSection;
+		U8* pdataCopy = nullptr;
+		Uptr pdataNumBytes = 0;
+		llvm::object::SectionRef xdataSection;
+		U8* xdataCopy = nullptr;
+	};
+	std::vector<SEHSections> objectSEHSections(objects.size());
 	if(USE_WINDOWS_SEH)
 	{
-		for(auto section : object->sections())
+		for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
 		{
-			llvm::StringRef sectionName;
-			if(!section.getName(sectionName))
+			SEHSections& sehSections = objectSEHSections[objectIndex];
+			for(auto section : objects[objectIndex]->sections())
 			{
-#if LLVM_VERSION_MAJOR >= 9
-				llvm::Expected<llvm::StringRef> sectionContentsOrError = section.getContents();
-				if(sectionContentsOrError)
+				llvm::StringRef sectionName;
+				if(!section.getName(sectionName))
 				{
-					const llvm::StringRef& sectionContents = sectionContentsOrError.get();
-#else
-				llvm::StringRef sectionContents;
-				if(!section.getContents(sectionContents))
-				{
-#endif
-					const U8* loadedSection = (const U8*)sectionContents.data();
-					if(sectionName == ".pdata")
+#if LLVM_VERSION_MAJOR >= 9
+					llvm::Expected<llvm::StringRef> sectionContentsOrError = section.getContents();
+					if(sectionContentsOrError)
 					{
-						pdataCopy = new U8[section.getSize()];
-						pdataNumBytes = section.getSize();
-						pdataSection = section;
-						memcpy(pdataCopy, loadedSection, section.getSize());
-					}
-					else if(sectionName == ".xdata")
+						const llvm::StringRef& sectionContents = sectionContentsOrError.get();
+#else
+					llvm::StringRef sectionContents;
+					if(!section.getContents(sectionContents))
 					{
-						xdataCopy = new U8[section.getSize()];
-						xdataSection = section;
-						memcpy(xdataCopy, loadedSection, section.getSize());
+#endif
+						const U8* loadedSection = (const U8*)sectionContents.data();
+						if(sectionName == ".pdata")
+						{
+							sehSections.pdataCopy = new U8[section.getSize()];
+							sehSections.pdataNumBytes = section.getSize();
+							sehSections.pdataSection = section;
+							memcpy(sehSections.pdataCopy, loadedSection, section.getSize());
+						}
+						else if(sectionName == ".xdata")
+						{
+							sehSections.xdataCopy = new U8[section.getSize()];
+							sehSections.xdataSection = section;
+							memcpy(sehSections.xdataCopy, loadedSection, section.getSize());
+						}
 					}
 				}
 			}
 		}
 	}
 
-	// Use the LLVM object loader to load the object.
-	std::unique_ptr<llvm::RuntimeDyld::LoadedObjectInfo> loadedObject = loader.loadObject(*object);
+	// Use the LLVM object loader to load the objects. The loader resolves references between the
+	// objects when it is finalized, so all objects must be loaded before finalizing it.
+	std::vector<std::unique_ptr<llvm::RuntimeDyld::LoadedObjectInfo>> loadedObjects;
+	for(const std::unique_ptr<llvm::object::ObjectFile>& object : objects)
+	{
+		loadedObjects.push_back(loader.loadObject(*object));
+		WAVM_ASSERT(memoryManager->getNumImages() == loadedObjects.size());
+	}
 	loader.finalizeWithMemoryManagerLocking();
 	if(loader.hasError())
 	{ Errors::fatalf("RuntimeDyld failed: %s", loader.getErrorString().data()); }
 
-	if(USE_WINDOWS_SEH && pdataCopy)
+	for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
 	{
-		// Lookup the real address of _CxxFrameHandler3.
-		const llvm::JITEvaluatedSymbol sehHandlerSymbol = resolveJITImport("__CxxFrameHandler3");
-		WAVM_ERROR_UNLESS(sehHandlerSymbol);
-		const U64 sehHandlerAddress = U64(sehHandlerSymbol.getAddress());
-
-		// Create a trampoline within the image's 2GB address space that jumps to
-		// __CxxFrameHandler3. jmp [rip+0] <64-bit address>
-		U8* trampolineBytes = memoryManager->allocateCodeSection(16, 16, 0, "seh_trampoline");
-		trampolineBytes[0] = 0xff;
-		trampolineBytes[1] = 0x25;
-		memset(trampolineBytes + 2, 0, 4);
-		memcpy(trampolineBytes + 6, &sehHandlerAddress, sizeof(U64));
-
-		processSEHTables(memoryManager->getImageBaseAddress(),
-						 *loadedObject,
-						 pdataSection,
-						 pdataCopy,
-						 pdataNumBytes,
-						 xdataSection,
-						 xdataCopy,
-						 reinterpret_cast<Uptr>(trampolineBytes));
-
-		memoryManager->registerFixedSEHFrames(
-			reinterpret_cast<U8*>(Uptr(loadedObject->getSectionLoadAddress(pdataSection))),
-			pdataNumBytes);
-	}
+		SEHSections& sehSections = objectSEHSections[objectIndex];
+		if(USE_WINDOWS_SEH && sehSections.pdataCopy)
+		{
+			// Lookup the real address of _CxxFrameHandler3.
+			const llvm::JITEvaluatedSymbol sehHandlerSymbol
+				= resolveJITImport("__CxxFrameHandler3");
+			WAVM_ERROR_UNLESS(sehHandlerSymbol);
+			const U64 sehHandlerAddress = U64(sehHandlerSymbol.getAddress());
+
+			// Create a trampoline within the image's 2GB address space that jumps to
+			// __CxxFrameHandler3. jmp [rip+0] <64-bit address>
+			U8* trampolineBytes
+				= memoryManager->allocateCodeBytesInImage(objectIndex, 16, 16, "seh_trampoline");
+			trampolineBytes[0] = 0xff;
+			trampolineBytes[1] = 0x25;
+			memset(trampolineBytes + 2, 0, 4);
+			memcpy(trampolineBytes + 6, &sehHandlerAddress, sizeof(U64));
+
+			processSEHTables(memoryManager->getImageBaseAddress(objectIndex),
+							 *loadedObjects[objectIndex],
+							 sehSections.pdataSection,
+							 sehSections.pdataCopy,
+							 sehSections.pdataNumBytes,
+							 sehSections.xdataSection,
+							 sehSections.xdataCopy,
+							 reinterpret_cast<Uptr>(trampolineBytes));
+
+			memoryManager->registerFixedSEHFrames(
+				reinterpret_cast<U8*>(Uptr(
+					loadedObjects[objectIndex]->getSectionLoadAddress(sehSections.pdataSection))),
+				sehSections.pdataNumBytes);
+		}
 
-	// Free the copies of the Windows SEH sections created above.
-	if(pdataCopy)
-	{
-		delete[] pdataCopy;
-		pdataCopy = nullptr;
-	}
-	if(xdataCopy)
-	{
-		delete[] xdataCopy;
-		xdataCopy = nullptr;
+		// Free the copies of the Windows SEH sections created above.
+		if(sehSections.pdataCopy)
+		{
+			delete[] sehSections.pdataCopy;
+			sehSections.pdataCopy = nullptr;
+		}
+		if(sehSections.xdataCopy)
+		{
+			delete[] sehSections.xdataCopy;
+			sehSections.xdataCopy = nullptr;
+		}
 	}
 
 	// After having a chance to manually apply relocations for the pdata/xdata sections, apply the
 	// final non-writable memory permissions.
 	memoryManager->reallyFinalizeMemory();
 
-	// Notify GDB of the new object.
+	// Notify GDB of the new objects.
 	{
 		Platform::Mutex::Lock lock(globalModuleState->gdbRegistrationListenerMutex);
+		for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+		{
 #if LLVM_VERSION_MAJOR >= 8
-		globalModuleState->gdbRegistrationListener->notifyObjectLoaded(
-			reinterpret_cast<Uptr>(this), *object, *loadedObject);
+			globalModuleState->gdbRegistrationListener->notifyObjectLoaded(
+				reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress(objectIndex)),
+				*objects[objectIndex],
+				*loadedObjects[objectIndex]);
 #else
-		globalModuleState->gdbRegistrationListener->NotifyObjectEmitted(*object, *loadedObject);
+			globalModuleState->gdbRegistrationListener->NotifyObjectEmitted(
+				*objects[objectIndex], *loadedObjects[objectIndex]);
 #endif
+		}
+	}
+
+	// If a previous load of the same object code filled in the object code info, use it to find
+	// the functions defined by each object. Otherwise, parse each object's symbols and debug info
+	// to find them, and save the result in the object code info for later loads.
+	typedef std::vector<std::vector<ObjectCodeInfo::FunctionInfo>> ObjectFunctions;
+	ObjectFunctions parsedObjectFunctions;
+	const ObjectFunctions* objectFunctions = nullptr;
+	if(objectCodeInfo)
+	{
+		Platform::Mutex::Lock objectCodeInfoLock(objectCodeInfo->mutex);
+		if(objectCodeInfo->isInitialized) { objectFunctions = &objectCodeInfo->objectFunctions; }
+	}
+	if(!objectFunctions)
+	{
+		parsedObjectFunctions.resize(objects.size());
+		for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+		{
+			parseObjectFunctions(*objects[objectIndex],
+								 *loadedObjects[objectIndex],
+								 parsedObjectFunctions[objectIndex]);
+		}
+
+		objectFunctions = &parsedObjectFunctions;
+		if(objectCodeInfo)
+		{
+			// Once the object code info is initialized it isn't modified, so it may be read
+			// without holding its mutex.
+			Platform::Mutex::Lock objectCodeInfoLock(objectCodeInfo->mutex);
+			if(!objectCodeInfo->isInitialized)
+			{
+				objectCodeInfo->objectFunctions = std::move(parsedObjectFunctions);
+				objectCodeInfo->isInitialized = true;
+			}
+			objectFunctions = &objectCodeInfo->objectFunctions;
+		}
 	}
 
-	// Create a DWARF context to interpret the debug information in this compilation unit.
 #if LAZY_PARSE_DWARF_LINE_INFO
 	Platform::Mutex::Lock dwarfContextLock(dwarfContextMutex);
-	dwarfContext
-		= llvm::DWARFContext::create(memoryManager->getSectionNameToContentsMap(), sizeof(Uptr));
-#else
-	auto dwarfContext = llvm::DWARFContext::create(*object, &*loadedObject);
 #endif
 
-	// Iterate over the functions in the loaded object.
-	for(std::pair<llvm::object::SymbolRef, U64> symbolSizePair :
-		llvm::object::computeSymbolSizes(*object))
+	struct LoadedFunction
 	{
-		llvm::object::SymbolRef symbol = symbolSizePair.first;
+		Uptr endAddress;
+		Runtime::Function* function;
+		const OffsetToOpIndexTable* offsetToOpIndexTable;
+	};
+	std::vector<LoadedFunction> loadedFunctions;
+	for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+	{
+		const llvm::object::ObjectFile& object = *objects[objectIndex];
+		const llvm::RuntimeDyld::LoadedObjectInfo& loadedObject = *loadedObjects[objectIndex];
 
-		// Only process global symbols, which excludes SEH funclets.
-		if(!(symbol.getFlags() & llvm::object::SymbolRef::SF_Global)) { continue; }
+#if LAZY_PARSE_DWARF_LINE_INFO
+		// Create a DWARF context to interpret the debug information in this compilation unit.
+		imageEndAddresses.push_back(
+			reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress(objectIndex)
+								   + memoryManager->getNumImageBytes(objectIndex)));
+		dwarfContexts.push_back(llvm::DWARFContext::create(
+			memoryManager->getSectionNameToContentsMap(objectIndex), sizeof(Uptr)));
+#endif
 
-		// Get the type, name, and address of the symbol. Need to be careful not to get the
-		// Expected<T> for each value unless it will be checked for success before continuing.
-		llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
-		if(!type || *type != llvm::object::SymbolRef::ST_Function) { continue; }
-		llvm::Expected<llvm::StringRef> name = symbol.getName();
-		if(!name) { continue; }
-		llvm::Expected<U64> address = symbol.getAddress();
-		if(!address) { continue; }
+		// Index the object's sections by their ordinal, and iterate over the functions it defines.
+		std::vector<llvm::object::SectionRef> sections;
+		for(const llvm::object::SectionRef& section : object.sections())
+		{ sections.push_back(section); }
+		for(const ObjectCodeInfo::FunctionInfo& functionInfo : (*objectFunctions)[objectIndex])
+		{
+			// Compute the address the function was loaded at.
+			WAVM_ASSERT(functionInfo.sectionOrdinal < sections.size());
+			const Uptr loadedAddress
+				= functionInfo.sectionOffset
+				  + (Uptr)loadedObject.getSectionLoadAddress(sections[functionInfo.sectionOrdinal]);
 
-		// Compute the address the function was loaded at.
-		WAVM_ASSERT(*address <= UINTPTR_MAX);
-		Uptr loadedAddress = Uptr(*address);
-		if(llvm::Expected<llvm::object::section_iterator> symbolSection = symbol.getSection())
-		{ loadedAddress += (Uptr)loadedObject->getSectionLoadAddress(*symbolSection.get()); }
+			if(PRINT_DISASSEMBLY && shouldLogMetrics)
+			{
+				Log::printf(
+					Log::output, "Disassembly for function %s\n", functionInfo.name.c_str());
+				disassembleFunction(reinterpret_cast<U8*>(loadedAddress),
+									functionInfo.numCodeBytes);
+			}
 
-		std::map<U32, U32> offsetToOpIndexMap;
-#if !LAZY_PARSE_DWARF_LINE_INFO
-		// Get the DWARF line info for this symbol, which maps machine code addresses to
-		// WebAssembly op indices.
-#if LLVM_VERSION_MAJOR >= 9
-		llvm::Expected<llvm::object::section_iterator> section = symbol.getSection();
-		if(!section) { continue; }
-		llvm::DILineInfoTable lineInfoTable = dwarfContext->getLineInfoForAddressRange(
-			llvm::object::SectionedAddress{loadedAddress, section.get()->getIndex()},
-			symbolSizePair.second);
+			// Add the function to the module's name to function map, and to the list of functions
+			// that will be sorted by their code address.
+			Runtime::Function* function
+				= (Runtime::Function*)(loadedAddress - offsetof(Runtime::Function, code));
+			nameToFunctionMap.addOrFail(functionInfo.name, function);
+#if LAZY_PARSE_DWARF_LINE_INFO
+			loadedFunctions.push_back(
+				{loadedAddress + functionInfo.numCodeBytes, function, nullptr});
 #else
-		llvm::DILineInfoTable lineInfoTable
-			= dwarfContext->getLineInfoForAddressRange(loadedAddress, symbolSizePair.second);
-#endif
-		for(auto lineInfo : lineInfoTable)
-		{ offsetToOpIndexMap.emplace(U32(lineInfo.first - loadedAddress), lineInfo.second.Line); }
+			loadedFunctions.push_back({loadedAddress + functionInfo.numCodeBytes,
+									   function,
+									   functionInfo.offsetToOpIndexTable.get()});
+			ownedOffsetToOpIndexTables.push_back(functionInfo.offsetToOpIndexTable);
 #endif
 
-		if(PRINT_DISASSEMBLY && shouldLogMetrics)
-		{
-			Log::printf(Log::output, "Disassembly for function %s\n", name.get().data());
-			disassembleFunction(reinterpret_cast<U8*>(loadedAddress), Uptr(symbolSizePair.second));
+			// Initialize the function mutable data. Tier-up code shares the FunctionMutableData
+			// of the baseline-tier function it replaces, so leave it as is.
+			WAVM_ASSERT(function->mutableData);
+			if(!isTierUpCode)
+			{
+				function->mutableData->jitModule = this;
+				function->mutableData->function = function;
+				function->mutableData->numCodeBytes = functionInfo.numCodeBytes;
+			}
 		}
+	}
 
-		// Add the function to the module's name and address to function maps.
-		WAVM_ASSERT(symbolSizePair.second <= UINTPTR_MAX);
-		Runtime::Function* function
-			= (Runtime::Function*)(loadedAddress - offsetof(Runtime::Function, code));
-		nameToFunctionMap.addOrFail(*name, function);
-		addressToFunctionMap.emplace(Uptr(loadedAddress + symbolSizePair.second), function);
-
-		// Initialize the function mutable data.
-		WAVM_ASSERT(function->mutableData);
-		function->mutableData->jitModule = this;
-		function->mutableData->function = function;
-		function->mutableData->numCodeBytes = Uptr(symbolSizePair.second);
-		function->mutableData->offsetToOpIndexMap = std::move(offsetToOpIndexMap);
+	// Sort the functions by the end address of their code.
+	std::sort(loadedFunctions.begin(),
+			  loadedFunctions.end(),
+			  [](const LoadedFunction& left, const LoadedFunction& right) {
+				  return left.endAddress < right.endAddress;
+			  });
+	numFunctionCodeRanges = loadedFunctions.size();
+	functionCodeRanges.reset(new FunctionCodeRange[numFunctionCodeRanges]);
+	for(Uptr functionIndex = 0; functionIndex < numFunctionCodeRanges; ++functionIndex)
+	{
+		const LoadedFunction& loadedFunction = loadedFunctions[functionIndex];
+		FunctionCodeRange& functionCodeRange = functionCodeRanges[functionIndex];
+		functionCodeRange.endAddress = loadedFunction.endAddress;
+		functionCodeRange.function = loadedFunction.function;
+		functionCodeRange.offsetToOpIndexTable.store(loadedFunction.offsetToOpIndexTable,
+													 std::memory_order_relaxed);
 	}
 
-	const Uptr moduleEndAddress = reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress()
-														 + memoryManager->getNumImageBytes());
+	// Publish the address ranges of the module's images, with a load number that identifies this
+	// module.
+	const U64 moduleLoadNumber = numLoadedModules.fetch_add(1, std::memory_order_seq_cst) + 1;
+	std::vector<GlobalModuleState::ImageRange> imageRanges;
+	for(Uptr imageIndex = 0; imageIndex < memoryManager->getNumImages(); ++imageIndex)
 	{
-		Platform::RWMutex::ExclusiveLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		globalModuleState->addressToModuleMap.emplace(moduleEndAddress, this);
+		U8* imageBaseAddress = memoryManager->getImageBaseAddress(imageIndex);
+		imageRanges.push_back(
+			{reinterpret_cast<Uptr>(imageBaseAddress),
+			 reinterpret_cast<Uptr>(imageBaseAddress + memoryManager->getNumImageBytes(imageIndex)),
+			 this,
+			 moduleLoadNumber});
 	}
+	globalModuleState->addImages(imageRanges);
+
+	// Describe the module's functions to Linux perf, if enabled. Building their offset to op index
+	// tables needs the DWARF context mutex.
+#if LAZY_PARSE_DWARF_LINE_INFO
+	dwarfContextLock.unlock();
+#endif
+	addFunctionsToPerfMaps(*this);
 
 	if(shouldLogMetrics)
 	{
 		Timing::logRatePerSecond(
-			"Loaded object", loadObjectTimer, (F64)objectBytes.size() / 1024.0 / 1024.0, "MiB");
+			"Loaded object", loadObjectTimer, (F64)numObjectBytes / 1024.0 / 1024.0, "MiB");
 	}
 }
 
 Module::~Module()
 {
-	// Notify GDB that the object is being unloaded.
+	// Unload the tier-up code for the module's functions.
+	tierUpModules.clear();
+
+	// Notify GDB that the objects are being unloaded.
 	{
 		Platform::Mutex::Lock lock(globalModuleState->gdbRegistrationListenerMutex);
 #if LLVM_VERSION_MAJOR >= 8
-		globalModuleState->gdbRegistrationListener->notifyFreeingObject(
-			reinterpret_cast<Uptr>(this));
+		for(Uptr imageIndex = 0; imageIndex < memoryManager->getNumImages(); ++imageIndex)
+		{
+			globalModuleState->gdbRegistrationListener->notifyFreeingObject(
+				reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress(imageIndex)));
+		}
 #else
-		globalModuleState->gdbRegistrationListener->NotifyFreeingObject(*object);
+		for(const std::unique_ptr<llvm::object::ObjectFile>& object : objects)
+		{ globalModuleState->gdbRegistrationListener->NotifyFreeingObject(*object); }
 #endif
 	}
 
-	// Remove the module from the global address to module map.
-	{
-		Platform::RWMutex::ExclusiveLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		globalModuleState->addressToModuleMap.erase(
-			globalModuleState->addressToModuleMap.find(reinterpret_cast<Uptr>(
-				memoryManager->getImageBaseAddress() + memoryManager->getNumImageBytes())));
-	}
+	// Remove the module's images from the global image index.
+	globalModuleState->removeImages(this);
 
 	// Free the FunctionMutableData objects.
-	for(const auto& pair : addressToFunctionMap) { delete pair.second->mutableData; }
+	if(!isTierUpCode)
+	{
+		for(Uptr functionIndex = 0; functionIndex < numFunctionCodeRanges; ++functionIndex)
+		{ delete functionCodeRanges[functionIndex].function->mutableData; }
+	}
 
 	// Delete the memory manager.
 	delete memoryManager;
 }
 
+std::shared_ptr<ObjectCodeInfo> LLVMJIT::createObjectCodeInfo()
+{
+	return std::make_shared<ObjectCodeInfo>();
+}
+
 std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
-	const std::vector<U8>& objectFileBytes,
+	const U8* objectBytes,
+	Uptr numObjectBytes,
 	HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
 	std::vector<IR::FunctionType>&& types,
 	std::vector<FunctionBinding>&& functionImports,
@@ -666,7 +1201,10 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	std::vector<ExceptionTypeBinding>&& exceptionTypes,
 	ModuleInstanceBinding moduleInstance,
 	Uptr tableReferenceBias,
-	const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas)
+	Uptr uninitializedTableElement,
+	Uptr epochAddress,
+	const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas,
+	ObjectCodeInfo* objectCodeInfo)
 {
 	// Bind undefined symbols in the compiled object to values.
 	HashMap<std::string, Uptr> importedSymbolMap;
@@ -740,7 +1278,8 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	}
 
 	// Allocate FunctionMutableData objects for each function def, and bind them to the symbols
-	// imported by the compiled module.
+	// imported by the compiled module. Baseline-tier code also imports the address of each
+	// function's FunctionTierUpState.
 	for(Uptr functionDefIndex = 0; functionDefIndex < functionDefMutableDatas.size();
 		++functionDefIndex)
 	{
@@ -748,6 +1287,8 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 			= functionDefMutableDatas[functionDefIndex];
 		importedSymbolMap.addOrFail(getExternalName("functionDefMutableDatas", functionDefIndex),
 									reinterpret_cast<Uptr>(functionMutableData));
+		importedSymbolMap.addOrFail(getExternalName("functionDefTierUpStates", functionDefIndex),
+									reinterpret_cast<Uptr>(&functionMutableData->tierUpState));
 	}
 
 	// Bind the moduleInstance symbol to point to the ModuleInstance.
@@ -757,6 +1298,12 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	// Bind the tableReferenceBias symbol to the tableReferenceBias.
 	importedSymbolMap.addOrFail("tableReferenceBias", tableReferenceBias);
 
+	// Bind the uninitializedTableElement symbol to the sentinel object for null table elements.
+	importedSymbolMap.addOrFail("uninitializedTableElement", uninitializedTableElement);
+
+	// Bind the epoch symbol to the current epoch counter.
+	importedSymbolMap.addOrFail("epoch", epochAddress);
+
 #if !USE_WINDOWS_SEH
 	// Use __cxxabiv1::__cxa_current_exception_type to get a reference to the std::type_info for
 	// Runtime::Exception* without enabling RTTI.
@@ -776,52 +1323,137 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 #endif
 
 	// Load the module.
-	return std::make_shared<Module>(objectFileBytes, importedSymbolMap, true);
+	return std::make_shared<Module>(
+		objectBytes, numObjectBytes, importedSymbolMap, true, false, objectCodeInfo);
 }
 
-bool LLVMJIT::getInstructionSourceByAddress(Uptr address, InstructionSource& outSource)
+Uptr Module::getNumLoadedBytes() const
 {
-	Module* jitModule;
+	Uptr numLoadedBytes = 0;
+	for(Uptr imageIndex = 0; imageIndex < memoryManager->getNumImages(); ++imageIndex)
+	{ numLoadedBytes += memoryManager->getNumImageBytes(imageIndex); }
+	return numLoadedBytes;
+}
+
+Uptr LLVMJIT::getNumLoadedBytes(const Module* jitModule) { return jitModule->getNumLoadedBytes(); }
+
+bool LLVMJIT::loadTierUpCode(Module* jitModule,
+							 const std::vector<U8>& objectCode,
+							 const std::function<bool(Uptr numLoadedBytes)>& chargeLoadedBytes)
+{
+	WAVM_ASSERT(!jitModule->isTierUpCode);
+
+	// Bind the tier-up code's references to the module's other functions to their baseline-tier
+	// code, which forwards calls to the optimized code once it has been loaded.
+	HashMap<std::string, Uptr> importedSymbolMap = jitModule->importedSymbolMap;
+	for(const auto& nameFunctionPair : jitModule->nameToFunctionMap)
 	{
-		auto globalModuleState = GlobalModuleState::get();
-		Platform::RWMutex::ShareableLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		auto moduleIt = globalModuleState->addressToModuleMap.upper_bound(address);
-		if(moduleIt == globalModuleState->addressToModuleMap.end()) { return false; }
-		jitModule = moduleIt->second;
+		importedSymbolMap.addOrFail(demangleSymbol(std::string(nameFunctionPair.key)),
+									reinterpret_cast<Uptr>(nameFunctionPair.value->code));
 	}
 
-	auto functionIt = jitModule->addressToFunctionMap.upper_bound(address);
-	if(functionIt == jitModule->addressToFunctionMap.end()) { return false; }
-	outSource.function = functionIt->second;
-	const Uptr codeAddress = reinterpret_cast<Uptr>(outSource.function->code);
-	if(address < codeAddress
-	   || address >= codeAddress + outSource.function->mutableData->numCodeBytes)
-	{ return false; }
-
-#if LAZY_PARSE_DWARF_LINE_INFO
-	Platform::Mutex::Lock dwarfContextLock(jitModule->dwarfContextMutex);
-	llvm::DILineInfo lineInfo = jitModule->dwarfContext->getLineInfoForAddress(
-		llvm::object::SectionedAddress(address, llvm::object::SectionedAddress::UndefSection),
-		llvm::DILineInfoSpecifier(llvm::DILineInfoSpecifier::FileLineInfoKind::Default,
-								  llvm::DINameKind::None));
+	// Load the tier-up code.
+	std::unique_ptr<Module> tierUpModule(
+		new Module(objectCode.data(), objectCode.size(), importedSymbolMap, false, true));
+	if(!chargeLoadedBytes(tierUpModule->getNumLoadedBytes())) { return false; }
 
-	outSource.instructionIndex = Uptr(lineInfo.Line);
+	// Redirect calls to the baseline-tier functions to the optimized code.
+	Platform::Mutex::Lock tierUpModulesLock(jitModule->tierUpModulesMutex);
+	for(const auto& nameFunctionPair : tierUpModule->nameToFunctionMap)
+	{
+		Runtime::Function* function = nameFunctionPair.value;
+		function->mutableData->tierUpState.optimizedCode.store(function->code,
+															   std::memory_order_release);
+	}
+	jitModule->tierUpModules.push_back(std::move(tierUpModule));
 	return true;
-#else
-	// Find the highest entry in the offsetToOpIndexMap whose offset is <= the symbol-relative IP.
-	U32 ipOffset = (U32)(address - codeAddress);
-	Iptr opIndex = -1;
-	for(auto offsetMapIt : outSource.function->mutableData->offsetToOpIndexMap)
+}
+
+const OffsetToOpIndexTable* Module::getOffsetToOpIndexTable(FunctionCodeRange& functionCodeRange)
+{
+	const OffsetToOpIndexTable* offsetToOpIndexTable
+		= functionCodeRange.offsetToOpIndexTable.load(std::memory_order_acquire);
+#if LAZY_PARSE_DWARF_LINE_INFO
+	if(!offsetToOpIndexTable)
 	{
-		if(offsetMapIt.first <= ipOffset) { opIndex = offsetMapIt.second; }
-		else
+		// If the table hasn't been built, build it while holding the mutex, and check whether
+		// another thread built it first.
+		Platform::Mutex::Lock offsetToOpIndexTablesLock(offsetToOpIndexTablesMutex);
+		offsetToOpIndexTable
+			= functionCodeRange.offsetToOpIndexTable.load(std::memory_order_acquire);
+		if(!offsetToOpIndexTable)
 		{
-			break;
+			// Find the DWARF context for the image containing the function.
+			const Uptr codeAddress = reinterpret_cast<Uptr>(functionCodeRange.function->code);
+			Platform::Mutex::Lock dwarfContextLock(dwarfContextMutex);
+			Uptr imageIndex = 0;
+			for(Uptr otherImageIndex = 1; otherImageIndex < imageEndAddresses.size();
+				++otherImageIndex)
+			{
+				const Uptr imageEndAddress = imageEndAddresses[otherImageIndex];
+				if(imageEndAddress > codeAddress
+				   && (imageEndAddresses[imageIndex] <= codeAddress
+					   || imageEndAddress < imageEndAddresses[imageIndex]))
+				{ imageIndex = otherImageIndex; }
+			}
+
+			// Build the function's table from the DWARF line info for its code, which maps
+			// machine code addresses to WebAssembly op indices.
+			llvm::DILineInfoTable lineInfoTable
+				= dwarfContexts[imageIndex]->getLineInfoForAddressRange(
+					llvm::object::SectionedAddress(codeAddress,
+												   llvm::object::SectionedAddress::UndefSection),
+					functionCodeRange.endAddress - codeAddress,
+					llvm::DILineInfoSpecifier(llvm::DILineInfoSpecifier::FileLineInfoKind::None,
+											  llvm::DINameKind::None));
+			std::vector<std::pair<U32, U32>> offsetToOpIndexEntries;
+			for(auto lineInfo : lineInfoTable)
+			{
+				offsetToOpIndexEntries.emplace_back(U32(lineInfo.first - codeAddress),
+													lineInfo.second.Line);
+			}
+			ownedOffsetToOpIndexTables.push_back(
+				std::make_shared<const OffsetToOpIndexTable>(std::move(offsetToOpIndexEntries)));
+			offsetToOpIndexTable = ownedOffsetToOpIndexTables.back().get();
+			functionCodeRange.offsetToOpIndexTable.store(offsetToOpIndexTable,
+														 std::memory_order_release);
 		}
 	}
+#endif
+	return offsetToOpIndexTable;
+}
 
-	outSource.instructionIndex = opIndex > 0 ? Uptr(opIndex) : 0;
+bool LLVMJIT::getInstructionSourceByAddress(Uptr address, InstructionSource& outSource)
+{
+	// Find the module and function containing the address. Neither lookup locks, so stack walks
+	// don't contend with loading and unloading modules. The guard keeps the module from being
+	// unloaded during the lookup; the caller's guard keeps the function valid after it returns.
+	ModuleUnloadGuard moduleUnloadGuard;
+	Module* jitModule = GlobalModuleState::get()->getModuleByAddress(address);
+	if(!jitModule) { return false; }
+
+	// functionCodeRanges is sorted by the end address of each function's code. Tier-up code
+	// shares its FunctionMutableData with the baseline-tier code, so numCodeBytes in it can't be
+	// used to find the end of the function.
+	Module::FunctionCodeRange* functionCodeRangesEnd
+		= jitModule->functionCodeRanges.get() + jitModule->numFunctionCodeRanges;
+	Module::FunctionCodeRange* functionCodeRange = std::upper_bound(
+		jitModule->functionCodeRanges.get(),
+		functionCodeRangesEnd,
+		address,
+		[](Uptr address, const Module::FunctionCodeRange& functionCodeRange) {
+			return address < functionCodeRange.endAddress;
+		});
+	if(functionCodeRange == functionCodeRangesEnd) { return false; }
+	outSource.function = functionCodeRange->function;
+	const Uptr codeAddress = reinterpret_cast<Uptr>(outSource.function->code);
+	if(address < codeAddress || address >= functionCodeRange->endAddress) { return false; }
+
+	// Find the op index of the last entry in the function's offset to op index table whose offset
+	// is <= the function-relative address.
+	const OffsetToOpIndexTable* offsetToOpIndexTable
+		= jitModule->getOffsetToOpIndexTable(*functionCodeRange);
+	outSource.instructionIndex
+		= offsetToOpIndexTable ? offsetToOpIndexTable->getOpIndex(U32(address - codeAddress)) : 0;
 	return true;
-#endif
 }
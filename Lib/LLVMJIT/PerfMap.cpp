@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LLVMJITPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+#if defined(__linux__)
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::LLVMJIT;
+
+#if defined(__linux__)
+
+// The jitdump format is defined by tools/perf/Documentation/jitdump-specification.txt in the Linux
+// source tree.
+static constexpr U32 jitdumpMagic = 0x4A695444;
+static constexpr U32 jitdumpVersion = 1;
+
+#if defined(__x86_64__)
+static constexpr U32 jitdumpELFMachine = EM_X86_64;
+#elif defined(__aarch64__)
+static constexpr U32 jitdumpELFMachine = EM_AARCH64;
+#else
+static constexpr U32 jitdumpELFMachine = EM_NONE;
+#endif
+
+enum class JITDumpRecordType : U32
+{
+	codeLoad = 0,
+	debugInfo = 2,
+};
+
+struct JITDumpHeader
+{
+	U32 magic;
+	U32 version;
+	U32 numHeaderBytes;
+	U32 elfMachine;
+	U32 padding;
+	U32 pid;
+	U64 timestamp;
+	U64 flags;
+};
+
+struct JITDumpRecordPrefix
+{
+	JITDumpRecordType type;
+	U32 numRecordBytes;
+	U64 timestamp;
+};
+
+// Followed by the function's null-terminated name, and its code.
+struct JITDumpCodeLoadRecord
+{
+	JITDumpRecordPrefix prefix;
+	U32 pid;
+	U32 tid;
+	U64 virtualAddress;
+	U64 codeAddress;
+	U64 numCodeBytes;
+	U64 codeIndex;
+};
+
+// Followed by numEntries debug entries, which each describe the code starting at an address.
+struct JITDumpDebugInfoRecord
+{
+	JITDumpRecordPrefix prefix;
+	U64 codeAddress;
+	U64 numEntries;
+};
+
+// Followed by the null-terminated name of the entry's source file.
+struct JITDumpDebugEntry
+{
+	U64 address;
+	I32 line;
+	I32 discriminator;
+};
+
+struct PerfMapState
+{
+	std::atomic<bool> isEnabled{false};
+
+	// The open perf map files; protected by mutex.
+	Platform::Mutex mutex;
+	FILE* perfMapFile = nullptr;
+	FILE* jitdumpFile = nullptr;
+	U64 nextJITDumpCodeIndex = 0;
+
+	static PerfMapState& get()
+	{
+		static PerfMapState perfMapState;
+		return perfMapState;
+	}
+};
+
+// perf correlates jitdump records with samples by their CLOCK_MONOTONIC timestamp.
+static U64 getJITDumpTimestamp()
+{
+	return U64(Platform::getClockTime(Platform::Clock::monotonic).ns);
+}
+
+static FILE* openJITDumpFile()
+{
+	const std::string filename = "/tmp/jit-" + std::to_string(getpid()) + ".dump";
+	const int fd = open(filename.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+	if(fd == -1) { return nullptr; }
+
+	// perf finds the jitdump file by the executable mapping of it in the recorded process, so map
+	// the first page of it, and leave it mapped until the process exits.
+	const long numPageBytes = sysconf(_SC_PAGESIZE);
+	if(mmap(nullptr, numPageBytes, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0) == MAP_FAILED)
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	FILE* file = fdopen(fd, "wb");
+	if(!file)
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	JITDumpHeader header;
+	header.magic = jitdumpMagic;
+	header.version = jitdumpVersion;
+	header.numHeaderBytes = sizeof(JITDumpHeader);
+	header.elfMachine = jitdumpELFMachine;
+	header.padding = 0;
+	header.pid = U32(getpid());
+	header.timestamp = getJITDumpTimestamp();
+	header.flags = 0;
+	fwrite(&header, sizeof(header), 1, file);
+	fflush(file);
+
+	return file;
+}
+
+static void writeJITDumpFunction(PerfMapState& state,
+								 Uptr codeAddress,
+								 Uptr numCodeBytes,
+								 const std::string& name,
+								 const OffsetToOpIndexTable* offsetToOpIndexTable)
+{
+	const U64 timestamp = getJITDumpTimestamp();
+
+	// Write a debug info record that describes the op index each range of the function's code was
+	// generated for. perf shows the op index as the line number in a source file with the same
+	// name as the function.
+	if(offsetToOpIndexTable)
+	{
+		const std::vector<std::pair<U32, U32>> entries = offsetToOpIndexTable->getEntries();
+
+		JITDumpDebugInfoRecord debugInfo;
+		debugInfo.prefix.type = JITDumpRecordType::debugInfo;
+		debugInfo.prefix.numRecordBytes = U32(
+			sizeof(JITDumpDebugInfoRecord)
+			+ entries.size() * (sizeof(JITDumpDebugEntry) + name.size() + 1));
+		debugInfo.prefix.timestamp = timestamp;
+		debugInfo.codeAddress = codeAddress;
+		debugInfo.numEntries = entries.size();
+		fwrite(&debugInfo, sizeof(debugInfo), 1, state.jitdumpFile);
+
+		for(const std::pair<U32, U32>& entry : entries)
+		{
+			JITDumpDebugEntry debugEntry;
+			debugEntry.address = codeAddress + entry.first;
+			debugEntry.line = I32(entry.second);
+			debugEntry.discriminator = 0;
+			fwrite(&debugEntry, sizeof(debugEntry), 1, state.jitdumpFile);
+			fwrite(name.c_str(), name.size() + 1, 1, state.jitdumpFile);
+		}
+	}
+
+	JITDumpCodeLoadRecord codeLoad;
+	codeLoad.prefix.type = JITDumpRecordType::codeLoad;
+	codeLoad.prefix.numRecordBytes
+		= U32(sizeof(JITDumpCodeLoadRecord) + name.size() + 1 + numCodeBytes);
+	codeLoad.prefix.timestamp = timestamp;
+	codeLoad.pid = U32(getpid());
+	codeLoad.tid = U32(syscall(SYS_gettid));
+	codeLoad.virtualAddress = codeAddress;
+	codeLoad.codeAddress = codeAddress;
+	codeLoad.numCodeBytes = numCodeBytes;
+	codeLoad.codeIndex = state.nextJITDumpCodeIndex++;
+	fwrite(&codeLoad, sizeof(codeLoad), 1, state.jitdumpFile);
+	fwrite(name.c_str(), name.size() + 1, 1, state.jitdumpFile);
+	fwrite(reinterpret_cast<const void*>(codeAddress), numCodeBytes, 1, state.jitdumpFile);
+}
+
+bool LLVMJIT::enablePerfMap(PerfMapFormat format)
+{
+	PerfMapState& state = PerfMapState::get();
+	Platform::Mutex::Lock perfMapLock(state.mutex);
+	switch(format)
+	{
+	case PerfMapFormat::perfMap:
+		if(!state.perfMapFile)
+		{
+			const std::string filename = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+			state.perfMapFile = fopen(filename.c_str(), "w");
+			if(!state.perfMapFile) { return false; }
+		}
+		break;
+	case PerfMapFormat::jitdump:
+		if(jitdumpELFMachine == EM_NONE) { return false; }
+		if(!state.jitdumpFile)
+		{
+			state.jitdumpFile = openJITDumpFile();
+			if(!state.jitdumpFile) { return false; }
+		}
+		break;
+	default: WAVM_UNREACHABLE();
+	};
+
+	state.isEnabled.store(true, std::memory_order_release);
+	return true;
+}
+
+void LLVMJIT::addFunctionsToPerfMaps(Module& module)
+{
+	PerfMapState& state = PerfMapState::get();
+	if(!state.isEnabled.load(std::memory_order_acquire)) { return; }
+
+	Platform::Mutex::Lock perfMapLock(state.mutex);
+	for(Uptr functionIndex = 0; functionIndex < module.numFunctionCodeRanges; ++functionIndex)
+	{
+		Module::FunctionCodeRange& functionCodeRange = module.functionCodeRanges[functionIndex];
+		const Uptr codeAddress = reinterpret_cast<Uptr>(functionCodeRange.function->code);
+		const Uptr numCodeBytes = functionCodeRange.endAddress - codeAddress;
+		const std::string& name = functionCodeRange.function->mutableData->debugName;
+		if(!numCodeBytes) { continue; }
+
+		if(state.perfMapFile)
+		{
+			fprintf(state.perfMapFile,
+					"%" WAVM_PRIxPTR " %" WAVM_PRIxPTR " %s\n",
+					codeAddress,
+					numCodeBytes,
+					name.c_str());
+		}
+
+		if(state.jitdumpFile)
+		{
+			writeJITDumpFunction(state,
+								 codeAddress,
+								 numCodeBytes,
+								 name,
+								 module.getOffsetToOpIndexTable(functionCodeRange));
+		}
+	}
+
+	// Flush the files, so perf can read the functions even if the process doesn't exit cleanly.
+	if(state.perfMapFile) { fflush(state.perfMapFile); }
+	if(state.jitdumpFile) { fflush(state.jitdumpFile); }
+}
+
+#else
+
+bool LLVMJIT::enablePerfMap(PerfMapFormat) { return false; }
+
+void LLVMJIT::addFunctionsToPerfMaps(Module&) {}
+
+#endif
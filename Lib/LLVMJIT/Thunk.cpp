@@ -205,7 +205,7 @@ InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType)
 		= compileLLVMModule(llvmContext, std::move(llvmModule), false, targetMachine.get());
 
 	// Load the object code.
-	auto jitModule = new LLVMJIT::Module(objectBytes, {}, false);
+	auto jitModule = new LLVMJIT::Module(objectBytes.data(), objectBytes.size(), {}, false);
 	invokeThunkCache.modules.push_back(std::unique_ptr<LLVMJIT::Module>(jitModule));
 
 	invokeThunkFunction = jitModule->nameToFunctionMap[mangleSymbol("thunk")];
@@ -275,7 +275,7 @@ Runtime::Function* LLVMJIT::getIntrinsicThunk(void* nativeFunction,
 		= compileLLVMModule(llvmContext, std::move(llvmModule), false, targetMachine.get());
 
 	// Load the object code.
-	auto jitModule = new LLVMJIT::Module(objectBytes, {}, false);
+	auto jitModule = new LLVMJIT::Module(objectBytes.data(), objectBytes.size(), {}, false);
 	intrinsicThunkCache.modules.push_back(std::unique_ptr<LLVMJIT::Module>(jitModule));
 
 	intrinsicThunkFunction = jitModule->nameToFunctionMap[mangleSymbol("thunk")];
@@ -1,5 +1,6 @@
 #include "WAVM/ObjectCache/ObjectCache.h"
 #include <errno.h>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -7,14 +8,36 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Time.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "lmdb.h"
 
-#define CURRENT_DB_VERSION 0
+#define CURRENT_DB_VERSION 2
+
+// The granularity of the last-used times of cached modules, and the limits on how many cache hits
+// and for how long they are buffered before their last-used times are written to the database.
+static constexpr U64 lruTimeBucketSeconds = 60;
+static constexpr Uptr maxPendingAccesses = 64;
+static constexpr U64 accessFlushSeconds = 10;
+
+// Cached objects at least this large are returned as views of the database's memory map, which keep
+// a read transaction open while they are in use. Smaller objects are copied out of the database.
+// While a view's read transaction is open, it uses one of the database's reader slots, and the
+// pages that were free when it began can't be reused by writes.
+static constexpr Uptr minZeroCopyObjectBytes = 1024 * 1024;
+
+// The maximum number of concurrent read transactions, including those held by zero-copy views.
+static constexpr unsigned int maxReaders = 1024;
+
+// The maximum number of zero-copy views that may be held at once. Objects that are looked up while
+// this many views are held are copied out of the database instead, so the views can't use all the
+// reader slots and make lookups fail.
+static constexpr Uptr maxZeroCopyViews = maxReaders / 2;
 
 using namespace WAVM;
 using namespace WAVM::ObjectCache;
@@ -26,16 +49,17 @@ using namespace WAVM::ObjectCache;
 	}
 
 // A database key to identify a cached module by a hash that identifies the code generation version,
-// and a hash of the module's WASM serialization.
+// and the 128-bit key passed to getCachedObject.
 WAVM_PACKED_STRUCT(struct ModuleKey {
 	U8 codeKeyBytes[8];
-	U8 moduleHashBytes[8];
+	U8 moduleHashBytes[16];
 
 	ModuleKey() {}
-	ModuleKey(U64 codeKey, U64 moduleHash)
+	ModuleKey(U64 codeKey, const Hash128& moduleHash)
 	{
 		memcpy(codeKeyBytes, &codeKey, sizeof(codeKeyBytes));
-		memcpy(moduleHashBytes, &moduleHash, sizeof(moduleHashBytes));
+		memcpy(moduleHashBytes, &moduleHash.low, sizeof(U64));
+		memcpy(moduleHashBytes + sizeof(U64), &moduleHash.high, sizeof(U64));
 	}
 
 	U64 getCodeKey() const
@@ -45,10 +69,11 @@ WAVM_PACKED_STRUCT(struct ModuleKey {
 		return result;
 	}
 
-	U64 getModuleHash() const
+	Hash128 getModuleHash() const
 	{
-		U64 result = 0;
-		memcpy(&result, moduleHashBytes, sizeof(U64));
+		Hash128 result;
+		memcpy(&result.low, moduleHashBytes, sizeof(U64));
+		memcpy(&result.high, moduleHashBytes + sizeof(U64), sizeof(U64));
 		return result;
 	}
 });
@@ -156,6 +181,9 @@ struct Database
 		}
 	};
 
+	// The number of zero-copy views of the database's memory map that haven't been released.
+	std::atomic<Uptr> numZeroCopyViews{0};
+
 	Database(MDB_env* inEnv) : env(inEnv) {}
 	~Database() { mdb_env_close(env); }
 
@@ -305,6 +333,16 @@ struct Database
 		ERROR_UNLESS_MDB_SUCCESS(mdb_drop(txn, dbi, 0));
 	}
 
+	// Deletes a table from the database if it exists. All errors are fatal.
+	static void deleteTableIfExists(MDB_txn* txn, const char* name)
+	{
+		MDB_dbi dbi{0};
+		int openResult = mdb_dbi_open(txn, name, 0, &dbi);
+		if(openResult == MDB_NOTFOUND) { return; }
+		if(openResult) { Errors::fatalf("mdb_dbi_open failed: %s", mdb_strerror(openResult)); }
+		ERROR_UNLESS_MDB_SUCCESS(mdb_drop(txn, dbi, 1));
+	}
+
 private:
 	MDB_env* env;
 };
@@ -328,6 +366,15 @@ struct ScopedTxn
 		txn = nullptr;
 	}
 
+	// Returns the transaction without ending it, making the caller responsible for ending it.
+	MDB_txn* release()
+	{
+		WAVM_ASSERT(txn);
+		MDB_txn* result = txn;
+		txn = nullptr;
+		return result;
+	}
+
 	void commit()
 	{
 		WAVM_ASSERT(txn);
@@ -357,7 +404,11 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		ERROR_UNLESS_MDB_SUCCESS(mdb_env_create(&env));
 		ERROR_UNLESS_MDB_SUCCESS(mdb_env_set_mapsize(env, maxBytes));
 		ERROR_UNLESS_MDB_SUCCESS(mdb_env_set_maxdbs(env, 5));
-		const int openError = mdb_env_open(env, path, 0, 0666);
+		ERROR_UNLESS_MDB_SUCCESS(mdb_env_set_maxreaders(env, maxReaders));
+
+		// Use MDB_NOTLS so read transactions aren't tied to a thread: a zero-copy view of a cached
+		// object keeps its read transaction open until the view is released on any thread.
+		const int openError = mdb_env_open(env, path, MDB_NOTLS, 0666);
 		if(openError)
 		{
 			mdb_env_close(env);
@@ -370,7 +421,9 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 
 			default:
 				Errors::fatalf(
-					"mdb_env_open(env, \"%s\", 0, 0666) failed: %s", path, mdb_strerror(openError));
+					"mdb_env_open(env, \"%s\", MDB_NOTLS, 0666) failed: %s",
+					path,
+					mdb_strerror(openError));
 			};
 		}
 
@@ -382,7 +435,6 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			ScopedTxn txn(database->beginTxn());
 
 			// Open or create the database tables used by the object cache.
-			moduleTable = database->openTable(txn, "modules", MDB_CREATE);
 			objectTable = database->openTable(txn, "objects", MDB_CREATE);
 			metaTable = database->openTable(txn, "meta", MDB_CREATE);
 			lruTable = database->openTable(txn, "lru", MDB_CREATE);
@@ -403,11 +455,14 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 				Log::printf(Log::debug,
 							"Clearing contents of outdated object cache database '%s'.\n",
 							path);
-				Database::dropDB(txn, moduleTable);
 				Database::dropDB(txn, objectTable);
 				Database::dropDB(txn, metaTable);
 				Database::dropDB(txn, lruTable);
 				Database::dropDB(txn, versionTable);
+
+				// Older versions stored the WASM bytes of each cached module in a table that is
+				// no longer used.
+				Database::deleteTableIfExists(txn, "modules");
 			}
 
 			if(writeVersion)
@@ -439,58 +494,85 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		}
 	}
 
-	bool tryGetCachedObject(U64 moduleHash,
-							const U8* wasmBytes,
-							Uptr numWASMBytes,
-							std::vector<U8>& outObjectCode)
+	bool tryGetCachedObject(const Hash128& moduleHash, Runtime::ObjectCodeView& outObjectCode)
 	{
 		Timing::Timer readTimer;
 
-		ScopedTxn txn(database->beginTxn());
+		// Use a read-only transaction, so concurrent lookups don't contend on LMDB's write lock.
+		ScopedTxn txn(database->beginTxn(MDB_RDONLY));
 
-		// Check for a cached module with this hash key.
+		// Check for cached object code with this key, and get its last-used time. The key is a
+		// 128-bit hash of everything that affects the object code, so a match doesn't need to be
+		// verified by comparing the data the key was computed from.
 		bool hadCachedObject = false;
+		Time lastAccessTime;
 		ModuleKey moduleKey(codeKey, moduleHash);
-		MDB_val cachedModuleBytes;
-		if(Database::tryGetKeyValue(txn, moduleTable, moduleKey, cachedModuleBytes))
+		MDB_val objectBytesVal;
+		if(Database::tryGetKeyValue(txn, objectTable, moduleKey, objectBytesVal))
 		{
-			// Check that the cached module is the same as the one being queried.
-			if(cachedModuleBytes.mv_size == numWASMBytes
-			   && !memcmp(cachedModuleBytes.mv_data, wasmBytes, numWASMBytes))
+			Metadata metadata;
+			Database::getKeyValue(txn, metaTable, moduleKey, metadata);
+			lastAccessTime = metadata.lastAccessTimeKey.getTime();
+
+			const U8* objectBytes = (const U8*)objectBytesVal.mv_data;
+			const Uptr numObjectBytes = Uptr(objectBytesVal.mv_size);
+			if(numObjectBytes >= minZeroCopyObjectBytes && tryAcquireZeroCopyView())
+			{
+				// Return a view of the object code in the database's memory map. The view owns the
+				// read transaction, which keeps the pages it references from being reused until the
+				// view is released, and the database, which keeps the map open.
+				std::shared_ptr<Database> viewDatabase = database;
+				std::shared_ptr<MDB_txn> viewTxn(txn.release(),
+												 [viewDatabase](MDB_txn* releasedTxn) {
+													 mdb_txn_abort(releasedTxn);
+													 --viewDatabase->numZeroCopyViews;
+												 });
+				outObjectCode
+					= Runtime::ObjectCodeView(objectBytes, numObjectBytes, std::move(viewTxn));
+			}
+			else
 			{
-				// If so, get the cached object code for the cached module.
-				Database::getKeyValue(txn, objectTable, moduleKey, outObjectCode);
-
-				// Update the last-used time for the cached module.
-				Metadata metadata;
-				Database::getKeyValue(txn, metaTable, moduleKey, metadata);
-				Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey);
-				metadata.lastAccessTimeKey = Platform::getClockTime(Platform::Clock::realtime);
-				Database::putKeyValue(txn, metaTable, moduleKey, metadata);
-				Database::putKeyValue(txn, lruTable, metadata.lastAccessTimeKey, moduleKey);
-
-				hadCachedObject = true;
+				outObjectCode = Runtime::ObjectCodeView(
+					std::vector<U8>(objectBytes, objectBytes + numObjectBytes));
 			}
+
+			hadCachedObject = true;
 		}
 
-		// Commit the read transaction.
-		txn.commit();
+		// End the read transaction if it wasn't passed to a zero-copy view.
+		if(txn) { txn.abort(); }
 
 		Timing::logTimer("Probed for cached object", readTimer);
 
+		// Record the access to update the cached module's last-used time in a later batch.
+		if(hadCachedObject) { recordAccess(moduleHash, lastAccessTime); }
+
 		return hadCachedObject;
 	}
 
-	void addCachedObject(U64 moduleHash,
-						 const U8* wasmBytes,
-						 Uptr numWASMBytes,
-						 const std::vector<U8>& objectBytes)
+	// Counts a new zero-copy view, unless the maximum number of views are already held.
+	bool tryAcquireZeroCopyView()
+	{
+		Uptr numViews = database->numZeroCopyViews.load();
+		while(numViews < maxZeroCopyViews)
+		{
+			if(database->numZeroCopyViews.compare_exchange_weak(numViews, numViews + 1))
+			{ return true; }
+		}
+		return false;
+	}
+
+	void addCachedObject(const Hash128& moduleHash, const std::vector<U8>& objectBytes)
 	{
 		Timing::Timer writeTimer;
 
 		Time now = Platform::getClockTime(Platform::Clock::realtime);
 		ModuleKey moduleKey(codeKey, moduleHash);
 
+		// Write any buffered accesses to the database before evicting the least recently used
+		// cached objects.
+		flushAccesses();
+
 		// Try to add the module to the database.
 		bool firstTry = true;
 		while(true)
@@ -519,13 +601,9 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			{ Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey); }
 			metadata.lastAccessTimeKey = now;
 
-			// Add the module to the module, object, metadata, and LRU tables.
-			MDB_val wasmBytesVal;
-			wasmBytesVal.mv_data = const_cast<U8*>(wasmBytes);
-			wasmBytesVal.mv_size = numWASMBytes;
+			// Add the module to the object, metadata, and LRU tables.
 			if(Database::tryPutKeyValue(txn, metaTable, moduleKey, metadata)
 			   && Database::tryPutKeyValue(txn, lruTable, metadata.lastAccessTimeKey, moduleKey)
-			   && Database::tryPutKeyValue(txn, moduleTable, moduleKey, wasmBytesVal)
 			   && Database::tryPutKeyValue(txn, objectTable, moduleKey, objectBytes))
 			{
 				txn.commit();
@@ -542,30 +620,6 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 
 		ScopedTxn txn(database->beginTxn(MDB_RDONLY));
 
-		// Dump the contents of the module table.
-		Log::printf(Log::debug, "Module table:\n");
-		{
-			MDB_cursor* cursor = Database::openCursor(txn, moduleTable);
-
-			ModuleKey moduleKey;
-			MDB_val moduleBytesVal;
-			bool getResult = Database::tryGetCursor(cursor, moduleKey, moduleBytesVal, MDB_FIRST);
-			while(getResult)
-			{
-				const U64 storedCodeKey = moduleKey.getCodeKey();
-				const U64 moduleHash = moduleKey.getModuleHash();
-
-				Log::printf(Log::debug,
-							"  %16" PRIx64 "|%16" PRIx64 " %zu bytes\n",
-							storedCodeKey,
-							moduleHash,
-							moduleBytesVal.mv_size);
-
-				getResult = Database::tryGetCursor(cursor, moduleKey, moduleBytesVal, MDB_NEXT);
-			};
-			Database::closeCursor(cursor);
-		}
-
 		// Dump the contents of the object table.
 		Log::printf(Log::debug, "Object table:\n");
 		{
@@ -577,12 +631,13 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			while(getResult)
 			{
 				const U64 storedCodeKey = moduleKey.getCodeKey();
-				const U64 moduleHash = moduleKey.getModuleHash();
+				const Hash128 moduleHash = moduleKey.getModuleHash();
 
 				Log::printf(Log::debug,
-							"  %16" PRIx64 "|%16" PRIx64 " %zu bytes\n",
+							"  %16" PRIx64 "|%16" PRIx64 "%16" PRIx64 " %zu bytes\n",
 							storedCodeKey,
-							moduleHash,
+							moduleHash.high,
+							moduleHash.low,
 							objectBytesVal.mv_size);
 
 				getResult = Database::tryGetCursor(cursor, moduleKey, objectBytesVal, MDB_NEXT);
@@ -601,15 +656,17 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			while(getResult)
 			{
 				const U64 storedCodeKey = moduleKey.getCodeKey();
-				const U64 moduleHash = moduleKey.getModuleHash();
+				const Hash128 moduleHash = moduleKey.getModuleHash();
 
 				const F64 lastAccessTimeAge
 					= F64((now.ns - metadata.lastAccessTimeKey.getTime().ns) / 1000000000);
 
 				Log::printf(Log::debug,
-							"  %16" PRIx64 "|%16" PRIx64 " last access: %.1f seconds ago\n",
+							"  %16" PRIx64 "|%16" PRIx64 "%16" PRIx64
+							" last access: %.1f seconds ago\n",
 							storedCodeKey,
-							moduleHash,
+							moduleHash.high,
+							moduleHash.low,
 							lastAccessTimeAge);
 
 				getResult = Database::tryGetCursor(cursor, moduleKey, metadata, MDB_NEXT);
@@ -629,13 +686,14 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			while(getResult)
 			{
 				const U64 storedCodeKey = moduleKey.getCodeKey();
-				const U64 moduleHash = moduleKey.getModuleHash();
+				const Hash128 moduleHash = moduleKey.getModuleHash();
 				const F64 ageSeconds = F64((now.ns - lastAccessTimeKey.getTime().ns) / 1000000000);
 
 				Log::printf(Log::debug,
-							"  %16" PRIx64 "|%16" PRIx64 " %.1f seconds ago\n",
+							"  %16" PRIx64 "|%16" PRIx64 "%16" PRIx64 " %.1f seconds ago\n",
 							storedCodeKey,
-							moduleHash,
+							moduleHash.high,
+							moduleHash.low,
 							ageSeconds);
 
 				getResult = Database::tryGetCursor(cursor, lastAccessTimeKey, moduleKey, MDB_NEXT);
@@ -644,23 +702,16 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		}
 	}
 
-	virtual std::vector<U8> getCachedObject(
-		const U8* wasmBytes,
-		Uptr numWASMBytes,
+	virtual Runtime::ObjectCodeView getCachedObject(
+		const Hash128& moduleHash,
 		std::function<std::vector<U8>()>&& compileThunk) override
 	{
-		// Compute a hash of the serialized WASM module.
-		Timing::Timer hashTimer;
-		const U64 moduleHash = XXH64(wasmBytes, numWASMBytes, 0);
-		Timing::logRatePerSecond(
-			"Hashed module key", hashTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
-
 		// Try to find the module's object code in the cache.
-		std::vector<U8> objectCode;
 		try
 		{
-			if(tryGetCachedObject(moduleHash, wasmBytes, numWASMBytes, objectCode))
-			{ return objectCode; }
+			Runtime::ObjectCodeView cachedObjectCode;
+			if(tryGetCachedObject(moduleHash, cachedObjectCode))
+			{ return cachedObjectCode; }
 		}
 		catch(Database::Exception const& exception)
 		{
@@ -670,12 +721,12 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		}
 
 		// If there wasn't a matching cached module+object code, compile the module.
-		objectCode = compileThunk();
+		std::vector<U8> objectCode = compileThunk();
 
 		// Add the cached module+object code to the database.
 		try
 		{
-			addCachedObject(moduleHash, wasmBytes, numWASMBytes, objectCode);
+			addCachedObject(moduleHash, objectCode);
 		}
 		catch(Database::Exception const& exception)
 		{
@@ -684,18 +735,111 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 						Database::Exception::getMessage(exception.type));
 		}
 
-		return objectCode;
+		return Runtime::ObjectCodeView(std::move(objectCode));
+	}
+
+	~LMDBObjectCache()
+	{
+		if(!database) { return; }
+		try
+		{
+			flushAccesses();
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to update object cache access times: %s\n",
+						Database::Exception::getMessage(exception.type));
+		}
 	}
 
 private:
-	std::unique_ptr<Database> database;
-	MDB_dbi moduleTable;
+	std::shared_ptr<Database> database;
 	MDB_dbi objectTable;
 	MDB_dbi metaTable;
 	MDB_dbi lruTable;
 	MDB_dbi versionTable;
 	U64 codeKey{0};
 
+	// Cache hits that will update the last-used time of cached modules in the next batched write,
+	// keyed by module hash. Protected by accessesMutex.
+	Platform::Mutex accessesMutex;
+	HashMap<Hash128, Time> pendingAccesses;
+	Time lastFlushTime{0};
+
+	// Last-used times are only updated when they move to a different time bucket, so repeated
+	// hits on a module don't write to the database.
+	static Time getAccessTimeBucket(Time time)
+	{
+		return Time{time.ns / (I128(lruTimeBucketSeconds) * 1000000000)};
+	}
+
+	void recordAccess(const Hash128& moduleHash, Time lastAccessTime)
+	{
+		const Time now = Platform::getClockTime(Platform::Clock::realtime);
+		if(getAccessTimeBucket(now).ns == getAccessTimeBucket(lastAccessTime).ns) { return; }
+
+		bool shouldFlush;
+		{
+			Platform::Mutex::Lock accessesLock(accessesMutex);
+			pendingAccesses.set(moduleHash, now);
+			shouldFlush = pendingAccesses.size() >= maxPendingAccesses
+						  || now.ns - lastFlushTime.ns >= I128(accessFlushSeconds) * 1000000000;
+		}
+
+		if(shouldFlush)
+		{
+			try
+			{
+				flushAccesses();
+			}
+			catch(Database::Exception const& exception)
+			{
+				Log::printf(Log::error,
+							"Failed to update object cache access times: %s\n",
+							Database::Exception::getMessage(exception.type));
+			}
+		}
+	}
+
+	// Writes the buffered accesses to the metadata and LRU tables in a single transaction.
+	void flushAccesses()
+	{
+		HashMap<Hash128, Time> accesses;
+		{
+			Platform::Mutex::Lock accessesLock(accessesMutex);
+			accesses = std::move(pendingAccesses);
+			pendingAccesses.clear();
+			lastFlushTime = Platform::getClockTime(Platform::Clock::realtime);
+		}
+		if(!accesses.size()) { return; }
+
+		Timing::Timer flushTimer;
+
+		ScopedTxn txn(database->beginTxn());
+		for(const auto& accessPair : accesses)
+		{
+			const ModuleKey moduleKey(codeKey, accessPair.key);
+			const Time accessTime = accessPair.value;
+
+			// Skip modules that were evicted since the access, or whose last-used time was
+			// already moved to the access's time bucket by another process.
+			Metadata metadata;
+			if(!Database::tryGetKeyValue(txn, metaTable, moduleKey, metadata)
+			   || getAccessTimeBucket(metadata.lastAccessTimeKey.getTime()).ns
+					  >= getAccessTimeBucket(accessTime).ns)
+			{ continue; }
+
+			Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey);
+			metadata.lastAccessTimeKey = accessTime;
+			Database::putKeyValue(txn, metaTable, moduleKey, metadata);
+			Database::putKeyValue(txn, lruTable, metadata.lastAccessTimeKey, moduleKey);
+		}
+		txn.commit();
+
+		Timing::logTimer("Updated object cache access times", flushTimer);
+	}
+
 	bool evictLRU()
 	{
 		ScopedTxn txn(database->beginTxn());
@@ -709,7 +853,6 @@ private:
 		Database::closeCursor(cursor);
 
 		// Delete the cached object identified by the oldest entry in the LRU table from all tables.
-		Database::deleteKey(txn, moduleTable, moduleKey);
 		Database::deleteKey(txn, objectTable, moduleKey);
 		Database::deleteKey(txn, metaTable, moduleKey);
 		Database::deleteKey(txn, lruTable, lastAccessTimeKey);
@@ -717,9 +860,11 @@ private:
 		// Commit the delete.
 		txn.commit();
 
+		const Hash128 moduleHash = moduleKey.getModuleHash();
 		Log::printf(Log::debug,
-					"Evicted %16" PRIx64 " from the object cache.\n",
-					moduleKey.getModuleHash());
+					"Evicted %16" PRIx64 "%16" PRIx64 " from the object cache.\n",
+					moduleHash.high,
+					moduleHash.low);
 
 		return true;
 	}
@@ -730,9 +875,8 @@ OpenResult ObjectCache::open(const char* path,
 							 U64 codeKey,
 							 std::shared_ptr<Runtime::ObjectCacheInterface>& outObjectCache)
 {
-	LMDBObjectCache lmdbObjectCache;
-	OpenResult result = lmdbObjectCache.init(path, maxBytes, codeKey);
-	if(result == OpenResult::success)
-	{ outObjectCache = std::make_shared<LMDBObjectCache>(std::move(lmdbObjectCache)); }
+	std::shared_ptr<LMDBObjectCache> lmdbObjectCache = std::make_shared<LMDBObjectCache>();
+	OpenResult result = lmdbObjectCache->init(path, maxBytes, codeKey);
+	if(result == OpenResult::success) { outObjectCache = lmdbObjectCache; }
 	return result;
 }
@@ -21,18 +21,22 @@ extern "C" const char* __asan_default_options()
 		   ":replace_intrin=false";
 }
 
-CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop)
+CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop, Uptr maxFrames)
 {
 	CallStack result;
 
 #if WAVM_ENABLE_UNWIND
+	if(!maxFrames) { return result; }
+
 	unw_context_t context;
 	WAVM_ERROR_UNLESS(!unw_getcontext(&context));
 
 	unw_cursor_t cursor;
 
 	WAVM_ERROR_UNLESS(!unw_init_local(&cursor, &context));
-	for(Uptr frameIndex = 0; !result.frames.isFull() && unw_step(&cursor) > 0; ++frameIndex)
+	for(Uptr frameIndex = 0;
+		!result.frames.isFull() && result.frames.size() < maxFrames && unw_step(&cursor) > 0;
+		++frameIndex)
 	{
 		if(frameIndex >= numOmittedFramesFromTop)
 		{
@@ -82,3 +86,17 @@ bool Platform::getInstructionSourceByAddress(Uptr ip, InstructionSource& outSour
 #endif
 	return false;
 }
+
+bool Platform::getFunctionAddressByInstructionAddress(Uptr ip, Uptr& outFunctionAddress)
+{
+#if defined(__linux__) || defined(__APPLE__)
+	Dl_info symbolInfo;
+	if(dladdr((void*)ip, &symbolInfo))
+	{
+		outFunctionAddress = reinterpret_cast<Uptr>(symbolInfo.dli_sname ? symbolInfo.dli_saddr
+																		  : symbolInfo.dli_fbase);
+		return true;
+	}
+#endif
+	return false;
+}
@@ -28,10 +28,13 @@ Platform::Event::Event()
 	WAVM_ERROR_UNLESS(!pthread_condattr_setclock(&conditionVariableAttr, CLOCK_MONOTONIC));
 #endif
 
-	WAVM_ERROR_UNLESS(!pthread_cond_init((pthread_cond_t*)&pthreadCond, nullptr));
+	WAVM_ERROR_UNLESS(
+		!pthread_cond_init((pthread_cond_t*)&pthreadCond, &conditionVariableAttr));
 	WAVM_ERROR_UNLESS(!pthread_mutex_init((pthread_mutex_t*)&pthreadMutex, nullptr));
 
 	WAVM_ERROR_UNLESS(!pthread_condattr_destroy(&conditionVariableAttr));
+
+	isSignaled = false;
 }
 
 Platform::Event::~Event()
@@ -44,44 +47,66 @@ bool Platform::Event::wait(Time waitDuration)
 {
 	WAVM_ERROR_UNLESS(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
 
-	int result;
-	if(isInfinity(waitDuration))
+	// Compute the absolute monotonic clock timeout.
+	const I128 untilTimeNS = isInfinity(waitDuration)
+								 ? I128(0)
+								 : getClockTime(Clock::monotonic).ns + waitDuration.ns;
+#ifndef __APPLE__
+	timespec untilTimeSpec;
+	if(!isInfinity(waitDuration))
 	{
-		result = pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
+		untilTimeSpec.tv_sec = U64(untilTimeNS / 1000000000);
+		untilTimeSpec.tv_nsec = U64(untilTimeNS % 1000000000);
 	}
-	else
+#endif
+
+	// Loop until the event is signaled, since the condition variable may wake spuriously, e.g.
+	// when a signal handler interrupts the wait.
+	while(!isSignaled)
 	{
-		// Use the non-POSIX relative time wait on Mac, and an absolute monotonic clock timeout on
-		// other POSIX systems.
+		int result;
+		if(isInfinity(waitDuration))
+		{
+			result
+				= pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
+		}
+		else
+		{
 #ifdef __APPLE__
-		timespec waitTimeSpec;
-		waitTimeSpec.tv_sec = U64(waitDuration.ns / 1000000000);
-		waitTimeSpec.tv_nsec = U64(waitDuration.ns % 1000000000);
+			// Mac uses a non-POSIX relative time wait, so wait for the time remaining until the
+			// timeout, rather than restarting the full wait after each spurious wakeup.
+			I128 remainingNS = untilTimeNS - getClockTime(Clock::monotonic).ns;
+			if(remainingNS < 0) { remainingNS = 0; }
+			timespec waitTimeSpec;
+			waitTimeSpec.tv_sec = U64(remainingNS / 1000000000);
+			waitTimeSpec.tv_nsec = U64(remainingNS % 1000000000);
 
-		result = pthread_cond_timedwait_relative_np(
-			(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &waitTimeSpec);
+			result = pthread_cond_timedwait_relative_np(
+				(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &waitTimeSpec);
 #else
-		const I128 untilTimeNS = getClockTime(Clock::monotonic).ns + waitDuration.ns;
-		timespec untilTimeSpec;
-		untilTimeSpec.tv_sec = U64(untilTimeNS / 1000000000);
-		untilTimeSpec.tv_nsec = U64(untilTimeNS % 1000000000);
-
-		result = pthread_cond_timedwait(
-			(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
+			result = pthread_cond_timedwait(
+				(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
 #endif
+		}
+
+		// POSIX doesn't allow the waits to fail with EINTR, but treat it as a spurious wakeup on
+		// systems that do.
+		if(result == ETIMEDOUT) { break; }
+		WAVM_ERROR_UNLESS(!result || result == EINTR);
 	}
 
+	const bool wasSignaled = isSignaled;
+	isSignaled = false;
+
 	WAVM_ERROR_UNLESS(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
 
-	if(result == ETIMEDOUT) { return false; }
-	else
-	{
-		WAVM_ERROR_UNLESS(!result);
-		return true;
-	}
+	return wasSignaled;
 }
 
 void Platform::Event::signal()
 {
+	WAVM_ERROR_UNLESS(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
+	isSignaled = true;
 	WAVM_ERROR_UNLESS(!pthread_cond_signal((pthread_cond_t*)&pthreadCond));
+	WAVM_ERROR_UNLESS(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
 }
@@ -0,0 +1,84 @@
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Futex.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+#ifdef __linux__
+bool Platform::isFutexSupported() { return true; }
+
+FutexWaitResult Platform::futexWait(U32* address, U32 expectedValue, Time waitDuration)
+{
+	const I128 untilTimeNS = isInfinity(waitDuration)
+								 ? I128(0)
+								 : getClockTime(Clock::monotonic).ns + waitDuration.ns;
+	while(true)
+	{
+		// FUTEX_WAIT takes a timeout relative to the monotonic clock.
+		timespec timeoutSpec;
+		timespec* timeoutSpecPointer = nullptr;
+		if(!isInfinity(waitDuration))
+		{
+			I128 remainingNS = untilTimeNS - getClockTime(Clock::monotonic).ns;
+			if(remainingNS < 0) { remainingNS = 0; }
+			timeoutSpec.tv_sec = time_t(remainingNS / 1000000000);
+			timeoutSpec.tv_nsec = long(remainingNS % 1000000000);
+			timeoutSpecPointer = &timeoutSpec;
+		}
+
+		if(!syscall(SYS_futex,
+					address,
+					FUTEX_WAIT_PRIVATE,
+					expectedValue,
+					timeoutSpecPointer,
+					nullptr,
+					0))
+		{ return FutexWaitResult::woken; }
+
+		switch(errno)
+		{
+		// If a wait that was interrupted by a signal handler finds the value has changed when it
+		// is retried, the thread can't tell whether it would have been woken, so report the
+		// mismatch.
+		case EAGAIN: return FutexWaitResult::valueMismatch;
+		case ETIMEDOUT: return FutexWaitResult::timedOut;
+		case EFAULT: return FutexWaitResult::accessViolation;
+		case EINTR: break;
+		default: Errors::fatalf("FUTEX_WAIT failed: %s", strerror(errno));
+		};
+	};
+}
+
+Uptr Platform::futexWake(U32* address, Uptr numToWake)
+{
+	const int numToWakeInt = numToWake > INT_MAX ? INT_MAX : int(numToWake);
+	const long result
+		= syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, numToWakeInt, nullptr, nullptr, 0);
+	if(result < 0) { Errors::fatalf("FUTEX_WAKE failed: %s", strerror(errno)); }
+	return Uptr(result);
+}
+#else
+bool Platform::isFutexSupported() { return false; }
+
+FutexWaitResult Platform::futexWait(U32* address, U32 expectedValue, Time waitDuration)
+{
+	WAVM_UNREACHABLE();
+}
+
+Uptr Platform::futexWake(U32* address, Uptr numToWake) { WAVM_UNREACHABLE(); }
+#endif
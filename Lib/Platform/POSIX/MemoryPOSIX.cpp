@@ -1,8 +1,11 @@
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
 #include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
@@ -11,6 +14,10 @@
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 #ifdef __APPLE__
 #define MAP_ANONYMOUS MAP_ANON
 #endif
@@ -157,6 +164,26 @@ void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 	}
 }
 
+void Platform::discardVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	auto numBytes = numPages << getBytesPerPageLog2();
+	if(madvise(baseVirtualAddress, numBytes, MADV_DONTNEED))
+	{
+		Errors::fatalf("madvise(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", MADV_DONTNEED) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+	if(mprotect(baseVirtualAddress, numBytes, PROT_NONE))
+	{
+		Errors::fatalf("mprotect(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", PROT_NONE) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+}
+
 void Platform::freeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
@@ -181,6 +208,150 @@ void Platform::freeAlignedVirtualPages(U8* unalignedBaseAddress, Uptr numPages,
 	}
 }
 
+struct Platform::CopyOnWriteImage
+{
+	int fd;
+	Uptr numPages;
+};
+
+static int createAnonymousFile()
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+	return int(syscall(SYS_memfd_create, "WAVM copy-on-write image", 0));
+#else
+	// Create a uniquely named shared memory object, and unlink it immediately so it is freed when
+	// the last file descriptor and mapping of it are closed.
+	static std::atomic<U32> nextImageIndex{0};
+	char name[32];
+	snprintf(name, sizeof(name), "/wavm-%d-%u", int(getpid()), nextImageIndex++);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd >= 0) { shm_unlink(name); }
+	return fd;
+#endif
+}
+
+static bool isPageZero(const U8* pageAddress)
+{
+	const U64* words = reinterpret_cast<const U64*>(pageAddress);
+	const Uptr numWords = getBytesPerPage() / sizeof(U64);
+	for(Uptr wordIndex = 0; wordIndex < numWords; ++wordIndex)
+	{
+		if(words[wordIndex]) { return false; }
+	}
+	return true;
+}
+
+CopyOnWriteImage* Platform::createCopyOnWriteImage(const U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(const_cast<U8*>(baseVirtualAddress)));
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+
+	int fd = createAnonymousFile();
+	if(fd < 0) { return nullptr; }
+	if(ftruncate(fd, off_t(numBytes)))
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	// Copy the pages into the file through a temporary shared mapping. Pages that are entirely
+	// zero are skipped, so the file doesn't allocate memory for them.
+	if(numBytes)
+	{
+		U8* fileBase = (U8*)mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(fileBase == MAP_FAILED)
+		{
+			close(fd);
+			return nullptr;
+		}
+		const Uptr numBytesPerPage = getBytesPerPage();
+		for(Uptr offset = 0; offset < numBytes; offset += numBytesPerPage)
+		{
+			if(!isPageZero(baseVirtualAddress + offset))
+			{ memcpy(fileBase + offset, baseVirtualAddress + offset, numBytesPerPage); }
+		}
+		WAVM_ERROR_UNLESS(!munmap(fileBase, numBytes));
+	}
+
+	return new CopyOnWriteImage{fd, numPages};
+}
+
+void Platform::destroyCopyOnWriteImage(CopyOnWriteImage* image)
+{
+	WAVM_ERROR_UNLESS(!close(image->fd));
+	delete image;
+}
+
+void Platform::mapCopyOnWriteImage(CopyOnWriteImage* image, U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	WAVM_ERROR_UNLESS(numPages <= image->numPages);
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	if(numBytes
+	   && mmap(baseVirtualAddress,
+			   numBytes,
+			   PROT_READ | PROT_WRITE,
+			   MAP_FIXED | MAP_PRIVATE,
+			   image->fd,
+			   0)
+			  == MAP_FAILED)
+	{
+		Errors::fatalf("mmap(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR
+					   ", PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, %d, 0) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   image->fd,
+					   strerror(errno));
+	}
+}
+
+bool Platform::isCopyOnWriteMappingUnmodified(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+#ifdef __linux__
+	// /proc/self/pagemap contains a 64-bit entry for each virtual page. Writing to a page of a
+	// private file mapping replaces it with an anonymous page, which is either present without the
+	// file page bit set, or swapped out.
+	static constexpr U64 presentBit = U64(1) << 63;
+	static constexpr U64 swappedBit = U64(1) << 62;
+	static constexpr U64 filePageBit = U64(1) << 61;
+
+	int pagemapFD = open("/proc/self/pagemap", O_RDONLY);
+	if(pagemapFD < 0) { return false; }
+
+	const Uptr firstPageIndex = reinterpret_cast<Uptr>(baseVirtualAddress) >> getBytesPerPageLog2();
+	bool isUnmodified = true;
+	U64 entries[512];
+	for(Uptr pageIndex = 0; isUnmodified && pageIndex < numPages;)
+	{
+		const Uptr numEntries = std::min(numPages - pageIndex, Uptr(512));
+		const Uptr numBytes = numEntries * sizeof(U64);
+		if(pread(pagemapFD, entries, numBytes, off_t((firstPageIndex + pageIndex) * sizeof(U64)))
+		   != ssize_t(numBytes))
+		{
+			isUnmodified = false;
+			break;
+		}
+
+		for(Uptr entryIndex = 0; entryIndex < numEntries; ++entryIndex)
+		{
+			const U64 entry = entries[entryIndex];
+			if((entry & swappedBit) || ((entry & presentBit) && !(entry & filePageBit)))
+			{
+				isUnmodified = false;
+				break;
+			}
+		}
+		pageIndex += numEntries;
+	}
+
+	close(pagemapFD);
+	return isUnmodified;
+#else
+	return false;
+#endif
+}
+
 Uptr Platform::getPeakMemoryUsageBytes()
 {
 	struct rusage ru;
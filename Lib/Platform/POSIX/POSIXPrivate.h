@@ -54,8 +54,9 @@ namespace WAVM { namespace Platform {
 	{
 		SignalContext* outerContext;
 		jmp_buf catchJump;
-		bool (*filter)(void*, Signal, CallStack&&);
+		bool (*filter)(void*, Signal, Uptr&);
 		void* filterArgument;
+		CallStack* outCallStack;
 	};
 
 	struct SigAltStack
@@ -78,6 +79,12 @@ namespace WAVM { namespace Platform {
 	extern thread_local SigAltStack sigAltStack;
 	extern thread_local SignalContext* innermostSignalContext;
 
+	// The bounds of the current thread's non-signal stack, which the sample signal handler walks.
+	// They are set when the thread's signals are initialized, since the handler can't look them
+	// up itself; until then, they are null.
+	extern thread_local U8* sampledStackMinAddr;
+	extern thread_local U8* sampledStackMaxAddr;
+
 	extern bool initThreadAndGlobalSignalsOnce();
 	extern bool initGlobalSignalsOnce();
 
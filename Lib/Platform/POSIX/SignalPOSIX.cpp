@@ -1,5 +1,8 @@
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <atomic>
 #include "POSIXPrivate.h"
@@ -57,22 +60,23 @@ static void maskSignals(int how)
 	default: Errors::fatalfWithCallStack("unknown signal number: %i", signalNumber); break;
 	};
 
-	// Capture the execution context, omitting this function and the function that called it, so the
-	// top of the callstack is the function that triggered the signal.
-	CallStack callStack = captureCallStack(2);
-
-	// Undo the -1 offset that captureCallStack applied to the trapping IP on the assumption that
-	// the signal trampoline frame is returning from an ordinary call.
-	if(callStack.frames.size()) { callStack.frames[0].ip += 1; }
-
 	// Call the signal handlers, from innermost to outermost, until one returns true.
 	for(SignalContext* signalContext = innermostSignalContext; signalContext;
 		signalContext = signalContext->outerContext)
 	{
-		if(signalContext->filter(signalContext->filterArgument, signal, std::move(callStack)))
+		Uptr maxCallStackFrames = CallStack::maxFrames;
+		if(signalContext->filter(signalContext->filterArgument, signal, maxCallStackFrames))
 		{
-			// siglongjmp won't unwind the stack, so manually call the CallStack destructor.
-			callStack.~CallStack();
+			// Capture the execution context, omitting this function and the function that called
+			// it, so the top of the callstack is the function that triggered the signal. The call
+			// stack is written to the catchSignals caller's frame, so it doesn't need to be
+			// destroyed before the siglongjmp.
+			CallStack& callStack = *signalContext->outCallStack;
+			callStack = captureCallStack(2, maxCallStackFrames);
+
+			// Undo the -1 offset that captureCallStack applied to the trapping IP on the
+			// assumption that the signal trampoline frame is returning from an ordinary call.
+			if(callStack.frames.size()) { callStack.frames[0].ip += 1; }
 
 			// Jump back to the execution context that was saved in catchSignals.
 			siglongjmp(signalContext->catchJump, 1);
@@ -103,8 +107,9 @@ bool Platform::initGlobalSignalsOnce()
 }
 
 bool Platform::catchSignals(void (*thunk)(void*),
-							bool (*filter)(void*, Signal, CallStack&&),
-							void* argument)
+							bool (*filter)(void*, Signal, Uptr&),
+							void* argument,
+							CallStack& outCallStack)
 {
 	initThreadAndGlobalSignals();
 
@@ -112,6 +117,7 @@ bool Platform::catchSignals(void (*thunk)(void*),
 	signalContext.outerContext = innermostSignalContext;
 	signalContext.filter = filter;
 	signalContext.filterArgument = argument;
+	signalContext.outCallStack = &outCallStack;
 
 #ifdef __WAVIX__
 	Errors::unimplemented("Wavix catchSignals");
@@ -145,6 +151,149 @@ bool Platform::catchSignals(void (*thunk)(void*),
 	return isReturningFromSignalHandler;
 }
 
+#if(defined(__linux__) || defined(__APPLE__)) && (defined(__x86_64__) || defined(__aarch64__))
+#define IS_SAMPLING_SUPPORTED 1
+#else
+#define IS_SAMPLING_SUPPORTED 0
+#endif
+
+#if IS_SAMPLING_SUPPORTED
+static std::atomic<void (*)(const CallStack&)> sampleCallback{nullptr};
+static std::atomic<Uptr> numRunningSampleHandlers{0};
+
+// Reads the program counter, frame pointer, and stack pointer of the code that a signal
+// interrupted from the context passed to the signal handler.
+static void getInterruptedRegisters(const void* contextVoid, Uptr& outPC, Uptr& outFP, Uptr& outSP)
+{
+	const ucontext_t* context = (const ucontext_t*)contextVoid;
+#if defined(__linux__) && defined(__x86_64__)
+	outPC = Uptr(context->uc_mcontext.gregs[REG_RIP]);
+	outFP = Uptr(context->uc_mcontext.gregs[REG_RBP]);
+	outSP = Uptr(context->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__linux__) && defined(__aarch64__)
+	outPC = Uptr(context->uc_mcontext.pc);
+	outFP = Uptr(context->uc_mcontext.regs[29]);
+	outSP = Uptr(context->uc_mcontext.sp);
+#elif defined(__APPLE__) && defined(__x86_64__)
+	outPC = Uptr(context->uc_mcontext->__ss.__rip);
+	outFP = Uptr(context->uc_mcontext->__ss.__rbp);
+	outSP = Uptr(context->uc_mcontext->__ss.__rsp);
+#elif defined(__APPLE__) && defined(__aarch64__)
+	outPC = Uptr(__darwin_arm_thread_state64_get_pc(context->uc_mcontext->__ss));
+	outFP = Uptr(__darwin_arm_thread_state64_get_fp(context->uc_mcontext->__ss));
+	outSP = Uptr(__darwin_arm_thread_state64_get_sp(context->uc_mcontext->__ss));
+#endif
+}
+
+// Captures the call stack of the interrupted code by following the chain of frame records that
+// the frame pointer points to: each holds the caller's frame pointer, followed by the return
+// address into the caller. The frame records are only read if they are between the interrupted
+// stack pointer and the top of the thread's stack, which are always mapped, so a frame pointer
+// that is used as a general purpose register can't cause a fault; it just ends the walk.
+static void walkFramePointers(Uptr pc, Uptr fp, Uptr sp, CallStack& outCallStack)
+{
+	outCallStack.frames.push_back(CallStack::Frame{pc});
+
+	// If the interrupted code wasn't running on the thread's stack, e.g. if the thread hasn't
+	// initialized its stack bounds, only capture the program counter.
+	const Uptr stackMinAddr = reinterpret_cast<Uptr>(sampledStackMinAddr);
+	const Uptr stackMaxAddr = reinterpret_cast<Uptr>(sampledStackMaxAddr);
+	if(sp < stackMinAddr || sp >= stackMaxAddr) { return; }
+
+	// Each frame record must be above the previous one, so the walk always terminates.
+	Uptr minFrameRecordAddr = sp;
+	while(outCallStack.frames.size() < CallStack::maxFrames)
+	{
+		if(fp < minFrameRecordAddr || fp > stackMaxAddr - sizeof(Uptr) * 2
+		   || (fp & (sizeof(Uptr) - 1)))
+		{ break; }
+
+		const Uptr* frameRecord = reinterpret_cast<const Uptr*>(fp);
+		const Uptr callerFP = frameRecord[0];
+		const Uptr returnAddress = frameRecord[1];
+		if(!returnAddress) { break; }
+
+		// Subtract 1 from the return address, as captureCallStack does, so it's in the call
+		// instruction rather than the instruction after it.
+		outCallStack.frames.push_back(CallStack::Frame{returnAddress - 1});
+
+		minFrameRecordAddr = fp + sizeof(Uptr) * 2;
+		fp = callerFP;
+	}
+}
+
+// Only uses async-signal-safe operations: it reads the interrupted registers, walks the frame
+// pointers into a call stack on the signal stack, and passes it to the callback. It doesn't use
+// libunwind, which takes locks and may allocate memory, and doesn't symbolize the frames.
+static void sampleSignalHandler(int, siginfo_t*, void* context)
+{
+	const int savedErrno = errno;
+
+	// Count the running handlers before reading the callback, so stopSampling can wait for any
+	// handler that read the callback before it was cleared.
+	++numRunningSampleHandlers;
+	void (*callback)(const CallStack&) = sampleCallback.load();
+	if(callback)
+	{
+		Uptr pc = 0;
+		Uptr fp = 0;
+		Uptr sp = 0;
+		getInterruptedRegisters(context, pc, fp, sp);
+
+		CallStack callStack;
+		walkFramePointers(pc, fp, sp, callStack);
+		callback(callStack);
+	}
+	--numRunningSampleHandlers;
+
+	errno = savedErrno;
+}
+
+bool Platform::startSampling(Uptr samplesPerSecond, void (*callback)(const CallStack&))
+{
+	WAVM_ASSERT(samplesPerSecond > 0 && samplesPerSecond <= 1000000);
+
+	void (*expectedCallback)(const CallStack&) = nullptr;
+	if(!sampleCallback.compare_exchange_strong(expectedCallback, callback)) { return false; }
+
+	// The handler is left installed by stopSampling, since the default action for a SIGPROF that
+	// was already pending when the timer was stopped would terminate the process. SA_RESTART
+	// restarts most system calls that are interrupted by a sample, but not all of them, so
+	// blocking waits must still retry if they fail with EINTR.
+	struct sigaction signalAction;
+	signalAction.sa_sigaction = sampleSignalHandler;
+	signalAction.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+	sigemptyset(&signalAction.sa_mask);
+	WAVM_ERROR_UNLESS(!sigaction(SIGPROF, &signalAction, nullptr));
+
+	const Uptr intervalMicroseconds = 1000000 / samplesPerSecond;
+	struct itimerval timer;
+	timer.it_interval.tv_sec = intervalMicroseconds / 1000000;
+	timer.it_interval.tv_usec = intervalMicroseconds % 1000000;
+	timer.it_value = timer.it_interval;
+	WAVM_ERROR_UNLESS(!setitimer(ITIMER_PROF, &timer, nullptr));
+
+	return true;
+}
+
+void Platform::stopSampling()
+{
+	struct itimerval timer = {};
+	WAVM_ERROR_UNLESS(!setitimer(ITIMER_PROF, &timer, nullptr));
+
+	sampleCallback.store(nullptr);
+	while(numRunningSampleHandlers.load()) { sched_yield(); }
+}
+#else
+bool Platform::startSampling(Uptr samplesPerSecond, void (*callback)(const CallStack&))
+{
+	// The sample signal handler can't read the interrupted registers on this platform.
+	return false;
+}
+
+void Platform::stopSampling() {}
+#endif
+
 // The LLVM project libunwind implementation that WAVM uses matches the Apple ABI, which expects
 // __register_frame and __deregister_frame to be called for each FDE in the .eh_frame section.
 #if WAVM_ENABLE_UNWIND || defined(__APPLE__)
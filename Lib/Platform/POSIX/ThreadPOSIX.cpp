@@ -142,6 +142,10 @@ WAVM_NO_ASAN static void touchStackPages(U8* minAddr, Uptr numBytesPerPage)
 bool Platform::initThreadAndGlobalSignalsOnce()
 {
 	sigAltStack.init();
+
+	U8* stackMinGuardAddr;
+	sigAltStack.getNonSignalStack(stackMinGuardAddr, sampledStackMinAddr, sampledStackMaxAddr);
+
 	initGlobalSignals();
 	return true;
 }
@@ -218,6 +222,8 @@ void SigAltStack::getNonSignalStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*&
 }
 
 thread_local SigAltStack Platform::sigAltStack;
+thread_local U8* Platform::sampledStackMinAddr = nullptr;
+thread_local U8* Platform::sampledStackMaxAddr = nullptr;
 
 WAVM_NO_ASAN static void* createThreadEntry(void* argsVoid)
 {
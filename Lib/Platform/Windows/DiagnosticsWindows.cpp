@@ -110,7 +110,25 @@ bool Platform::getInstructionSourceByAddress(Uptr ip, InstructionSource& outSour
 	}
 }
 
-CallStack Platform::unwindStack(const CONTEXT& immutableContext, Uptr numOmittedFramesFromTop)
+bool Platform::getFunctionAddressByInstructionAddress(Uptr ip, Uptr& outFunctionAddress)
+{
+	DbgHelp* dbgHelp = DbgHelp::get();
+
+	// SymFromAddr requires room for at least one character of the symbol's name.
+	SYMBOL_INFO symbolInfo;
+	ZeroMemory(&symbolInfo, sizeof(symbolInfo));
+	symbolInfo.SizeOfStruct = sizeof(SYMBOL_INFO);
+	symbolInfo.MaxNameLen = 1;
+
+	U64 displacement;
+	if(!dbgHelp->symFromAddr(GetCurrentProcess(), ip, &displacement, &symbolInfo)) { return false; }
+	outFunctionAddress = Uptr(symbolInfo.Address);
+	return true;
+}
+
+CallStack Platform::unwindStack(const CONTEXT& immutableContext,
+								Uptr numOmittedFramesFromTop,
+								Uptr maxFrames)
 {
 	// Make a mutable copy of the context.
 	CONTEXT context;
@@ -120,7 +138,9 @@ CallStack Platform::unwindStack(const CONTEXT& immutableContext, Uptr numOmitted
 	// reached the base.
 	CallStack callStack;
 #if WAVM_ENABLE_UNWIND
-	for(Uptr frameIndex = 0; !callStack.frames.isFull() && context.Rip; ++frameIndex)
+	for(Uptr frameIndex = 0;
+		!callStack.frames.isFull() && callStack.frames.size() < maxFrames && context.Rip;
+		++frameIndex)
 	{
 		if(frameIndex >= numOmittedFramesFromTop)
 		{
@@ -157,12 +177,14 @@ CallStack Platform::unwindStack(const CONTEXT& immutableContext, Uptr numOmitted
 	return callStack;
 }
 
-CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop)
+CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop, Uptr maxFrames)
 {
+	if(!maxFrames) { return CallStack(); }
+
 	// Capture the current processor state.
 	CONTEXT context;
 	RtlCaptureContext(&context);
 
 	// Unwind the stack.
-	return unwindStack(context, numOmittedFramesFromTop + 1);
+	return unwindStack(context, numOmittedFramesFromTop + 1, maxFrames);
 }
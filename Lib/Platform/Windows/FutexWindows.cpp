@@ -0,0 +1,18 @@
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Futex.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// WakeByAddress doesn't return the number of threads it woke, so WaitOnAddress can't be used to
+// implement futexWake.
+bool Platform::isFutexSupported() { return false; }
+
+FutexWaitResult Platform::futexWait(U32* address, U32 expectedValue, Time waitDuration)
+{
+	WAVM_UNREACHABLE();
+}
+
+Uptr Platform::futexWake(U32* address, Uptr numToWake) { WAVM_UNREACHABLE(); }
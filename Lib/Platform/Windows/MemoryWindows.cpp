@@ -133,6 +133,13 @@ void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 	if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
 }
 
+void Platform::discardVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	// MEM_DECOMMIT doesn't replace the pages' mapping, so it's also the cheapest way to discard
+	// pages.
+	decommitVirtualPages(baseVirtualAddress, numPages);
+}
+
 void Platform::freeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
@@ -147,6 +154,25 @@ void Platform::freeAlignedVirtualPages(U8* unalignedBaseAddress, Uptr numPages,
 	if(unalignedBaseAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 }
 
+// Copy-on-write file mappings can't be placed in address space reserved by VirtualAlloc, so
+// copy-on-write images aren't supported on Windows.
+CopyOnWriteImage* Platform::createCopyOnWriteImage(const U8* baseVirtualAddress, Uptr numPages)
+{
+	return nullptr;
+}
+
+void Platform::destroyCopyOnWriteImage(CopyOnWriteImage* image) { WAVM_UNREACHABLE(); }
+
+void Platform::mapCopyOnWriteImage(CopyOnWriteImage* image, U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_UNREACHABLE();
+}
+
+bool Platform::isCopyOnWriteMappingUnmodified(U8* baseVirtualAddress, Uptr numPages)
+{
+	return false;
+}
+
 Uptr Platform::getPeakMemoryUsageBytes()
 {
 	PROCESS_MEMORY_COUNTERS processMemoryCounters;
@@ -35,6 +35,14 @@ void Platform::deregisterEHFrames(const U8* imageBase, const U8* ehFrames, Uptr
 #endif
 }
 
+bool Platform::startSampling(Uptr samplesPerSecond, void (*sampleCallback)(const CallStack&))
+{
+	// Sampling isn't implemented on Windows.
+	return false;
+}
+
+void Platform::stopSampling() {}
+
 static bool translateSEHToSignal(EXCEPTION_POINTERS* exceptionPointers, Signal& outSignal)
 {
 	// Decide how to handle this exception code.
@@ -60,17 +68,21 @@ static bool translateSEHToSignal(EXCEPTION_POINTERS* exceptionPointers, Signal&
 // __try/__except doesn't support locals with destructors in the same function, so this is just
 // the body of the sehSignalFilterFunction __try pulled out into a function.
 static LONG CALLBACK sehSignalFilterFunctionNonReentrant(EXCEPTION_POINTERS* exceptionPointers,
-														 bool (*filter)(void*, Signal, CallStack&&),
-														 void* context)
+														 bool (*filter)(void*, Signal, Uptr&),
+														 void* context,
+														 CallStack& outCallStack)
 {
 	Signal signal;
 	if(!translateSEHToSignal(exceptionPointers, signal)) { return EXCEPTION_CONTINUE_SEARCH; }
 	else
 	{
-		// Unwind the stack frames from the context of the exception.
-		CallStack callStack = unwindStack(*exceptionPointers->ContextRecord, 0);
-
-		if((*filter)(context, signal, std::move(callStack))) { return EXCEPTION_EXECUTE_HANDLER; }
+		Uptr maxCallStackFrames = CallStack::maxFrames;
+		if((*filter)(context, signal, maxCallStackFrames))
+		{
+			// Unwind the stack frames from the context of the exception.
+			outCallStack = unwindStack(*exceptionPointers->ContextRecord, 0, maxCallStackFrames);
+			return EXCEPTION_EXECUTE_HANDLER;
+		}
 		else
 		{
 			return EXCEPTION_CONTINUE_SEARCH;
@@ -79,12 +91,14 @@ static LONG CALLBACK sehSignalFilterFunctionNonReentrant(EXCEPTION_POINTERS* exc
 }
 
 static LONG CALLBACK sehSignalFilterFunction(EXCEPTION_POINTERS* exceptionPointers,
-											 bool (*filter)(void*, Signal, CallStack&&),
-											 void* context)
+											 bool (*filter)(void*, Signal, Uptr&),
+											 void* context,
+											 CallStack& outCallStack)
 {
 	__try
 	{
-		return sehSignalFilterFunctionNonReentrant(exceptionPointers, filter, context);
+		return sehSignalFilterFunctionNonReentrant(
+			exceptionPointers, filter, context, outCallStack);
 	}
 	__except(Errors::fatal("reentrant exception"), true)
 	{
@@ -93,8 +107,9 @@ static LONG CALLBACK sehSignalFilterFunction(EXCEPTION_POINTERS* exceptionPointe
 }
 
 bool Platform::catchSignals(void (*thunk)(void*),
-							bool (*filter)(void*, Signal, CallStack&&),
-							void* context)
+							bool (*filter)(void*, Signal, Uptr&),
+							void* context,
+							CallStack& outCallStack)
 {
 	initThread();
 
@@ -103,7 +118,7 @@ bool Platform::catchSignals(void (*thunk)(void*),
 		(*thunk)(context);
 		return false;
 	}
-	__except(sehSignalFilterFunction(GetExceptionInformation(), filter, context))
+	__except(sehSignalFilterFunction(GetExceptionInformation(), filter, context, outCallStack))
 	{
 		// After a stack overflow, the stack will be left in a damaged state. Let the CRT repair it.
 		WAVM_ERROR_UNLESS(_resetstkoflw());
@@ -53,7 +53,9 @@ static_assert(sizeof(ExecutionContext) == 272, "unexpected size");
 namespace WAVM { namespace Platform {
 	void initThread();
 
-	CallStack unwindStack(const CONTEXT& immutableContext, Uptr numOmittedFramesFromTop);
+	CallStack unwindStack(const CONTEXT& immutableContext,
+						  Uptr numOmittedFramesFromTop,
+						  Uptr maxFrames = CallStack::maxFrames);
 
 	Time fileTimeToWAVMRealTime(FILETIME fileTime);
 	FILETIME wavmRealTimeToFileTime(Time realTime);
@@ -0,0 +1,169 @@
+#include "WAVM/Platform/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// Worker threads run compiles, which need more stack than the default.
+static constexpr Uptr numWorkerStackBytes = 8 * 1024 * 1024;
+
+// How long a worker thread waits for a job before it exits.
+static const Time maxWorkerIdleTime = Time{I128(10) * 1000000000};
+
+struct Worker
+{
+	Event wakeEvent;
+
+	// Protected by WorkerPool::mutex.
+	std::function<void()> job;
+	bool isIdle = false;
+};
+
+struct WorkerPool
+{
+	Mutex mutex;
+	std::vector<Worker*> idleWorkers;
+	std::deque<std::function<void()>> queuedJobs;
+	Uptr numWorkers = 0;
+
+	// Jobs are queued instead of starting more worker threads than there are hardware threads.
+	const Uptr maxWorkers = std::max(getNumberOfHardwareThreads(), Uptr(1));
+
+	static WorkerPool& get()
+	{
+		// The pool is never destroyed, so worker threads don't need to be joined at exit.
+		static WorkerPool* workerPool = new WorkerPool;
+		return *workerPool;
+	}
+};
+
+static I64 workerThreadMain(void* workerVoid)
+{
+	Worker* worker = (Worker*)workerVoid;
+	WorkerPool& pool = WorkerPool::get();
+	while(true)
+	{
+		std::function<void()> job;
+		{
+			Mutex::Lock poolLock(pool.mutex);
+			if(worker->job) { job = std::move(worker->job); }
+			else if(pool.queuedJobs.size())
+			{
+				job = std::move(pool.queuedJobs.front());
+				pool.queuedJobs.pop_front();
+			}
+			else if(!worker->isIdle)
+			{
+				worker->isIdle = true;
+				pool.idleWorkers.push_back(worker);
+			}
+		}
+
+		if(job)
+		{
+			job();
+			continue;
+		}
+
+		if(!worker->wakeEvent.wait(maxWorkerIdleTime))
+		{
+			// If the wait timed out before the worker was given a job, exit the thread.
+			Mutex::Lock poolLock(pool.mutex);
+			if(worker->isIdle)
+			{
+				auto it = std::find(pool.idleWorkers.begin(), pool.idleWorkers.end(), worker);
+				WAVM_ASSERT(it != pool.idleWorkers.end());
+				pool.idleWorkers.erase(it);
+				--pool.numWorkers;
+				break;
+			}
+		}
+	}
+
+	delete worker;
+	return 0;
+}
+
+void Platform::runAsyncJob(std::function<void()>&& job)
+{
+	WorkerPool& pool = WorkerPool::get();
+	Mutex::Lock poolLock(pool.mutex);
+	if(pool.idleWorkers.size())
+	{
+		Worker* worker = pool.idleWorkers.back();
+		pool.idleWorkers.pop_back();
+		worker->isIdle = false;
+		worker->job = std::move(job);
+		worker->wakeEvent.signal();
+	}
+	else if(pool.numWorkers < pool.maxWorkers)
+	{
+		Worker* worker = new Worker;
+		worker->job = std::move(job);
+		++pool.numWorkers;
+		detachThread(createThread(numWorkerStackBytes, workerThreadMain, worker));
+	}
+	else
+	{
+		pool.queuedJobs.push_back(std::move(job));
+	}
+}
+
+struct ParallelJobs
+{
+	const std::function<void(Uptr)>& job;
+	const Uptr numJobs;
+	std::atomic<Uptr> nextJobIndex{0};
+	std::atomic<Uptr> numFinishedJobs{0};
+	Event finishedEvent;
+
+	ParallelJobs(const std::function<void(Uptr)>& inJob, Uptr inNumJobs)
+	: job(inJob), numJobs(inNumJobs)
+	{
+	}
+};
+
+static void runParallelJobsOnThisThread(ParallelJobs& parallelJobs)
+{
+	while(true)
+	{
+		// job may only be used while there are unfinished jobs, since runParallelJobs returns once
+		// all the jobs have finished.
+		const Uptr jobIndex = parallelJobs.nextJobIndex++;
+		if(jobIndex >= parallelJobs.numJobs) { break; }
+
+		parallelJobs.job(jobIndex);
+		if(++parallelJobs.numFinishedJobs == parallelJobs.numJobs)
+		{ parallelJobs.finishedEvent.signal(); }
+	}
+}
+
+void Platform::runParallelJobs(Uptr numJobs,
+							   Uptr maxParallelism,
+							   const std::function<void(Uptr)>& job)
+{
+	if(!numJobs) { return; }
+
+	// The ParallelJobs is shared with the worker threads, which may not start running until after
+	// this function has returned.
+	std::shared_ptr<ParallelJobs> parallelJobs = std::make_shared<ParallelJobs>(job, numJobs);
+	const Uptr numWorkers = std::min(numJobs, std::max(maxParallelism, Uptr(1))) - 1;
+	for(Uptr workerIndex = 0; workerIndex < numWorkers; ++workerIndex)
+	{ runAsyncJob([parallelJobs]() { runParallelJobsOnThisThread(*parallelJobs); }); }
+
+	runParallelJobsOnThisThread(*parallelJobs);
+	while(parallelJobs->numFinishedJobs.load() != numJobs)
+	{ parallelJobs->finishedEvent.wait(Time::infinity()); }
+}
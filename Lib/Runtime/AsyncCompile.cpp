@@ -0,0 +1,377 @@
+#include <string.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+static constexpr Uptr numCompilePriorities = Uptr(CompilePriority::num);
+
+// A compile of a binary module that is shared by all the pending requests for it.
+struct CompileJob
+{
+	const std::vector<U8> wasmBytes;
+	const IR::FeatureSpec featureSpec;
+	const U64 wasmHash;
+
+	// The remaining fields are protected by AsyncCompilePool::mutex.
+	CompilePriority priority;
+	bool isRunning = false;
+	std::vector<CompileRequestRef> requests;
+
+	CompileJob(std::vector<U8>&& inWASMBytes,
+			   const IR::FeatureSpec& inFeatureSpec,
+			   U64 inWASMHash,
+			   CompilePriority inPriority)
+	: wasmBytes(std::move(inWASMBytes))
+	, featureSpec(inFeatureSpec)
+	, wasmHash(inWASMHash)
+	, priority(inPriority)
+	{
+	}
+};
+
+struct Runtime::CompileRequest
+{
+	const std::function<void(CompileStatus)> onComplete;
+
+	// The remaining fields are protected by AsyncCompilePool::mutex.
+	std::shared_ptr<CompileJob> job;
+	CompileStatus status = CompileStatus::pending;
+	ModuleRef module;
+	WASM::LoadError loadError;
+	std::vector<Platform::Event*> waitEvents;
+
+	CompileRequest(std::function<void(CompileStatus)>&& inOnComplete)
+	: onComplete(std::move(inOnComplete))
+	{
+	}
+};
+
+struct AsyncCompilePool
+{
+	Platform::Mutex mutex;
+	std::deque<std::shared_ptr<CompileJob>> queues[numCompilePriorities];
+	HashMap<U64, std::shared_ptr<CompileJob>> wasmHashToPendingJobMap;
+
+	Uptr maxThreads = 1;
+	Uptr numThreads = 0;
+	Uptr numIdleThreads = 0;
+	Uptr numBusyThreads = 0;
+
+	// Signaled when a job is queued while a thread is idle.
+	Platform::Event wakeEvent;
+
+	static AsyncCompilePool& get()
+	{
+		// The pool is never destroyed, so compile threads don't need to be joined at exit.
+		static AsyncCompilePool* asyncCompilePool = new AsyncCompilePool;
+		return *asyncCompilePool;
+	}
+
+	std::shared_ptr<CompileJob> dequeueHighestPriorityJob()
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+		for(Uptr priorityIndex = numCompilePriorities; priorityIndex > 0; --priorityIndex)
+		{
+			std::deque<std::shared_ptr<CompileJob>>& queue = queues[priorityIndex - 1];
+			if(queue.size())
+			{
+				std::shared_ptr<CompileJob> job = std::move(queue.front());
+				queue.pop_front();
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	Uptr getNumQueuedJobs()
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+		Uptr numQueuedJobs = 0;
+		for(const std::deque<std::shared_ptr<CompileJob>>& queue : queues)
+		{ numQueuedJobs += queue.size(); }
+		return numQueuedJobs;
+	}
+
+	// Wakes an idle compile thread if there is one, and creates new compile threads while there
+	// are more queued jobs than threads that aren't running a job, up to the maximum number of
+	// threads.
+	void startThreadsForQueuedJobs();
+
+	void removeQueuedJob(const std::shared_ptr<CompileJob>& job)
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+		std::deque<std::shared_ptr<CompileJob>>& queue = queues[Uptr(job->priority)];
+		for(auto it = queue.begin(); it != queue.end(); ++it)
+		{
+			if(*it == job)
+			{
+				queue.erase(it);
+				return;
+			}
+		}
+		WAVM_UNREACHABLE();
+	}
+
+	void removePendingJob(const std::shared_ptr<CompileJob>& job)
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+		std::shared_ptr<CompileJob>* pendingJob = wasmHashToPendingJobMap.get(job->wasmHash);
+		if(pendingJob && *pendingJob == job) { wasmHashToPendingJobMap.remove(job->wasmHash); }
+	}
+};
+
+// Sets a request's final status, and wakes any threads waiting for it. Returns the request's
+// completion callback, which the caller must call after unlocking the pool.
+static std::function<void(CompileStatus)> completeRequest(AsyncCompilePool& pool,
+														  CompileRequest& request,
+														  CompileStatus status)
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(pool.mutex);
+	WAVM_ASSERT(request.status == CompileStatus::pending);
+
+	request.status = status;
+	request.job.reset();
+	for(Platform::Event* waitEvent : request.waitEvents) { waitEvent->signal(); }
+	request.waitEvents.clear();
+
+	return request.onComplete;
+}
+
+static void runCompileJob(std::shared_ptr<CompileJob>&& job)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+
+	ModuleRef module;
+	WASM::LoadError loadError;
+	const bool succeeded = loadBinaryModule(
+		job->wasmBytes.data(), job->wasmBytes.size(), module, job->featureSpec, &loadError);
+	const CompileStatus status = succeeded ? CompileStatus::succeeded : CompileStatus::failed;
+
+	std::vector<std::pair<std::function<void(CompileStatus)>, CompileStatus>> callbacks;
+	{
+		Platform::Mutex::Lock lock(pool.mutex);
+		pool.removePendingJob(job);
+
+		for(const CompileRequestRef& request : job->requests)
+		{
+			request->module = module;
+			request->loadError = loadError;
+			std::function<void(CompileStatus)> onComplete
+				= completeRequest(pool, *request, status);
+			if(onComplete) { callbacks.push_back({std::move(onComplete), status}); }
+		}
+		job->requests.clear();
+	}
+
+	for(const auto& callback : callbacks) { callback.first(callback.second); }
+}
+
+static I64 compileThreadMain(void*)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	bool wasBusy = false;
+	while(true)
+	{
+		std::shared_ptr<CompileJob> job;
+		{
+			Platform::Mutex::Lock lock(pool.mutex);
+			if(wasBusy)
+			{
+				--pool.numBusyThreads;
+				wasBusy = false;
+			}
+
+			job = pool.dequeueHighestPriorityJob();
+			if(!job) { ++pool.numIdleThreads; }
+			else
+			{
+				job->isRunning = true;
+				++pool.numBusyThreads;
+				wasBusy = true;
+
+				// wakeEvent only remembers a single signal, so pass it on to another idle thread
+				// if there are more queued jobs.
+				if(pool.numIdleThreads && pool.getNumQueuedJobs()) { pool.wakeEvent.signal(); }
+			}
+		}
+
+		if(job) { runCompileJob(std::move(job)); }
+		else
+		{
+			pool.wakeEvent.wait(Time::infinity());
+
+			Platform::Mutex::Lock lock(pool.mutex);
+			--pool.numIdleThreads;
+		}
+	}
+
+	return 0;
+}
+
+void AsyncCompilePool::startThreadsForQueuedJobs()
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+	const Uptr numQueuedJobs = getNumQueuedJobs();
+	if(!numQueuedJobs) { return; }
+
+	// Threads that aren't running a job are idle, or will dequeue a job before they become idle.
+	if(numIdleThreads) { wakeEvent.signal(); }
+	while(numThreads - numBusyThreads < numQueuedJobs && numThreads < maxThreads)
+	{
+		Platform::detachThread(Platform::createThread(8 * 1024 * 1024, compileThreadMain, nullptr));
+		++numThreads;
+	}
+}
+
+bool Runtime::setAsyncCompileConfig(const AsyncCompileConfig& config)
+{
+	if(config.numThreads < 1) { return false; }
+
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	Platform::Mutex::Lock lock(pool.mutex);
+	pool.maxThreads = config.numThreads;
+	pool.startThreadsForQueuedJobs();
+	return true;
+}
+
+CompileRequestRef Runtime::loadBinaryModuleAsync(const U8* wasmBytes,
+												 Uptr numWASMBytes,
+												 const IR::FeatureSpec& featureSpec,
+												 CompilePriority priority,
+												 std::function<void(CompileStatus)>&& onComplete)
+{
+	WAVM_ASSERT(priority < CompilePriority::num);
+	CompileRequestRef request = std::make_shared<CompileRequest>(std::move(onComplete));
+
+	const U64 wasmHash = XXH<U64>(wasmBytes, numWASMBytes, 0);
+
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	Platform::Mutex::Lock lock(pool.mutex);
+
+	// If there's a pending compile of the same module, add the request to it.
+	std::shared_ptr<CompileJob>* pendingJob = pool.wasmHashToPendingJobMap.get(wasmHash);
+	if(pendingJob && (*pendingJob)->featureSpec == featureSpec
+	   && (*pendingJob)->wasmBytes.size() == numWASMBytes
+	   && !memcmp((*pendingJob)->wasmBytes.data(), wasmBytes, numWASMBytes))
+	{
+		std::shared_ptr<CompileJob> job = *pendingJob;
+		request->job = job;
+		job->requests.push_back(request);
+
+		// Move a queued compile to the queue for the request's priority if it is higher.
+		if(!job->isRunning && priority > job->priority)
+		{
+			pool.removeQueuedJob(job);
+			job->priority = priority;
+			pool.queues[Uptr(priority)].push_back(job);
+		}
+		return request;
+	}
+
+	std::shared_ptr<CompileJob> job = std::make_shared<CompileJob>(
+		std::vector<U8>(wasmBytes, wasmBytes + numWASMBytes), featureSpec, wasmHash, priority);
+	request->job = job;
+	job->requests.push_back(request);
+	pool.queues[Uptr(priority)].push_back(job);
+	pool.wasmHashToPendingJobMap.set(wasmHash, job);
+
+	pool.startThreadsForQueuedJobs();
+
+	return request;
+}
+
+CompileStatus Runtime::getCompileStatus(const CompileRequestRef& request)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	Platform::Mutex::Lock lock(pool.mutex);
+	return request->status;
+}
+
+CompileStatus Runtime::waitForCompile(const CompileRequestRef& request, Time waitDuration)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+
+	Platform::Event waitEvent;
+	{
+		Platform::Mutex::Lock lock(pool.mutex);
+		if(request->status != CompileStatus::pending) { return request->status; }
+		request->waitEvents.push_back(&waitEvent);
+	}
+
+	waitEvent.wait(waitDuration);
+
+	// If the wait timed out, remove the event from the request. completeRequest signals the event
+	// while holding the pool mutex, so it's safe to destroy the event once the mutex is locked.
+	Platform::Mutex::Lock lock(pool.mutex);
+	for(auto it = request->waitEvents.begin(); it != request->waitEvents.end(); ++it)
+	{
+		if(*it == &waitEvent)
+		{
+			request->waitEvents.erase(it);
+			break;
+		}
+	}
+	return request->status;
+}
+
+CompileStatus Runtime::getCompileResult(const CompileRequestRef& request,
+										ModuleRef& outModule,
+										WASM::LoadError* outError)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	Platform::Mutex::Lock lock(pool.mutex);
+	if(request->status == CompileStatus::succeeded) { outModule = request->module; }
+	else if(request->status == CompileStatus::failed && outError)
+	{
+		*outError = request->loadError;
+	}
+	return request->status;
+}
+
+void Runtime::cancelCompile(const CompileRequestRef& request)
+{
+	AsyncCompilePool& pool = AsyncCompilePool::get();
+	std::function<void(CompileStatus)> onComplete;
+	{
+		Platform::Mutex::Lock lock(pool.mutex);
+		if(request->status != CompileStatus::pending) { return; }
+
+		// Remove the request from its job, and if no other requests share the job and it hasn't
+		// started, remove the job from the queue.
+		std::shared_ptr<CompileJob> job = request->job;
+		for(auto it = job->requests.begin(); it != job->requests.end(); ++it)
+		{
+			if(*it == request)
+			{
+				job->requests.erase(it);
+				break;
+			}
+		}
+		if(!job->requests.size() && !job->isRunning)
+		{
+			pool.removeQueuedJob(job);
+			pool.removePendingJob(job);
+		}
+
+		onComplete = completeRequest(pool, *request, CompileStatus::cancelled);
+	}
+
+	if(onComplete) { onComplete(CompileStatus::cancelled); }
+}
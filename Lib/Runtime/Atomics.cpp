@@ -1,17 +1,15 @@
 #include <stdint.h>
-#include <algorithm>
 #include <atomic>
 #include <cmath>
 #include <memory>
 #include <utility>
-#include <vector>
 #include "RuntimePrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
-#include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Futex.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -24,60 +22,68 @@ namespace WAVM { namespace Runtime {
 	WAVM_DEFINE_INTRINSIC_MODULE(wavmIntrinsicsAtomics)
 }}
 
-// Holds a list of threads (in the form of events that will wake them) that
-// are waiting on a specific address.
-struct WaitList
+// A thread that is waiting on an address. Waiters are allocated on the waiting thread's stack, and
+// are linked into the wait list of the shard that the address maps to.
+struct Waiter
 {
-	Platform::Mutex mutex;
-	std::vector<Platform::Event*> wakeEvents;
-	std::atomic<Uptr> numReferences;
-
-	WaitList() : numReferences(1) {}
+	Uptr address;
+	Waiter* next;
+	Waiter* prev;
+	Platform::Event* wakeEvent;
+	bool isWoken;
 };
 
-// An event that is reused within a thread when it waits on a WaitList.
-thread_local std::unique_ptr<Platform::Event> threadWakeEvent = nullptr;
+// A FIFO list of waiting threads for all the addresses that map to the shard. Waiting on or waking
+// an address only locks its shard, so unrelated addresses don't contend on a single global lock.
+struct alignas(64) WaitListShard
+{
+	Platform::Mutex mutex;
+	Waiter* head = nullptr;
+	Waiter* tail = nullptr;
 
-// A map from address to a list of threads waiting on that address.
-static Platform::Mutex addressToWaitListMapMutex;
-static HashMap<Uptr, WaitList*> addressToWaitListMap;
+	// The number of threads waiting on each address with a futex, so waking an address that no
+	// thread is waiting on doesn't need to make a syscall.
+	HashMap<Uptr, Uptr> numFutexWaitersByAddress;
 
-// Opens the wait list for a given address.
-// Increases the wait list's reference count, and returns a pointer to it.
-// Note that it does not lock the wait list mutex.
-// A call to openWaitList should be followed by a call to closeWaitList to avoid leaks.
-static WaitList* openWaitList(Uptr address)
-{
-	Platform::Mutex::Lock mapLock(addressToWaitListMapMutex);
-	auto waitListPtr = addressToWaitListMap.get(address);
-	if(waitListPtr)
-	{
-		++(*waitListPtr)->numReferences;
-		return *waitListPtr;
-	}
-	else
+	void append(Waiter* waiter)
 	{
-		WaitList* waitList = new WaitList();
-		addressToWaitListMap.set(address, waitList);
-		return waitList;
+		waiter->next = nullptr;
+		waiter->prev = tail;
+		if(tail) { tail->next = waiter; }
+		else
+		{
+			head = waiter;
+		}
+		tail = waiter;
 	}
-}
 
-// Closes a wait list, deleting it and removing it from the global map if it was the last reference.
-static void closeWaitList(Uptr address, WaitList* waitList)
-{
-	if(--waitList->numReferences == 0)
+	void remove(Waiter* waiter)
 	{
-		Platform::Mutex::Lock mapLock(addressToWaitListMapMutex);
-		if(!waitList->numReferences)
+		if(waiter->prev) { waiter->prev->next = waiter->next; }
+		else
 		{
-			WAVM_ASSERT(!waitList->wakeEvents.size());
-			delete waitList;
-			addressToWaitListMap.remove(address);
+			head = waiter->next;
 		}
+		if(waiter->next) { waiter->next->prev = waiter->prev; }
+		else
+		{
+			tail = waiter->prev;
+		}
+		waiter->next = waiter->prev = nullptr;
 	}
+};
+
+static constexpr Uptr numWaitListShards = 64;
+static WaitListShard waitListShards[numWaitListShards];
+
+static WaitListShard& getWaitListShard(Uptr address)
+{
+	return waitListShards[Hash<Uptr>()(address) % numWaitListShards];
 }
 
+// An event that is reused within a thread when it waits on a WaitListShard.
+thread_local std::unique_ptr<Platform::Event> threadWakeEvent = nullptr;
+
 // Loads a value from memory with seq_cst memory order.
 // The caller must ensure that the pointer is naturally aligned.
 template<typename Value> static Value atomicLoad(const Value* valuePointer)
@@ -96,16 +102,29 @@ template<typename Value> static void atomicStore(Value* valuePointer, Value newV
 	valuePointerAtomic->store(newValue);
 }
 
+static Time getWaitDuration(I64 timeout)
+{
+	return timeout < 0 ? Time::infinity() : Time{I128(timeout)};
+}
+
 template<typename Value>
 static U32 waitOnAddress(Value* valuePointer, Value expectedValue, I64 timeout)
 {
-	// Open the wait list for this address.
 	const Uptr address = reinterpret_cast<Uptr>(valuePointer);
-	WaitList* waitList = openWaitList(address);
+	WaitListShard& shard = getWaitListShard(address);
+
+	// If the thread hasn't yet created a wake event, do so.
+	if(!threadWakeEvent)
+	{ threadWakeEvent = std::unique_ptr<Platform::Event>(new Platform::Event()); }
+
+	Waiter waiter;
+	waiter.address = address;
+	waiter.wakeEvent = threadWakeEvent.get();
+	waiter.isWoken = false;
 
-	// Lock the wait list, and check that *valuePointer is still what the caller expected it to be.
+	// Lock the shard, and check that *valuePointer is still what the caller expected it to be.
 	{
-		Platform::Mutex::Lock waitListLock(waitList->mutex);
+		Platform::Mutex::Lock shardLock(shard.mutex);
 
 		// Use unwindSignalsAsExceptions to ensure that an access violation signal produced by the
 		// load will be thrown as a Runtime::Exception and unwind the stack (e.g. the locks).
@@ -113,84 +132,113 @@ static U32 waitOnAddress(Value* valuePointer, Value expectedValue, I64 timeout)
 		Runtime::unwindSignalsAsExceptions(
 			[valuePointer, &value] { value = atomicLoad(valuePointer); });
 
-		if(value != expectedValue)
-		{
-			// If *valuePointer wasn't the expected value, unlock the wait list and return.
-			waitListLock.unlock();
-			closeWaitList(address, waitList);
-			return 1;
-		}
-		else
-		{
-			// If the thread hasn't yet created a wake event, do so.
-			if(!threadWakeEvent)
-			{ threadWakeEvent = std::unique_ptr<Platform::Event>(new Platform::Event()); }
+		// If *valuePointer wasn't the expected value, return without waiting.
+		if(value != expectedValue) { return 1; }
 
-			// Add the wake event to the wait list, and unlock the wait list.
-			waitList->wakeEvents.push_back(threadWakeEvent.get());
-			waitListLock.unlock();
-		}
+		// Add the waiter to the shard's wait list.
+		shard.append(&waiter);
 	}
 
 	// Wait for the thread's wake event to be signaled.
-	bool timedOut = false;
-	if(!threadWakeEvent->wait(timeout < 0 ? Time::infinity() : Time{I128(timeout)}))
+	if(!threadWakeEvent->wait(getWaitDuration(timeout)))
 	{
-		// If the wait timed out, lock the wait list and check if the thread's wake event is still
-		// in the wait list.
-		Platform::Mutex::Lock waitListLock(waitList->mutex);
-		auto wakeEventIt = std::find(
-			waitList->wakeEvents.begin(), waitList->wakeEvents.end(), threadWakeEvent.get());
-		if(wakeEventIt != waitList->wakeEvents.end())
+		// If the wait timed out, lock the shard and check if the waiter was woken in the meantime.
+		Platform::Mutex::Lock shardLock(shard.mutex);
+		if(!waiter.isWoken)
 		{
-			// If the event was still on the wait list, remove it, and return the "timed out"
+			// If the waiter is still on the wait list, remove it, and return the "timed out"
 			// result.
-			waitList->wakeEvents.erase(wakeEventIt);
-			timedOut = true;
+			shard.remove(&waiter);
+			return 2;
 		}
 		else
 		{
-			// In between the wait timing out and locking the wait list, some other thread tried to
-			// wake this thread. The event will now be signaled, so use an immediately expiring wait
-			// on it to reset it.
-			WAVM_ERROR_UNLESS(
-				threadWakeEvent->wait(Platform::getClockTime(Platform::Clock::monotonic)));
+			// In between the wait timing out and locking the shard, some other thread woke this
+			// thread. The event has been or will be signaled, so wait on it to reset it.
+			WAVM_ERROR_UNLESS(threadWakeEvent->wait(Time::infinity()));
 		}
 	}
 
-	closeWaitList(address, waitList);
-	return timedOut ? 2 : 0;
+	return 0;
+}
+
+// Waits on a 32-bit address using a futex if the platform supports them. The kernel compares the
+// value and queues the thread atomically, so there is no need for a wait list.
+static U32 waitOnAddress32(Memory* memory, Uptr address, I32 expectedValue, I64 timeout)
+{
+	I32* valuePointer = &memoryRef<I32>(memory, address);
+	if(!Platform::isFutexSupported())
+	{ return waitOnAddress(valuePointer, expectedValue, timeout); }
+
+	// Count the thread as a waiter on the address while it is in futexWait. A thread that wakes
+	// the address after changing its value either sees the count, or the changed value is seen by
+	// futexWait.
+	const Uptr waitAddress = reinterpret_cast<Uptr>(valuePointer);
+	WaitListShard& shard = getWaitListShard(waitAddress);
+	{
+		Platform::Mutex::Lock shardLock(shard.mutex);
+		++shard.numFutexWaitersByAddress.getOrAdd(waitAddress, 0);
+	}
+
+	const Platform::FutexWaitResult result
+		= Platform::futexWait((U32*)valuePointer, U32(expectedValue), getWaitDuration(timeout));
+
+	{
+		Platform::Mutex::Lock shardLock(shard.mutex);
+		Uptr& numFutexWaiters = shard.numFutexWaitersByAddress[waitAddress];
+		if(--numFutexWaiters == 0) { shard.numFutexWaitersByAddress.removeOrFail(waitAddress); }
+	}
+
+	switch(result)
+	{
+	case Platform::FutexWaitResult::woken: return 0;
+	case Platform::FutexWaitResult::valueMismatch: return 1;
+	case Platform::FutexWaitResult::timedOut: return 2;
+	case Platform::FutexWaitResult::accessViolation:
+		throwException(ExceptionTypes::outOfBoundsMemoryAccess, {memory, U64(address)});
+	default: WAVM_UNREACHABLE();
+	};
 }
 
 static U32 wakeAddress(void* pointer, U32 numToWake)
 {
 	if(numToWake == 0) { return 0; }
 
-	// Open the wait list for this address.
+	// numToWake==UINT32_MAX means wake all waiting threads.
+	const Uptr maxToWake = numToWake == UINT32_MAX ? UINTPTR_MAX : Uptr(numToWake);
+
+	// Wake the oldest threads waiting on the address in the shard's wait list.
 	const Uptr address = reinterpret_cast<Uptr>(pointer);
-	WaitList* waitList = openWaitList(address);
-	Uptr actualNumToWake = numToWake;
+	WaitListShard& shard = getWaitListShard(address);
+	Uptr numWoken = 0;
+	bool hasFutexWaiters = false;
 	{
-		Platform::Mutex::Lock waitListLock(waitList->mutex);
+		Platform::Mutex::Lock shardLock(shard.mutex);
+		hasFutexWaiters = shard.numFutexWaitersByAddress.contains(address);
 
-		// Determine how many threads to wake.
-		// numToWake==UINT32_MAX means wake all waiting threads.
-		if(actualNumToWake == UINT32_MAX || actualNumToWake > waitList->wakeEvents.size())
-		{ actualNumToWake = waitList->wakeEvents.size(); }
-
-		// Signal the events corresponding to the oldest waiting threads.
-		for(Uptr wakeIndex = 0; wakeIndex < actualNumToWake; ++wakeIndex)
-		{ waitList->wakeEvents[wakeIndex]->signal(); }
-
-		// Remove the events from the wait list.
-		waitList->wakeEvents.erase(waitList->wakeEvents.begin(),
-								   waitList->wakeEvents.begin() + actualNumToWake);
+		Waiter* waiter = shard.head;
+		while(waiter && numWoken < maxToWake)
+		{
+			// Read the next waiter before waking this one: once it is woken, it may return and
+			// free the Waiter.
+			Waiter* nextWaiter = waiter->next;
+			if(waiter->address == address)
+			{
+				shard.remove(waiter);
+				waiter->isWoken = true;
+				waiter->wakeEvent->signal();
+				++numWoken;
+			}
+			waiter = nextWaiter;
+		}
 	}
-	closeWaitList(address, waitList);
 
-	if(actualNumToWake > UINT32_MAX)
-	{ throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
-	return U32(actualNumToWake);
+	// Wake any threads waiting on the address with a futex.
+	if(numWoken < maxToWake && hasFutexWaiters)
+	{ numWoken += Platform::futexWake((U32*)pointer, maxToWake - numWoken); }
+
+	if(numWoken > UINT32_MAX) { throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return U32(numWoken);
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
@@ -237,10 +285,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 	// Assume that the caller has validated the alignment.
 	WAVM_ASSERT(!(address & 3));
 
-	// Validate that the address is within the memory's bounds, and convert it to a pointer.
-	I32* valuePointer = &memoryRef<I32>(memory, address);
-
-	return waitOnAddress(valuePointer, expectedValue, timeout);
+	return waitOnAddress32(memory, address, expectedValue, timeout);
 }
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 							   "atomic_wait_i64",
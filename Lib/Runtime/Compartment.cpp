@@ -92,6 +92,7 @@ Compartment* Runtime::cloneCompartment(const Compartment* compartment)
 	}
 
 	// Clone exception types.
+	newCompartment->exceptionCallStackDepth.store(compartment->exceptionCallStackDepth.load());
 	for(ExceptionType* exceptionType : compartment->exceptionTypes)
 	{
 		ExceptionType* newExceptionType = cloneExceptionType(exceptionType, newCompartment);
@@ -109,6 +110,14 @@ Compartment* Runtime::cloneCompartment(const Compartment* compartment)
 	return newCompartment;
 }
 
+void Runtime::setCompartmentExceptionCallStackDepth(Compartment* compartment, Uptr maxFrames)
+{
+	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	compartment->exceptionCallStackDepth.store(maxFrames, std::memory_order_relaxed);
+	for(ExceptionType* exceptionType : compartment->exceptionTypes)
+	{ exceptionType->maxCallStackFrames.store(maxFrames, std::memory_order_relaxed); }
+}
+
 Object* Runtime::remapToClonedCompartment(Object* object, const Compartment* newCompartment)
 {
 	if(!object) { return nullptr; }
@@ -6,15 +6,20 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
 using namespace WAVM;
 using namespace WAVM::Runtime;
 
-Context* Runtime::createContext(Compartment* compartment)
+std::atomic<U64> Runtime::currentEpoch{0};
+
+Context* Runtime::createContext(Compartment* compartment, ResourceQuotaRefParam resourceQuota)
 {
 	WAVM_ASSERT(compartment);
+	if(resourceQuota && !resourceQuota->contexts.allocate(1)) { return nullptr; }
+
 	Context* context = new Context(compartment);
 	{
 		Platform::RWMutex::ExclusiveLock lock(compartment->mutex);
@@ -24,8 +29,10 @@ Context* Runtime::createContext(Compartment* compartment)
 		if(context->id == UINTPTR_MAX)
 		{
 			delete context;
+			if(resourceQuota) { resourceQuota->contexts.free(1); }
 			return nullptr;
 		}
+		context->resourceQuota = resourceQuota;
 		context->runtimeData = &compartment->runtimeData->contexts[context->id];
 
 		// Commit the page(s) for the context's runtime data.
@@ -39,6 +46,8 @@ Context* Runtime::createContext(Compartment* compartment)
 			   maxMutableGlobals * sizeof(IR::UntaggedValue));
 
 		context->runtimeData->context = context;
+		context->runtimeData->epochDeadline.store(UINT64_MAX, std::memory_order_release);
+		context->runtimeData->fuel.store(INT64_MAX, std::memory_order_release);
 	}
 
 	return context;
@@ -48,6 +57,9 @@ Runtime::Context::~Context()
 {
 	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
 	compartment->contexts.removeOrFail(id);
+
+	// Free the allocated quota.
+	if(resourceQuota) { resourceQuota->contexts.free(1); }
 }
 
 Compartment* Runtime::getCompartment(const Context* context) { return context->compartment; }
@@ -55,9 +67,80 @@ Compartment* Runtime::getCompartment(const Context* context) { return context->c
 Context* Runtime::cloneContext(const Context* context, Compartment* newCompartment)
 {
 	// Create a new context and initialize its runtime data with the values from the source context.
-	Context* clonedContext = createContext(newCompartment);
+	Context* clonedContext = createContext(newCompartment, context->resourceQuota);
+	if(!clonedContext) { return nullptr; }
 	memcpy(clonedContext->runtimeData->mutableGlobals,
 		   context->runtimeData->mutableGlobals,
 		   maxMutableGlobals * sizeof(IR::UntaggedValue));
+	clonedContext->runtimeData->epochDeadline.store(
+		context->runtimeData->epochDeadline.load(std::memory_order_acquire),
+		std::memory_order_release);
+	clonedContext->runtimeData->fuel.store(
+		context->runtimeData->fuel.load(std::memory_order_acquire), std::memory_order_release);
+	clonedContext->fuelExhaustedHandler = context->fuelExhaustedHandler;
 	return clonedContext;
 }
+
+U64 Runtime::getCurrentEpoch() { return currentEpoch.load(std::memory_order_acquire); }
+
+U64 Runtime::incrementEpoch() { return currentEpoch.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+void Runtime::setContextEpochDeadline(Context* context, U64 epochDeadline)
+{
+	context->runtimeData->epochDeadline.store(epochDeadline, std::memory_order_release);
+}
+
+U64 Runtime::getContextEpochDeadline(const Context* context)
+{
+	return context->runtimeData->epochDeadline.load(std::memory_order_acquire);
+}
+
+void Runtime::interruptContext(Context* context)
+{
+	context->runtimeData->epochDeadline.store(0, std::memory_order_release);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics, "epochDeadlineReached", void, epochDeadlineReached)
+{
+	// Compiled code calls this when it reads an epoch that has reached the context's epoch
+	// deadline, but the deadline may have been moved since then.
+	if(currentEpoch.load(std::memory_order_acquire)
+	   >= contextRuntimeData->epochDeadline.load(std::memory_order_acquire))
+	{ throwException(ExceptionTypes::interrupted); }
+}
+
+void Runtime::setContextFuel(Context* context, I64 fuel)
+{
+	context->runtimeData->fuel.store(fuel, std::memory_order_release);
+}
+
+I64 Runtime::getContextFuel(const Context* context)
+{
+	return context->runtimeData->fuel.load(std::memory_order_acquire);
+}
+
+I64 Runtime::addContextFuel(Context* context, I64 deltaFuel)
+{
+	return context->runtimeData->fuel.fetch_add(deltaFuel, std::memory_order_acq_rel) + deltaFuel;
+}
+
+void Runtime::setContextFuelExhaustedHandler(Context* context, FuelExhaustedHandler&& handler)
+{
+	context->fuelExhaustedHandler = std::move(handler);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
+							   "fuelExhausted",
+							   void,
+							   fuelExhausted,
+							   I64 blockCost)
+{
+	Context* context = contextRuntimeData->context;
+	if(context->fuelExhaustedHandler && context->fuelExhaustedHandler(context)
+	   && contextRuntimeData->fuel.load(std::memory_order_acquire) >= 0)
+	{ return; }
+
+	// The block that exhausted the fuel won't run, so refund its cost.
+	contextRuntimeData->fuel.fetch_add(blockCost, std::memory_order_acq_rel);
+	throwException(ExceptionTypes::outOfFuel);
+}
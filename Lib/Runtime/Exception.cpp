@@ -31,6 +31,23 @@ namespace WAVM { namespace Runtime {
 WAVM_ENUM_INTRINSIC_EXCEPTION_TYPES(DEFINE_INTRINSIC_EXCEPTION_TYPE)
 #undef DEFINE_INTRINSIC_EXCEPTION_TYPE
 
+thread_local Compartment* Runtime::innermostInvokeCompartment = nullptr;
+
+// Returns the maximum number of call stack frames to capture for an exception of the given type.
+// The intrinsic exception types aren't in a compartment, so they are also limited by the call stack
+// depth of the compartment whose code is running on the current thread.
+static Uptr getMaxCallStackFrames(const ExceptionType* type)
+{
+	Uptr maxFrames = type->maxCallStackFrames.load(std::memory_order_relaxed);
+	if(!type->compartment && innermostInvokeCompartment)
+	{
+		const Uptr compartmentMaxFrames
+			= innermostInvokeCompartment->exceptionCallStackDepth.load(std::memory_order_relaxed);
+		if(compartmentMaxFrames < maxFrames) { maxFrames = compartmentMaxFrames; }
+	}
+	return maxFrames;
+}
+
 Runtime::Exception::~Exception()
 {
 	if(finalizeUserData) { (*finalizeUserData)(userData); }
@@ -78,6 +95,9 @@ bool Runtime::getInstructionSourceByAddress(Uptr ip, InstructionSource& outSourc
 // to whatever platform-specific symbol resolution is available.
 std::vector<std::string> Runtime::describeCallStack(const Platform::CallStack& callStack)
 {
+	// Keep the modules that contain the frames' code loaded while their functions are described.
+	LLVMJIT::ModuleUnloadGuard moduleUnloadGuard;
+
 	std::vector<std::string> frameDescriptions;
 	HashSet<Uptr> describedIPs;
 	Uptr frameIndex = 0;
@@ -124,6 +144,7 @@ ExceptionType* Runtime::createExceptionType(Compartment* compartment,
 											std::string&& debugName)
 {
 	auto exceptionType = new ExceptionType(compartment, sig, std::move(debugName));
+	exceptionType->maxCallStackFrames.store(compartment->exceptionCallStackDepth.load());
 
 	Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 	exceptionType->id = compartment->exceptionTypes.add(UINTPTR_MAX, exceptionType);
@@ -142,6 +163,7 @@ ExceptionType* Runtime::cloneExceptionType(ExceptionType* exceptionType,
 	auto newExceptionType = new ExceptionType(
 		newCompartment, exceptionType->sig, std::string(exceptionType->debugName));
 	newExceptionType->id = exceptionType->id;
+	newExceptionType->maxCallStackFrames.store(exceptionType->maxCallStackFrames.load());
 
 	Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 	newCompartment->exceptionTypes.insertOrFail(exceptionType->id, newExceptionType);
@@ -168,6 +190,16 @@ IR::TypeTuple Runtime::getExceptionTypeParameters(const ExceptionType* type)
 	return type->sig.params;
 }
 
+void Runtime::setExceptionTypeCallStackDepth(ExceptionType* type, Uptr maxFrames)
+{
+	type->maxCallStackFrames.store(maxFrames, std::memory_order_relaxed);
+}
+
+Uptr Runtime::getExceptionTypeCallStackDepth(const ExceptionType* type)
+{
+	return type->maxCallStackFrames.load(std::memory_order_relaxed);
+}
+
 Exception* Runtime::createException(ExceptionType* type,
 									const IR::UntaggedValue* arguments,
 									Uptr numArguments,
@@ -254,8 +286,11 @@ std::string Runtime::describeException(const Exception* exception)
 										  const std::vector<IR::UntaggedValue>& arguments)
 {
 	WAVM_ASSERT(type->sig.params.size() == arguments.size());
-	throwException(
-		createException(type, arguments.data(), arguments.size(), Platform::captureCallStack(1)));
+	throwException(createException(
+		type,
+		arguments.data(),
+		arguments.size(),
+		Platform::captureCallStack(1, getMaxCallStackFrames(type))));
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsException,
@@ -269,13 +304,16 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsException,
 	ExceptionType* exceptionType;
 	{
 		Compartment* compartment = getCompartmentRuntimeData(contextRuntimeData)->compartment;
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
 		exceptionType = compartment->exceptionTypes[exceptionTypeId];
 	}
 	auto args = reinterpret_cast<const IR::UntaggedValue*>(Uptr(argsBits));
 
 	Exception* exception = createException(
-		exceptionType, args, exceptionType->sig.params.size(), Platform::captureCallStack(1));
+		exceptionType,
+		args,
+		exceptionType->sig.params.size(),
+		Platform::captureCallStack(1, getMaxCallStackFrames(exceptionType)));
 
 	return reinterpret_cast<Uptr>(exception);
 }
@@ -300,7 +338,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsException,
 	throw exception;
 }
 
-static bool isRuntimeException(const Platform::Signal& signal)
+// Returns the type of the runtime exception that a signal is translated to, or null if the signal
+// isn't a runtime exception.
+static ExceptionType* getSignalExceptionType(const Platform::Signal& signal)
 {
 	switch(signal.type)
 	{
@@ -312,11 +352,20 @@ static bool isRuntimeException(const Platform::Signal& signal)
 		Memory* memory = nullptr;
 		Uptr memoryAddress = 0;
 		U8* badPointer = reinterpret_cast<U8*>(signal.accessViolation.address);
-		return isAddressOwnedByTable(badPointer, table, tableIndex)
-			   || isAddressOwnedByMemory(badPointer, memory, memoryAddress);
+		if(isAddressOwnedByTable(badPointer, table, tableIndex))
+		{ return ExceptionTypes::outOfBoundsTableAccess; }
+		else if(isAddressOwnedByMemory(badPointer, memory, memoryAddress))
+		{
+			return ExceptionTypes::outOfBoundsMemoryAccess;
+		}
+		else
+		{
+			return nullptr;
+		}
 	}
-	case Platform::Signal::Type::stackOverflow:
-	case Platform::Signal::Type::intDivideByZeroOrOverflow: return true;
+	case Platform::Signal::Type::stackOverflow: return ExceptionTypes::stackOverflow;
+	case Platform::Signal::Type::intDivideByZeroOrOverflow:
+		return ExceptionTypes::integerDivideByZeroOrOverflow;
 
 	case Platform::Signal::Type::invalid:
 	default: WAVM_UNREACHABLE();
@@ -399,17 +448,20 @@ void Runtime::unwindSignalsAsExceptions(const std::function<void()>& thunk)
 			   UnwindContext& context = *(UnwindContext*)contextVoid;
 			   (*context.thunk)();
 		   },
-		   [](void* contextVoid, Platform::Signal signal, Platform::CallStack&& callStack) {
-			   if(!isRuntimeException(signal)) { return false; }
+		   [](void* contextVoid, Platform::Signal signal, Uptr& outMaxCallStackFrames) {
+			   ExceptionType* exceptionType = getSignalExceptionType(signal);
+			   if(!exceptionType) { return false; }
 			   else
 			   {
+				   // Only capture as much of the call stack as the exception type asks for.
 				   UnwindContext& context = *(UnwindContext*)contextVoid;
 				   context.signal = signal;
-				   context.callStack = std::move(callStack);
+				   outMaxCallStackFrames = getMaxCallStackFrames(exceptionType);
 				   return true;
 			   }
 		   },
-		   &context))
+		   &context,
+		   context.callStack))
 	{
 		Exception* exception = nullptr;
 		translateSignalToRuntimeException(context.signal, std::move(context.callStack), exception);
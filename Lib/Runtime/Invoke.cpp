@@ -84,6 +84,19 @@ void Runtime::invokeFunction(Context* context,
 	invokeContext.outResults = outResults;
 	invokeContext.invokeThunk = invokeThunk;
 
+	// Set the compartment that traps in the invoked code are attributed to, and restore the outer
+	// invoke's compartment when the invoke returns or unwinds.
+	struct InvokeCompartmentScope
+	{
+		Compartment* outerCompartment;
+		InvokeCompartmentScope(Compartment* compartment)
+		: outerCompartment(innermostInvokeCompartment)
+		{
+			innermostInvokeCompartment = compartment;
+		}
+		~InvokeCompartmentScope() { innermostInvokeCompartment = outerCompartment; }
+	} invokeCompartmentScope(context->compartment);
+
 	// Use unwindSignalsAsExceptions to ensure that any signal that occurs in WebAssembly code calls
 	// C++ destructors on the stack between here and where it is caught.
 	unwindSignalsAsExceptions([&invokeContext] {
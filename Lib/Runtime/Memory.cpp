@@ -1,9 +1,11 @@
 #include "WAVM/Platform/Memory.h"
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <vector>
+#include "ReservedRegionIndex.h"
 #include "RuntimePrivate.h"
 #include "WAVM/IR/IR.h"
 #include "WAVM/IR/Types.h"
@@ -11,6 +13,7 @@
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
@@ -22,18 +25,173 @@ namespace WAVM { namespace Runtime {
 	WAVM_DEFINE_INTRINSIC_MODULE(wavmIntrinsicsMemory)
 }}
 
-// Global lists of memories; used to query whether an address is reserved by one of them.
-static Platform::RWMutex memoriesMutex;
-static std::vector<Memory*> memories;
+// Global index of the address space reserved by memories; used to query whether an address is
+// reserved by one of them.
+static ReservedRegionIndex<Memory> memoryRegionIndex;
 
 static constexpr Uptr numGuardPages = 1;
 
+// On a 64-bit runtime, allocate 8GB of address space for each memory.
+// This allows eliding bounds checks on memory accesses, since a 32-bit index + 32-bit offset will
+// always be within the reserved address-space.
+static constexpr Uptr memoryMaxBytes = Uptr(8ull * 1024 * 1024 * 1024);
+
+// The number of bytes in the committed pages of all memories that haven't been destroyed.
+static std::atomic<Uptr> numMemoryCommittedBytes{0};
+
+// The number of snapshots that memory contents have been copied into.
+static std::atomic<U64> numMemorySnapshots{0};
+
 static Uptr getPlatformPagesPerWebAssemblyPageLog2()
 {
 	WAVM_ERROR_UNLESS(Platform::getBytesPerPageLog2() <= IR::numBytesPerPageLog2);
 	return IR::numBytesPerPageLog2 - Platform::getBytesPerPageLog2();
 }
 
+static Uptr getNumReservationPlatformPages()
+{
+	return (memoryMaxBytes >> Platform::getBytesPerPageLog2()) + numGuardPages;
+}
+
+// A pool of the address-space reservations of destroyed memories, which are reused by new memories
+// to avoid mapping and unmapping the whole reservation for each memory.
+struct MemoryReservationPool
+{
+	Platform::Mutex mutex;
+	MemoryPoolConfig config;
+	std::vector<U8*> reservations;
+	U64 numHits = 0;
+	U64 numMisses = 0;
+
+	static MemoryReservationPool& get()
+	{
+		// The pool is never destroyed, so memories may be destroyed during static destruction.
+		static MemoryReservationPool* pool = new MemoryReservationPool;
+		return *pool;
+	}
+};
+
+static U8* acquireMemoryReservation()
+{
+	MemoryReservationPool& pool = MemoryReservationPool::get();
+	{
+		Platform::Mutex::Lock poolLock(pool.mutex);
+		if(pool.reservations.size())
+		{
+			++pool.numHits;
+			U8* baseAddress = pool.reservations.back();
+			pool.reservations.pop_back();
+			return baseAddress;
+		}
+		++pool.numMisses;
+	}
+
+	return Platform::allocateVirtualPages(getNumReservationPlatformPages());
+}
+
+static void releaseMemoryReservation(U8* baseAddress,
+									 Uptr numWebAssemblyPages,
+									 bool isMappedCopyOnWrite)
+{
+	// Decommit the memory's pages, leaving the reservation in the same state as a new one.
+	// Discarding the pages in place is cheaper than remapping them, but would only reset a
+	// copy-on-write mapping of a snapshot to the snapshot's contents, so those are remapped.
+	if(numWebAssemblyPages)
+	{
+		const Uptr numPlatformPages
+			= numWebAssemblyPages << getPlatformPagesPerWebAssemblyPageLog2();
+		if(isMappedCopyOnWrite) { Platform::decommitVirtualPages(baseAddress, numPlatformPages); }
+		else
+		{
+			Platform::discardVirtualPages(baseAddress, numPlatformPages);
+		}
+	}
+
+	MemoryReservationPool& pool = MemoryReservationPool::get();
+	{
+		Platform::Mutex::Lock poolLock(pool.mutex);
+		if(pool.reservations.size() < pool.config.maxPooledReservations)
+		{
+			pool.reservations.push_back(baseAddress);
+			return;
+		}
+	}
+
+	Platform::freeVirtualPages(baseAddress, getNumReservationPlatformPages());
+}
+
+void Runtime::setMemoryPoolConfig(const MemoryPoolConfig& config)
+{
+	MemoryReservationPool& pool = MemoryReservationPool::get();
+	Platform::Mutex::Lock poolLock(pool.mutex);
+	pool.config = config;
+
+	// Free the reservations that exceed the new maximum.
+	while(pool.reservations.size() > config.maxPooledReservations)
+	{
+		Platform::freeVirtualPages(pool.reservations.back(), getNumReservationPlatformPages());
+		pool.reservations.pop_back();
+	}
+
+	// Allocate the reservations that should be available up front.
+	const Uptr numPrereservedReservations
+		= std::min(config.numPrereservedReservations, config.maxPooledReservations);
+	while(pool.reservations.size() < numPrereservedReservations)
+	{
+		U8* baseAddress = Platform::allocateVirtualPages(getNumReservationPlatformPages());
+		if(!baseAddress) { break; }
+		pool.reservations.push_back(baseAddress);
+	}
+}
+
+MemoryPoolMetrics Runtime::getMemoryPoolMetrics()
+{
+	MemoryReservationPool& pool = MemoryReservationPool::get();
+	Platform::Mutex::Lock poolLock(pool.mutex);
+
+	MemoryPoolMetrics metrics;
+	metrics.numHits = pool.numHits;
+	metrics.numMisses = pool.numMisses;
+	metrics.numPooledReservations = pool.reservations.size();
+	metrics.numCommittedBytes = numMemoryCommittedBytes.load(std::memory_order_relaxed);
+	metrics.numSnapshots = numMemorySnapshots.load(std::memory_order_relaxed);
+	return metrics;
+}
+
+struct Runtime::MemorySnapshot
+{
+	Platform::CopyOnWriteImage* const image;
+	const Uptr numPages;
+
+	MemorySnapshot(Platform::CopyOnWriteImage* inImage, Uptr inNumPages)
+	: image(inImage), numPages(inNumPages)
+	{
+	}
+	~MemorySnapshot() { Platform::destroyCopyOnWriteImage(image); }
+};
+
+// Copies the contents of a memory's pages into a new snapshot. Returns null if the platform doesn't
+// support copy-on-write images.
+static std::shared_ptr<MemorySnapshot> createMemorySnapshot(Memory* memory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+	Platform::CopyOnWriteImage* image = Platform::createCopyOnWriteImage(
+		memory->baseAddress, numPages << getPlatformPagesPerWebAssemblyPageLog2());
+	if(!image) { return nullptr; }
+
+	++numMemorySnapshots;
+	return std::make_shared<MemorySnapshot>(image, numPages);
+}
+
+// Returns whether a memory's pages are an unmodified copy-on-write mapping of its snapshot.
+static bool isMemoryMappedFromSnapshot(Memory* memory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+	return memory->snapshot && memory->snapshot->numPages == numPages
+		   && Platform::isCopyOnWriteMappingUnmodified(
+			   memory->baseAddress, numPages << getPlatformPagesPerWebAssemblyPageLog2());
+}
+
 static Memory* createMemoryImpl(Compartment* compartment,
 								IR::MemoryType type,
 								Uptr numPages,
@@ -42,14 +200,8 @@ static Memory* createMemoryImpl(Compartment* compartment,
 {
 	Memory* memory = new Memory(compartment, type, std::move(debugName), resourceQuota);
 
-	// On a 64-bit runtime, allocate 8GB of address space for the memory.
-	// This allows eliding bounds checks on memory accesses, since a 32-bit index + 32-bit offset
-	// will always be within the reserved address-space.
-	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
-	const Uptr memoryMaxBytes = Uptr(8ull * 1024 * 1024 * 1024);
-	const Uptr memoryMaxPages = memoryMaxBytes >> pageBytesLog2;
-
-	memory->baseAddress = Platform::allocateVirtualPages(memoryMaxPages + numGuardPages);
+	// Take an address-space reservation for the memory from the pool, or allocate a new one.
+	memory->baseAddress = acquireMemoryReservation();
 	memory->numReservedBytes = memoryMaxBytes;
 	if(!memory->baseAddress)
 	{
@@ -57,6 +209,9 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
+	// Add the memory to the global index.
+	memoryRegionIndex.add(memory->baseAddress, memory->numReservedBytes, memory);
+
 	// Grow the memory to the type's minimum size.
 	if(!growMemory(memory, numPages))
 	{
@@ -64,12 +219,6 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
-	// Add the memory to the global array.
-	{
-		Platform::RWMutex::ExclusiveLock memoriesLock(memoriesMutex);
-		memories.push_back(memory);
-	}
-
 	return memory;
 }
 
@@ -94,11 +243,40 @@ Memory* Runtime::createMemory(Compartment* compartment,
 			return nullptr;
 		}
 		compartment->runtimeData->memoryBases[memory->id] = memory->baseAddress;
+		compartment->runtimeData->memoryNumBytes[memory->id].store(
+			memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage,
+			std::memory_order_release);
 	}
 
 	return memory;
 }
 
+static bool cloneMemoryPagesCopyOnWrite(Memory* memory, Memory* newMemory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+	if(!numPages) { return false; }
+
+	const Uptr numPlatformPages = numPages << getPlatformPagesPerWebAssemblyPageLog2();
+
+	// The source memory's pages are never remapped: code running in its compartment on other
+	// threads may be writing to them. If the source memory is an unmodified copy-on-write mapping
+	// of a snapshot of all its pages, e.g. because snapshotMemory was called on it, the new memory
+	// can be mapped from the same snapshot. Otherwise, copy the source memory's contents into a
+	// new snapshot that only the new memory is mapped from.
+	std::shared_ptr<MemorySnapshot> snapshot;
+	if(isMemoryMappedFromSnapshot(memory, numPages)) { snapshot = memory->snapshot; }
+	else
+	{
+		snapshot = createMemorySnapshot(memory, numPages);
+		if(!snapshot) { return false; }
+	}
+
+	Platform::mapCopyOnWriteImage(snapshot->image, newMemory->baseAddress, numPlatformPages);
+	newMemory->snapshot = std::move(snapshot);
+	newMemory->isMappedCopyOnWrite = true;
+	return true;
+}
+
 Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 {
 	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
@@ -108,8 +286,10 @@ Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 		newCompartment, memory->type, numPages, std::move(debugName), memory->resourceQuota);
 	if(!newMemory) { return nullptr; }
 
-	// Copy the memory contents to the new memory.
-	memcpy(newMemory->baseAddress, memory->baseAddress, numPages * IR::numBytesPerPage);
+	// Try to share the memory contents with the new memory copy-on-write, and fall back to copying
+	// them if that isn't possible.
+	if(!cloneMemoryPagesCopyOnWrite(memory, newMemory, numPages))
+	{ memcpy(newMemory->baseAddress, memory->baseAddress, numPages * IR::numBytesPerPage); }
 
 	resizingLock.unlock();
 
@@ -121,11 +301,32 @@ Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 		newMemory->id = memory->id;
 		newCompartment->memories.insertOrFail(newMemory->id, newMemory);
 		newCompartment->runtimeData->memoryBases[newMemory->id] = newMemory->baseAddress;
+		newCompartment->runtimeData->memoryNumBytes[newMemory->id].store(
+			newMemory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage,
+			std::memory_order_release);
 	}
 
 	return newMemory;
 }
 
+bool Runtime::snapshotMemory(Memory* memory)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	const Uptr numPages = memory->numPages.load(std::memory_order_acquire);
+	if(!numPages || isMemoryMappedFromSnapshot(memory, numPages)) { return true; }
+
+	std::shared_ptr<MemorySnapshot> snapshot = createMemorySnapshot(memory, numPages);
+	if(!snapshot) { return false; }
+
+	// Remap the memory's pages copy-on-write from the snapshot. The caller guarantees that no code
+	// is accessing the memory, so no writes can be lost between the copy and the remap.
+	Platform::mapCopyOnWriteImage(
+		snapshot->image, memory->baseAddress, numPages << getPlatformPagesPerWebAssemblyPageLog2());
+	memory->snapshot = std::move(snapshot);
+	memory->isMappedCopyOnWrite = true;
+	return true;
+}
+
 Runtime::Memory::~Memory()
 {
 	if(id != UINTPTR_MAX)
@@ -137,28 +338,16 @@ Runtime::Memory::~Memory()
 
 		WAVM_ASSERT(compartment->runtimeData->memoryBases[id] == baseAddress);
 		compartment->runtimeData->memoryBases[id] = nullptr;
+		compartment->runtimeData->memoryNumBytes[id].store(0, std::memory_order_release);
 	}
 
-	// Remove the memory from the global array.
-	{
-		Platform::RWMutex::ExclusiveLock memoriesLock(memoriesMutex);
-		for(Uptr memoryIndex = 0; memoryIndex < memories.size(); ++memoryIndex)
-		{
-			if(memories[memoryIndex] == this)
-			{
-				memories.erase(memories.begin() + memoryIndex);
-				break;
-			}
-		}
-	}
+	// Remove the memory from the global index.
+	if(baseAddress) { memoryRegionIndex.remove(baseAddress, numReservedBytes, this); }
 
-	// Free the virtual address space.
-	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
-	if(numReservedBytes > 0)
-	{
-		Platform::freeVirtualPages(baseAddress,
-								   (numReservedBytes >> pageBytesLog2) + numGuardPages);
-	}
+	// Return the virtual address space to the pool.
+	const Uptr finalNumPages = numPages.load(std::memory_order_acquire);
+	if(baseAddress) { releaseMemoryReservation(baseAddress, finalNumPages, isMappedCopyOnWrite); }
+	numMemoryCommittedBytes -= finalNumPages * IR::numBytesPerPage;
 
 	// Free the allocated quota.
 	if(resourceQuota) { resourceQuota->memoryPages.free(numPages); }
@@ -166,21 +355,7 @@ Runtime::Memory::~Memory()
 
 bool Runtime::isAddressOwnedByMemory(U8* address, Memory*& outMemory, Uptr& outMemoryAddress)
 {
-	// Iterate over all memories and check if the address is within the reserved address space for
-	// each.
-	Platform::RWMutex::ShareableLock memoriesLock(memoriesMutex);
-	for(auto memory : memories)
-	{
-		U8* startAddress = memory->baseAddress;
-		U8* endAddress = memory->baseAddress + memory->numReservedBytes;
-		if(address >= startAddress && address < endAddress)
-		{
-			outMemory = memory;
-			outMemoryAddress = address - startAddress;
-			return true;
-		}
-	}
-	return false;
+	return memoryRegionIndex.find(address, outMemory, outMemoryAddress);
 }
 
 Uptr Runtime::getMemoryNumPages(const Memory* memory)
@@ -223,6 +398,12 @@ bool Runtime::growMemory(Memory* memory, Uptr numPagesToGrow, Uptr* outOldNumPag
 		}
 
 		memory->numPages.store(oldNumPages + numPagesToGrow, std::memory_order_release);
+		if(memory->id != UINTPTR_MAX)
+		{
+			memory->compartment->runtimeData->memoryNumBytes[memory->id].store(
+				(oldNumPages + numPagesToGrow) * IR::numBytesPerPage, std::memory_order_release);
+		}
+		numMemoryCommittedBytes += numPagesToGrow * IR::numBytesPerPage;
 	}
 
 	if(outOldNumPages) { *outOldNumPages = oldNumPages; }
@@ -234,6 +415,11 @@ void Runtime::unmapMemoryPages(Memory* memory, Uptr pageIndex, Uptr numPages)
 	WAVM_ASSERT(pageIndex + numPages > pageIndex);
 	WAVM_ASSERT((pageIndex + numPages) * IR::numBytesPerPage <= memory->numReservedBytes);
 
+	// Decommitted pages can't be distinguished from unmodified pages of a copy-on-write mapping,
+	// so the memory may no longer be cloned from its snapshot without making a new one.
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	memory->snapshot.reset();
+
 	// Decommit the pages.
 	Platform::decommitVirtualPages(memory->baseAddress + pageIndex * IR::numBytesPerPage,
 								   numPages << getPlatformPagesPerWebAssemblyPageLog2());
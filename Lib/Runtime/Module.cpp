@@ -1,5 +1,6 @@
 #include "WAVM/IR/Module.h"
 #include <string.h>
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <utility>
@@ -26,6 +27,9 @@ using namespace WAVM::Runtime;
 Platform::RWMutex globalObjectCacheMutex;
 std::shared_ptr<ObjectCacheInterface> globalObjectCache;
 
+Platform::RWMutex globalCompileOptionsMutex;
+LLVMJIT::CompileOptions globalCompileOptions;
+
 static Value evaluateInitializer(const std::vector<Global*>& moduleGlobals,
 								 InitializerExpression expression)
 {
@@ -61,40 +65,48 @@ void Runtime::setGlobalObjectCache(std::shared_ptr<ObjectCacheInterface>&& objec
 	globalObjectCache = std::move(objectCache);
 }
 
-static std::shared_ptr<ObjectCacheInterface> getGlobalObjectCache()
+std::shared_ptr<ObjectCacheInterface> Runtime::getGlobalObjectCache()
 {
 	Platform::RWMutex::ShareableLock globalObjectCacheLock(globalObjectCacheMutex);
 	return globalObjectCache;
 }
 
+void Runtime::setGlobalCompileOptions(const LLVMJIT::CompileOptions& compileOptions)
+{
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalCompileOptions = compileOptions;
+}
+
+LLVMJIT::CompileOptions Runtime::getGlobalCompileOptions()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalCompileOptions;
+}
+
 ModuleRef Runtime::compileModule(const IR::Module& irModule)
 {
+	const LLVMJIT::CompileOptions compileOptions = getGlobalCompileOptions();
+
 	// Get a pointer to the global object cache, if there is one.
 	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
 
-	std::vector<U8> objectCode;
-	if(!objectCache)
+	ObjectCodeView objectCode;
+	if(!objectCache || compileOptions.tier == LLVMJIT::CompileTier::baseline)
 	{
-		// If there's no global object cache, just compile the module.
-		objectCode = LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
+		// If there's no global object cache, just compile the module. Baseline-tier object code
+		// isn't cached, since the cache should hold the optimized-tier object code.
+		objectCode
+			= LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec(), compileOptions);
 	}
 	else
 	{
-		// Serialize the IR module to WASM.
-		Timing::Timer keyTimer;
-		Serialization::ArrayOutputStream stream;
-		WASM::saveBinaryModule(stream, irModule);
-		Timing::logTimer("Created object cache key from IR module", keyTimer);
-		std::vector<U8> wasmBytes = stream.getBytes();
-
-		// Check for cached object code for the module before compiling it.
-		objectCode
-			= objectCache->getCachedObject(wasmBytes.data(), wasmBytes.size(), [&irModule]() {
-				  return LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
-			  });
+		// Look up each partition of the module in the cache, and compile the partitions that
+		// aren't cached.
+		objectCode = compileModuleWithObjectCache(irModule, compileOptions, *objectCache);
 	}
 
-	return std::make_shared<Runtime::Module>(IR::Module(irModule), std::move(objectCode));
+	return std::make_shared<Runtime::Module>(
+		IR::Module(irModule), std::move(objectCode), compileOptions);
 }
 
 bool Runtime::loadBinaryModule(const U8* wasmBytes,
@@ -103,29 +115,35 @@ bool Runtime::loadBinaryModule(const U8* wasmBytes,
 							   const IR::FeatureSpec& featureSpec,
 							   WASM::LoadError* outError)
 {
-	// Load the module IR.
+	const LLVMJIT::CompileOptions compileOptions = getGlobalCompileOptions();
+
+	// Load the module IR, decoding the function bodies on as many threads as are used to compile.
 	IR::Module irModule(std::move(featureSpec));
 	Serialization::MemoryInputStream stream(wasmBytes, numWASMBytes);
-	if(!WASM::loadBinaryModule(stream, irModule, outError)) { return false; }
+	WASM::LoadOptions loadOptions;
+	loadOptions.numThreads = compileOptions.numThreads;
+	if(!WASM::loadBinaryModule(stream, irModule, outError, loadOptions)) { return false; }
 
 	// Get a pointer to the global object cache, if there is one.
 	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
 
-	std::vector<U8> objectCode;
-	if(!objectCache)
+	ObjectCodeView objectCode;
+	if(!objectCache || compileOptions.tier == LLVMJIT::CompileTier::baseline)
 	{
-		// If there's no global object cache, just compile the module.
-		objectCode = LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
+		// If there's no global object cache, just compile the module. Baseline-tier object code
+		// isn't cached, since the cache should hold the optimized-tier object code.
+		objectCode
+			= LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec(), compileOptions);
 	}
 	else
 	{
-		// Check for cached object code for the module before compiling it.
-		objectCode = objectCache->getCachedObject(wasmBytes, numWASMBytes, [&irModule]() {
-			return LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
-		});
+		// Look up each partition of the module in the cache, and compile the partitions that
+		// aren't cached.
+		objectCode = compileModuleWithObjectCache(irModule, compileOptions, *objectCache);
 	}
 
-	outModule = std::make_shared<Runtime::Module>(std::move(irModule), std::move(objectCode));
+	outModule = std::make_shared<Runtime::Module>(
+		std::move(irModule), std::move(objectCode), compileOptions);
 	return true;
 }
 
@@ -136,7 +154,11 @@ ModuleRef Runtime::loadPrecompiledModule(const IR::Module& irModule,
 }
 
 const IR::Module& Runtime::getModuleIR(ModuleConstRefParam module) { return module->ir; }
-std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module) { return module->objectCode; }
+std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module)
+{
+	return std::vector<U8>(module->objectCode.bytes,
+						   module->objectCode.bytes + module->objectCode.numBytes);
+}
 
 ModuleInstance::~ModuleInstance()
 {
@@ -145,6 +167,9 @@ ModuleInstance::~ModuleInstance()
 		WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
 		compartment->moduleInstances.removeOrFail(id);
 	}
+
+	// Free the allocated quota.
+	if(isChargedToResourceQuota) { resourceQuota->moduleInstances.free(1); }
 }
 
 ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
@@ -228,6 +253,14 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 	DisassemblyNames disassemblyNames;
 	getDisassemblyNames(module->ir, disassemblyNames);
 
+	// Charge the module instance to the resource quota before creating its tables and memories.
+	if(resourceQuota && !resourceQuota->moduleInstances.allocate(1))
+	{
+		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		compartment->moduleInstances.removeOrFail(id);
+		throwException(ExceptionTypes::outOfMemory);
+	}
+
 	// Instantiate the module's memory and table definitions.
 	for(Uptr tableDefIndex = 0; tableDefIndex < module->ir.tables.defs.size(); ++tableDefIndex)
 	{
@@ -240,6 +273,7 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 								 resourceQuota);
 		if(!table)
 		{
+			if(resourceQuota) { resourceQuota->moduleInstances.free(1); }
 			Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 			compartment->moduleInstances.removeOrFail(id);
 			throwException(ExceptionTypes::outOfMemory);
@@ -256,6 +290,7 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 								   resourceQuota);
 		if(!memory)
 		{
+			if(resourceQuota) { resourceQuota->moduleInstances.free(1); }
 			Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 			compartment->moduleInstances.removeOrFail(id);
 			throwException(ExceptionTypes::outOfMemory);
@@ -345,7 +380,14 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 		{ debugName = "<function #" + std::to_string(functionDefIndex) + ">"; }
 		debugName = "wasm!" + moduleDebugName + '!' + debugName;
 
-		functionDefMutableDatas.push_back(new FunctionMutableData(std::move(debugName)));
+		FunctionMutableData* functionMutableData = new FunctionMutableData(std::move(debugName));
+		if(module->tier == LLVMJIT::CompileTier::baseline)
+		{
+			functionMutableData->tierUpState.hotnessThreshold
+				= std::max(module->tierUpHotnessThreshold, U64(1));
+			functionMutableData->tierUpState.functionDefIndex = functionDefIndex;
+		}
+		functionDefMutableDatas.push_back(functionMutableData);
 	}
 
 	// Load the compiled module's object code with this module instance's imports.
@@ -353,7 +395,8 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 	std::vector<Runtime::Function*> jitFunctionDefs;
 	jitFunctionDefs.resize(module->ir.functions.defs.size(), nullptr);
 	std::shared_ptr<LLVMJIT::Module> jitModule
-		= LLVMJIT::loadModule(module->objectCode,
+		= LLVMJIT::loadModule(module->objectCode.bytes,
+							  module->objectCode.numBytes,
 							  std::move(wavmIntrinsicsExportMap),
 							  std::move(jitTypes),
 							  std::move(jitFunctionImports),
@@ -363,7 +406,30 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 							  std::move(jitExceptionTypes),
 							  {id},
 							  reinterpret_cast<Uptr>(getOutOfBoundsElement()),
-							  functionDefMutableDatas);
+							  reinterpret_cast<Uptr>(getUninitializedElement()),
+							  reinterpret_cast<Uptr>(&currentEpoch),
+							  functionDefMutableDatas,
+							  module->objectCodeInfo.get());
+
+	// Charge the memory committed for the loaded code to the resource quota. If it exceeds the
+	// quota, the loaded code is unloaded when jitModule goes out of scope.
+	std::shared_ptr<JITCodeCharge> jitCodeCharge;
+	if(resourceQuota)
+	{
+		jitCodeCharge = std::make_shared<JITCodeCharge>(resourceQuota);
+		if(!jitCodeCharge->allocate(LLVMJIT::getNumLoadedBytes(jitModule.get())))
+		{
+			resourceQuota->moduleInstances.free(1);
+			Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+			compartment->moduleInstances.removeOrFail(id);
+			throwException(ExceptionTypes::outOfMemory);
+		}
+	}
+
+	// If the module was compiled at the baseline tier, register the loaded code so its hot
+	// functions will be recompiled at the optimized tier.
+	if(module->tier == LLVMJIT::CompileTier::baseline)
+	{ registerBaselineTierCode(module, jitModule, functionDefMutableDatas, jitCodeCharge); }
 
 	// LLVMJIT::loadModule filled in the functionDefMutableDatas' function pointers with the
 	// compiled functions. Add those functions to the module.
@@ -426,6 +492,11 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 														std::move(jitModule),
 														std::move(moduleDebugName),
 														resourceQuota);
+	if(resourceQuota)
+	{
+		moduleInstance->isChargedToResourceQuota = true;
+		moduleInstance->jitCodeCharge = std::move(jitCodeCharge);
+	}
 	{
 		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 		compartment->moduleInstances[id] = moduleInstance;
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <algorithm>
 #include <atomic>
 #include <utility>
 #include <vector>
@@ -10,6 +11,8 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Platform/WorkerPool.h"
 #include "WAVM/Runtime/Runtime.h"
 
 using namespace WAVM;
@@ -65,6 +68,116 @@ void Runtime::removeGCRoot(const Object* object)
 	}
 }
 
+// The elements of tables written since the previous garbage collection are scanned in chunks of
+// this many elements. If there are enough chunks, they are scanned by multiple threads.
+static constexpr Uptr tableScanChunkNumElements = 64 * 1024;
+static constexpr Uptr minParallelTableScanChunks = 4;
+
+static std::atomic<U64> numCollections{0};
+static std::atomic<U64> totalPauseNanoseconds{0};
+static std::atomic<U64> maxPauseNanoseconds{0};
+static std::atomic<U64> numScannedTables{0};
+static std::atomic<U64> numReusedTables{0};
+static std::atomic<U64> numScannedTableElements{0};
+
+struct TableScanChunk
+{
+	Table* table;
+	Uptr beginElementIndex;
+	Uptr endElementIndex;
+	std::vector<Object*> references;
+};
+
+// Gathers the distinct objects referenced by a chunk of a table's elements. A reference to a
+// function is gathered as a reference to its module instance.
+static void scanTableChunk(Compartment* compartment, TableScanChunk& chunk)
+{
+	Platform::RWMutex::ShareableLock resizingLock(chunk.table->resizingMutex);
+
+	HashSet<Object*> references;
+	Object* previousReference = nullptr;
+	for(Uptr elementIndex = chunk.beginElementIndex; elementIndex < chunk.endElementIndex;
+		++elementIndex)
+	{
+		Object* reference = getTableElementForGC(chunk.table, elementIndex);
+		if(reference->kind == ObjectKind::function)
+		{
+			// Functions without a module instance include the sentinel values for uninitialized
+			// and out-of-bounds elements.
+			Function* function = asFunction(reference);
+			if(function->moduleInstanceId == UINTPTR_MAX) { continue; }
+			WAVM_ASSERT(compartment->moduleInstances.contains(function->moduleInstanceId));
+			reference = compartment->moduleInstances[function->moduleInstanceId];
+			if(!reference) { continue; }
+		}
+
+		// Adjacent elements often reference the same object, so check for that before looking up
+		// the reference in the hash set.
+		if(reference != previousReference && references.add(reference))
+		{ chunk.references.push_back(reference); }
+		previousReference = reference;
+	}
+}
+
+// Updates the gcReferences of the compartment's tables that were written since they were last
+// scanned.
+static void scanStaleTables(Compartment* compartment)
+{
+	std::vector<TableScanChunk> chunks;
+
+	Uptr numStaleTables = 0;
+	Uptr numStaleTableElements = 0;
+	for(Table* table : compartment->tables)
+	{
+		// Clear the stale flag before reading the elements, so an element written during the scan
+		// will mark the table as stale again.
+		if(!table->runtimeData->gcReferencesAreStale.exchange(0, std::memory_order_seq_cst))
+		{ continue; }
+
+		++numStaleTables;
+		table->gcReferences.clear();
+
+		const Uptr numElements = getTableNumElements(table);
+		for(Uptr beginElementIndex = 0; beginElementIndex < numElements;
+			beginElementIndex += tableScanChunkNumElements)
+		{
+			const Uptr endElementIndex
+				= std::min(numElements, beginElementIndex + tableScanChunkNumElements);
+			chunks.push_back({table, beginElementIndex, endElementIndex, {}});
+		}
+		numStaleTableElements += numElements;
+	}
+
+	// Scan the chunks, using the worker pool if there are enough of them.
+	const Uptr maxParallelism = chunks.size() < minParallelTableScanChunks
+									? 1
+									: Platform::getNumberOfHardwareThreads();
+	Platform::runParallelJobs(chunks.size(), maxParallelism, [&](Uptr chunkIndex) {
+		scanTableChunk(compartment, chunks[chunkIndex]);
+	});
+
+	// Combine the references gathered from each table's chunks. A table's chunks are contiguous
+	// in the chunks array.
+	Table* table = nullptr;
+	HashSet<Object*> tableReferences;
+	for(TableScanChunk& chunk : chunks)
+	{
+		if(chunk.table != table)
+		{
+			table = chunk.table;
+			tableReferences.clear();
+		}
+		for(Object* reference : chunk.references)
+		{
+			if(tableReferences.add(reference)) { table->gcReferences.push_back(reference); }
+		}
+	}
+
+	numScannedTables += numStaleTables;
+	numReusedTables += compartment->tables.size() - numStaleTables;
+	numScannedTableElements += numStaleTableElements;
+}
+
 struct GCState
 {
 	Compartment* compartment;
@@ -118,12 +231,9 @@ struct GCState
 		switch(object->kind)
 		{
 		case ObjectKind::table: {
+			// scanStaleTables has updated the table's gcReferences to match its elements.
 			Table* table = asTable(object);
-
-			Platform::RWMutex::ShareableLock resizingLock(table->resizingMutex);
-			const Uptr numElements = getTableNumElements(table);
-			for(Uptr elementIndex = 0; elementIndex < numElements; ++elementIndex)
-			{ visitReference(getTableElement(table, elementIndex)); }
+			visitReferenceArray(table->gcReferences);
 			break;
 		}
 		case ObjectKind::global: {
@@ -177,6 +287,9 @@ static bool collectGarbageImpl(Compartment* compartment)
 	Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 	Timing::Timer timer;
 
+	// Rescan the elements of the tables that were written since the previous collection.
+	scanStaleTables(compartment);
+
 	GCState state(compartment);
 
 	// Initialize the GC state from the compartment's various sets of objects.
@@ -231,8 +344,19 @@ static bool collectGarbageImpl(Compartment* compartment)
 
 	// Delete the compartment last, if it wasn't referenced.
 	compartmentLock.unlock();
+	const U64 pauseNanoseconds = U64(timer.getNanoseconds());
 	if(wasCompartmentUnreferenced) { delete compartment; }
 
+	// Update the GC metrics.
+	++numCollections;
+	totalPauseNanoseconds += pauseNanoseconds;
+	U64 oldMaxPauseNanoseconds = maxPauseNanoseconds.load(std::memory_order_relaxed);
+	while(oldMaxPauseNanoseconds < pauseNanoseconds)
+	{
+		if(maxPauseNanoseconds.compare_exchange_weak(oldMaxPauseNanoseconds, pauseNanoseconds))
+		{ break; }
+	};
+
 	Log::printf(Log::metrics,
 				"Collected garbage in %.2fms: %" WAVM_PRIuPTR " roots, %" WAVM_PRIuPTR
 				" objects, %" WAVM_PRIuPTR " garbage\n",
@@ -255,3 +379,15 @@ bool Runtime::tryCollectCompartment(GCPointer<Compartment>&& compartmentRootRef)
 	compartmentRootRef = nullptr;
 	return collectGarbageImpl(compartment);
 }
+
+GCMetrics Runtime::getGCMetrics()
+{
+	GCMetrics metrics;
+	metrics.numCollections = numCollections.load(std::memory_order_relaxed);
+	metrics.totalPauseNanoseconds = totalPauseNanoseconds.load(std::memory_order_relaxed);
+	metrics.maxPauseNanoseconds = maxPauseNanoseconds.load(std::memory_order_relaxed);
+	metrics.numScannedTables = numScannedTables.load(std::memory_order_relaxed);
+	metrics.numReusedTables = numReusedTables.load(std::memory_order_relaxed);
+	metrics.numScannedTableElements = numScannedTableElements.load(std::memory_order_relaxed);
+	return metrics;
+}
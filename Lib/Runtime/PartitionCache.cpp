@@ -0,0 +1,253 @@
+#include <string.h>
+#include <memory>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/WorkerPool.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Partitions end after a function definition whose code hash is a multiple of
+// partitionEndHashModulus, so the boundaries only depend on the function definitions around them.
+// The size limits keep partitions from being too small to be worth loading separately, or too
+// large to recompile quickly.
+static constexpr Uptr minPartitionNumCodeBytes = 64 * 1024;
+static constexpr Uptr maxPartitionNumCodeBytes = 1024 * 1024;
+static constexpr U64 partitionEndHashModulus = 64;
+
+// Identifies the version of the partition cache key format.
+static constexpr U8 partitionCacheKeyMagic[8] = {'W', 'A', 'V', 'M', 'P', 'R', 'T', '1'};
+
+//
+// Functions that add the parts of a module that affect code generation to a cache key hash.
+//
+
+static void appendU64(StreamingHash128& key, U64 value) { key.add(&value, sizeof(U64)); }
+
+static void appendTypeTuple(StreamingHash128& key, TypeTuple typeTuple)
+{
+	appendU64(key, typeTuple.size());
+	for(ValueType elementType : typeTuple) { appendU64(key, U64(elementType)); }
+}
+
+static void appendFunctionType(StreamingHash128& key, FunctionType functionType)
+{
+	appendU64(key, U64(functionType.callingConvention()));
+	appendTypeTuple(key, functionType.params());
+	appendTypeTuple(key, functionType.results());
+}
+
+static void appendSize(StreamingHash128& key, const SizeConstraints& size)
+{
+	appendU64(key, size.min);
+	appendU64(key, size.max);
+}
+
+static void appendTableType(StreamingHash128& key, const TableType& tableType)
+{
+	appendU64(key, U64(tableType.elementType));
+	appendU64(key, tableType.isShared);
+	appendSize(key, tableType.size);
+}
+
+static void appendMemoryType(StreamingHash128& key, const MemoryType& memoryType)
+{
+	appendU64(key, memoryType.isShared);
+	appendSize(key, memoryType.size);
+}
+
+static void appendGlobalType(StreamingHash128& key, const GlobalType& globalType)
+{
+	appendU64(key, U64(globalType.valueType));
+	appendU64(key, globalType.isMutable);
+}
+
+bool Runtime::isCachedPartitionEnd(const FunctionDef& functionDef, Uptr numPartitionCodeBytes)
+{
+	if(numPartitionCodeBytes < minPartitionNumCodeBytes) { return false; }
+	if(numPartitionCodeBytes >= maxPartitionNumCodeBytes) { return true; }
+	return XXH64(functionDef.code.data(), functionDef.code.size(), 0) % partitionEndHashModulus
+		   == 0;
+}
+
+StreamingHash128 Runtime::getPartitionCacheLayoutKey(const IR::Module& irModule)
+{
+	StreamingHash128 key;
+	key.add(partitionCacheKeyMagic, sizeof(partitionCacheKeyMagic));
+
+	// The module's types, and the types of its functions, tables, memories, globals, and
+	// exception types determine the symbols that a partition's code references, and how it uses
+	// them. The names of imports and exports, initializer expressions, and segment contents don't
+	// affect the code, so they aren't included.
+	appendU64(key, irModule.types.size());
+	for(FunctionType type : irModule.types) { appendFunctionType(key, type); }
+
+	appendU64(key, irModule.functions.imports.size());
+	for(const auto& import : irModule.functions.imports) { appendU64(key, import.type.index); }
+	appendU64(key, irModule.functions.defs.size());
+	for(const FunctionDef& def : irModule.functions.defs) { appendU64(key, def.type.index); }
+
+	appendU64(key, irModule.tables.imports.size());
+	for(const auto& import : irModule.tables.imports) { appendTableType(key, import.type); }
+	appendU64(key, irModule.tables.defs.size());
+	for(const TableDef& def : irModule.tables.defs) { appendTableType(key, def.type); }
+
+	appendU64(key, irModule.memories.imports.size());
+	for(const auto& import : irModule.memories.imports) { appendMemoryType(key, import.type); }
+	appendU64(key, irModule.memories.defs.size());
+	for(const MemoryDef& def : irModule.memories.defs) { appendMemoryType(key, def.type); }
+
+	appendU64(key, irModule.globals.imports.size());
+	for(const auto& import : irModule.globals.imports) { appendGlobalType(key, import.type); }
+	appendU64(key, irModule.globals.defs.size());
+	for(const GlobalDef& def : irModule.globals.defs) { appendGlobalType(key, def.type); }
+
+	appendU64(key, irModule.exceptionTypes.imports.size());
+	for(const auto& import : irModule.exceptionTypes.imports)
+	{ appendTypeTuple(key, import.type.params); }
+	appendU64(key, irModule.exceptionTypes.defs.size());
+	for(const ExceptionTypeDef& def : irModule.exceptionTypes.defs)
+	{ appendTypeTuple(key, def.type.params); }
+
+	appendU64(key, irModule.elemSegments.size());
+	for(const ElemSegment& elemSegment : irModule.elemSegments)
+	{ appendU64(key, U64(elemSegment.type)); }
+
+	return key;
+}
+
+ObjectCodeView Runtime::getCachedModulePartition(ObjectCacheInterface& objectCache,
+												 const IR::Module& irModule,
+												 const StreamingHash128& layoutKey,
+												 Uptr beginFunctionDefIndex,
+												 Uptr endFunctionDefIndex,
+												 LLVMJIT::CompileTier tier,
+												 bool meterFuel,
+												 bool checkEpochDeadlines)
+{
+	// The partition's key is the module layout, followed by the partition's function definitions.
+	// The function definition indices are included because the partition's symbols are named by
+	// them. The function definitions are hashed directly from the IR, without serializing them.
+	StreamingHash128 key = layoutKey;
+	appendU64(key, U64(tier));
+	appendU64(key, meterFuel);
+	appendU64(key, checkEpochDeadlines);
+	appendU64(key, beginFunctionDefIndex);
+	appendU64(key, endFunctionDefIndex);
+	for(Uptr functionDefIndex = beginFunctionDefIndex; functionDefIndex < endFunctionDefIndex;
+		++functionDefIndex)
+	{
+		const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
+		appendU64(key, functionDef.nonParameterLocalTypes.size());
+		for(ValueType localType : functionDef.nonParameterLocalTypes)
+		{ appendU64(key, U64(localType)); }
+		appendU64(key, functionDef.branchTables.size());
+		for(const std::vector<Uptr>& branchTable : functionDef.branchTables)
+		{
+			appendU64(key, branchTable.size());
+			for(Uptr targetDepth : branchTable) { appendU64(key, targetDepth); }
+		}
+		appendU64(key, functionDef.code.size());
+		key.add(functionDef.code.data(), functionDef.code.size());
+	}
+
+	return objectCache.getCachedObject(
+		key.getHash(),
+		[&irModule,
+		 beginFunctionDefIndex,
+		 endFunctionDefIndex,
+		 tier,
+		 meterFuel,
+		 checkEpochDeadlines]() {
+			return LLVMJIT::compileModulePartition(irModule,
+												   LLVMJIT::getHostTargetSpec(),
+												   beginFunctionDefIndex,
+												   endFunctionDefIndex,
+												   tier,
+												   meterFuel,
+												   checkEpochDeadlines);
+		});
+}
+
+ObjectCodeView Runtime::linkModulePartitions(const std::vector<ObjectCodeView>& partitions)
+{
+	// A single partition's object code can be used without copying it.
+	WAVM_ASSERT(partitions.size());
+	if(partitions.size() == 1) { return partitions[0]; }
+
+	std::vector<LLVMJIT::ObjectFileBytes> objectFiles;
+	for(const ObjectCodeView& partition : partitions)
+	{ objectFiles.push_back({partition.bytes, partition.numBytes}); }
+	return ObjectCodeView(LLVMJIT::linkModulePartitions(objectFiles));
+}
+
+struct CachedPartition
+{
+	Uptr beginFunctionDefIndex;
+	Uptr endFunctionDefIndex;
+	ObjectCodeView objectCode;
+};
+
+ObjectCodeView Runtime::compileModuleWithObjectCache(const IR::Module& irModule,
+													 const LLVMJIT::CompileOptions& compileOptions,
+													 ObjectCacheInterface& objectCache)
+{
+	Timing::Timer compileTimer;
+
+	const StreamingHash128 layoutKey = getPartitionCacheLayoutKey(irModule);
+	std::vector<CachedPartition> partitions;
+
+	// Split the function definitions into partitions at content-defined boundaries. A module
+	// without function definitions still needs to be compiled once.
+	Uptr beginFunctionDefIndex = 0;
+	Uptr numPartitionCodeBytes = 0;
+	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
+		++functionDefIndex)
+	{
+		const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
+		numPartitionCodeBytes += functionDef.code.size() + 1;
+		if(isCachedPartitionEnd(functionDef, numPartitionCodeBytes))
+		{
+			partitions.push_back({beginFunctionDefIndex, functionDefIndex + 1, {}});
+			beginFunctionDefIndex = functionDefIndex + 1;
+			numPartitionCodeBytes = 0;
+		}
+	}
+	if(beginFunctionDefIndex < irModule.functions.defs.size() || !partitions.size())
+	{ partitions.push_back({beginFunctionDefIndex, irModule.functions.defs.size(), {}}); }
+
+	// Look up or compile the partitions on up to the number of threads the compile options allow.
+	Platform::runParallelJobs(
+		partitions.size(), compileOptions.numThreads, [&](Uptr partitionIndex) {
+			CachedPartition& partition = partitions[partitionIndex];
+			partition.objectCode = getCachedModulePartition(objectCache,
+															irModule,
+															layoutKey,
+															partition.beginFunctionDefIndex,
+															partition.endFunctionDefIndex,
+															compileOptions.tier,
+															compileOptions.meterFuel,
+															compileOptions.checkEpochDeadlines);
+		});
+
+	std::vector<ObjectCodeView> partitionObjectCodes;
+	for(CachedPartition& partition : partitions)
+	{ partitionObjectCodes.push_back(std::move(partition.objectCode)); }
+	ObjectCodeView objectCode = linkModulePartitions(partitionObjectCodes);
+
+	Timing::logRatePerSecond("Compiled module partitions with object cache",
+							 compileTimer,
+							 (F64)partitions.size(),
+							 "partitions");
+
+	return objectCode;
+}
@@ -0,0 +1,346 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/HashSet.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Signal.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+// Samples are written to a fixed set of slots by the signal handler, which can't allocate memory
+// or take locks. A background thread periodically moves the samples out of the slots and into the
+// profile. If all the slots are full when a sample is taken, the sample is dropped.
+static constexpr Uptr numSampleSlots = 1024;
+static constexpr I128 aggregationIntervalNS = 20 * 1000 * 1000;
+
+enum class SampleSlotState : U32
+{
+	empty,
+	writing,
+	full,
+};
+
+struct SampleSlot
+{
+	std::atomic<SampleSlotState> state{SampleSlotState::empty};
+
+	Uptr numFrames;
+	Uptr frameIPs[Platform::CallStack::maxFrames];
+
+	// The LLVMJIT::getModuleLoadNumberByAddress of each frame when the sample was taken, or 0 for
+	// frames that weren't in a JIT module.
+	U64 frameModuleLoadNumbers[Platform::CallStack::maxFrames];
+};
+
+static SampleSlot sampleSlots[numSampleSlots];
+static std::atomic<Uptr> nextSampleSlotIndex{0};
+static std::atomic<Uptr> numDroppedSamples{0};
+
+struct FunctionSamples
+{
+	U64 numSelfSamples = 0;
+	U64 numTotalSamples = 0;
+	HashMap<Uptr, U64> opIndexSamples;
+};
+
+struct Profiler
+{
+	// Serializes startProfiling and stopProfiling, and protects isRunning and aggregationThread.
+	Platform::Mutex startStopMutex;
+	bool isRunning = false;
+	std::atomic<bool> isStopping{false};
+	Platform::Thread* aggregationThread = nullptr;
+
+	// Signaled by stopProfiling to wake the aggregation thread before its interval is up.
+	Platform::Event wakeEvent;
+
+	// The profile; protected by mutex.
+	Platform::Mutex mutex;
+	U64 numSamples = 0;
+	HashMap<std::string, U64> collapsedStackSamples;
+	HashMap<std::string, FunctionSamples> functionSamples;
+
+	// The number of frames that were dropped because their JIT module was unloaded between when
+	// they were sampled and when they were added to the profile; protected by mutex.
+	U64 numUnloadedModuleFrames = 0;
+
+	// The names of the native functions in the profile, by function address. They are slow to look
+	// up, but don't change. Protected by mutex.
+	HashMap<Uptr, std::string> nativeFunctionNames;
+
+	static Profiler& get()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+};
+
+static void recordSample(const Platform::CallStack& callStack)
+{
+	// Claim the next slot, or drop the sample if the slot hasn't been emptied since it was last
+	// written.
+	SampleSlot& slot = sampleSlots[nextSampleSlotIndex++ % numSampleSlots];
+	SampleSlotState expectedState = SampleSlotState::empty;
+	if(!slot.state.compare_exchange_strong(expectedState, SampleSlotState::writing))
+	{
+		++numDroppedSamples;
+		return;
+	}
+
+	slot.numFrames = callStack.frames.size();
+	for(Uptr frameIndex = 0; frameIndex < slot.numFrames; ++frameIndex)
+	{
+		const Uptr ip = callStack.frames[frameIndex].ip;
+		slot.frameIPs[frameIndex] = ip;
+		slot.frameModuleLoadNumbers[frameIndex] = LLVMJIT::getModuleLoadNumberByAddress(ip);
+	}
+	slot.state.store(SampleSlotState::full, std::memory_order_release);
+}
+
+static const std::string& getNativeFrameName(Profiler& profiler, Uptr ip)
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(profiler.mutex);
+
+	// Name the frames by the function that contains them, leaving out the instruction offset, so
+	// all samples in a native function have the same name. Frames that aren't in any known
+	// function are named by function address 0.
+	Uptr functionAddress = 0;
+	if(!Platform::getFunctionAddressByInstructionAddress(ip, functionAddress))
+	{ functionAddress = 0; }
+	if(const std::string* cachedName = profiler.nativeFunctionNames.get(functionAddress))
+	{ return *cachedName; }
+
+	std::string name = "host!";
+	Platform::InstructionSource source;
+	if(functionAddress && Platform::getInstructionSourceByAddress(ip, source))
+	{
+		name += source.module;
+		if(source.function.size())
+		{
+			name += '!';
+			name += source.function;
+		}
+	}
+	else
+	{
+		name += "<unknown>";
+	}
+	return profiler.nativeFunctionNames.getOrAdd(functionAddress, std::move(name));
+}
+
+// Adds a sample to the profile. The caller must hold a ModuleUnloadGuard, so the JIT modules that
+// contain the sample's frames can't be unloaded while they are used.
+static void addSampleToProfile(Profiler& profiler, const SampleSlot& slot)
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(profiler.mutex);
+
+	// Build the collapsed stack from the outermost frame in, and find the innermost WebAssembly
+	// frame.
+	std::string collapsedStack;
+	HashSet<std::string> sampledFunctionNames;
+	std::string innermostFunctionName;
+	Uptr innermostOpIndex = 0;
+	for(Uptr frameIndex = slot.numFrames; frameIndex > 0; --frameIndex)
+	{
+		const Uptr ip = slot.frameIPs[frameIndex - 1];
+		const U64 moduleLoadNumber = slot.frameModuleLoadNumbers[frameIndex - 1];
+
+		// Drop frames in JIT modules that were unloaded since the sample was taken, since their
+		// addresses may now be unused, or in another module.
+		if(moduleLoadNumber && LLVMJIT::getModuleLoadNumberByAddress(ip) != moduleLoadNumber)
+		{
+			++profiler.numUnloadedModuleFrames;
+			continue;
+		}
+
+		if(collapsedStack.size()) { collapsedStack += ';'; }
+
+		LLVMJIT::InstructionSource jitSource;
+		if(moduleLoadNumber && LLVMJIT::getInstructionSourceByAddress(ip, jitSource))
+		{
+			innermostFunctionName = jitSource.function->mutableData->debugName;
+			innermostOpIndex = jitSource.instructionIndex;
+			sampledFunctionNames.add(innermostFunctionName);
+			collapsedStack += innermostFunctionName;
+		}
+		else
+		{
+			collapsedStack += getNativeFrameName(profiler, ip);
+		}
+	}
+
+	if(!sampledFunctionNames.size()) { return; }
+
+	++profiler.numSamples;
+	++profiler.collapsedStackSamples.getOrAdd(collapsedStack, 0);
+	for(const std::string& functionName : sampledFunctionNames)
+	{ ++profiler.functionSamples.getOrAdd(functionName).numTotalSamples; }
+
+	FunctionSamples& innermostFunctionSamples
+		= profiler.functionSamples.getOrAdd(innermostFunctionName);
+	++innermostFunctionSamples.numSelfSamples;
+	++innermostFunctionSamples.opIndexSamples.getOrAdd(innermostOpIndex, 0);
+}
+
+static void aggregateSamples(Profiler& profiler)
+{
+	// Keep the JIT modules that are loaded now from being unloaded while the samples' addresses
+	// are looked up.
+	LLVMJIT::ModuleUnloadGuard moduleUnloadGuard;
+
+	Platform::Mutex::Lock profilerLock(profiler.mutex);
+	for(SampleSlot& slot : sampleSlots)
+	{
+		if(slot.state.load(std::memory_order_acquire) == SampleSlotState::full)
+		{
+			addSampleToProfile(profiler, slot);
+			slot.state.store(SampleSlotState::empty, std::memory_order_release);
+		}
+	}
+}
+
+static I64 aggregationThreadEntry(void*)
+{
+	Profiler& profiler = Profiler::get();
+	while(!profiler.isStopping.load())
+	{
+		profiler.wakeEvent.wait(Time{aggregationIntervalNS});
+		aggregateSamples(profiler);
+	}
+	return 0;
+}
+
+bool Runtime::startProfiling(Uptr samplesPerSecond)
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock startStopLock(profiler.startStopMutex);
+	if(profiler.isRunning) { return false; }
+
+	if(!Platform::startSampling(samplesPerSecond, recordSample)) { return false; }
+
+	profiler.isRunning = true;
+	profiler.isStopping.store(false);
+	profiler.aggregationThread
+		= Platform::createThread(1024 * 1024, aggregationThreadEntry, nullptr);
+	return true;
+}
+
+void Runtime::stopProfiling()
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock startStopLock(profiler.startStopMutex);
+	if(!profiler.isRunning) { return; }
+	profiler.isRunning = false;
+
+	// Stop sampling before stopping the aggregation thread, so no samples are written after the
+	// final aggregation.
+	Platform::stopSampling();
+
+	profiler.isStopping.store(true);
+	profiler.wakeEvent.signal();
+	Platform::joinThread(profiler.aggregationThread);
+	profiler.aggregationThread = nullptr;
+
+	aggregateSamples(profiler);
+
+	const Uptr numDropped = numDroppedSamples.exchange(0);
+	if(numDropped)
+	{
+		Log::printf(Log::metrics,
+					"Profiler dropped %" WAVM_PRIuPTR " samples that arrived faster than they were"
+					" aggregated\n",
+					numDropped);
+	}
+
+	U64 numUnloadedModuleFrames;
+	{
+		Platform::Mutex::Lock profilerLock(profiler.mutex);
+		numUnloadedModuleFrames = profiler.numUnloadedModuleFrames;
+		profiler.numUnloadedModuleFrames = 0;
+	}
+	if(numUnloadedModuleFrames)
+	{
+		Log::printf(Log::metrics,
+					"Profiler dropped %" PRIu64 " frames in JIT modules that were unloaded before"
+					" the frames were aggregated\n",
+					numUnloadedModuleFrames);
+	}
+}
+
+void Runtime::resetProfile()
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock profilerLock(profiler.mutex);
+	profiler.numSamples = 0;
+	profiler.collapsedStackSamples.clear();
+	profiler.functionSamples.clear();
+	profiler.nativeFunctionNames.clear();
+}
+
+U64 Runtime::getProfileNumSamples()
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock profilerLock(profiler.mutex);
+	return profiler.numSamples;
+}
+
+std::string Runtime::getProfileCollapsedStacks()
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock profilerLock(profiler.mutex);
+
+	std::string result;
+	for(const auto& pair : profiler.collapsedStackSamples)
+	{
+		result += pair.key;
+		result += ' ';
+		result += std::to_string(pair.value);
+		result += '\n';
+	}
+	return result;
+}
+
+std::vector<ProfiledFunction> Runtime::getProfiledFunctions()
+{
+	Profiler& profiler = Profiler::get();
+	Platform::Mutex::Lock profilerLock(profiler.mutex);
+
+	std::vector<ProfiledFunction> result;
+	for(const auto& functionPair : profiler.functionSamples)
+	{
+		ProfiledFunction profiledFunction;
+		profiledFunction.debugName = functionPair.key;
+		profiledFunction.numSelfSamples = functionPair.value.numSelfSamples;
+		profiledFunction.numTotalSamples = functionPair.value.numTotalSamples;
+		for(const auto& opIndexPair : functionPair.value.opIndexSamples)
+		{ profiledFunction.opIndexSamples.push_back({opIndexPair.key, opIndexPair.value}); }
+		std::sort(profiledFunction.opIndexSamples.begin(),
+				  profiledFunction.opIndexSamples.end(),
+				  [](const std::pair<Uptr, U64>& a, const std::pair<Uptr, U64>& b) {
+					  return a.second > b.second;
+				  });
+		result.push_back(std::move(profiledFunction));
+	}
+	std::sort(result.begin(),
+			  result.end(),
+			  [](const ProfiledFunction& a, const ProfiledFunction& b) {
+				  return a.numSelfSamples > b.numSelfSamples;
+			  });
+	return result;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+
+namespace WAVM { namespace Runtime {
+	// Maps addresses to the owners of large reserved regions of the address space, such as the
+	// regions reserved by memories and tables. It is a radix tree over the high bits of the
+	// address, so finding the owner of an address is constant time and lock-free, and may be done
+	// in a signal handler. Regions may be added and removed concurrently with each other and with
+	// lookups.
+	//
+	// The address space is divided into granules that are no larger than the smallest region, so at
+	// most two regions intersect a granule: one that contains the start of the granule, and one
+	// that starts within the granule.
+	template<typename Owner> struct ReservedRegionIndex
+	{
+		static constexpr Uptr granuleBytesLog2 = sizeof(Uptr) == 8 ? 32 : 24;
+		static constexpr Uptr granuleBytes = Uptr(1) << granuleBytesLog2;
+
+		// Adds a region owned by owner. The region must not overlap any region already in the
+		// index, and must be at least granuleBytes long.
+		void add(U8* begin, Uptr numBytes, Owner* owner)
+		{
+			WAVM_ERROR_UNLESS(numBytes >= granuleBytes);
+			const Uptr beginAddress = reinterpret_cast<Uptr>(begin);
+			const Uptr endAddress = beginAddress + numBytes;
+			WAVM_ERROR_UNLESS(endAddress > beginAddress);
+
+			for(Uptr granuleIndex = beginAddress >> granuleBytesLog2;
+				granuleIndex <= (endAddress - 1) >> granuleBytesLog2;
+				++granuleIndex)
+			{
+				Slot& slot = getSlot(granuleIndex, beginAddress);
+				WAVM_ASSERT(!slot.owner.load(std::memory_order_relaxed));
+
+				// Write the bounds of the region before publishing its owner.
+				slot.begin.store(beginAddress, std::memory_order_release);
+				slot.end.store(endAddress, std::memory_order_release);
+				slot.owner.store(owner, std::memory_order_release);
+			}
+		}
+
+		// Removes a region that was added with the same arguments.
+		void remove(U8* begin, Uptr numBytes, Owner* owner)
+		{
+			const Uptr beginAddress = reinterpret_cast<Uptr>(begin);
+			const Uptr endAddress = beginAddress + numBytes;
+			for(Uptr granuleIndex = beginAddress >> granuleBytesLog2;
+				granuleIndex <= (endAddress - 1) >> granuleBytesLog2;
+				++granuleIndex)
+			{
+				Slot& slot = getSlot(granuleIndex, beginAddress);
+				WAVM_ASSERT(slot.owner.load(std::memory_order_relaxed) == owner);
+				slot.owner.store(nullptr, std::memory_order_release);
+			}
+		}
+
+		// Finds the region containing an address. If there is one, writes the region's owner to
+		// outOwner, and the offset of the address within the region to outOffset.
+		bool find(U8* address, Owner*& outOwner, Uptr& outOffset) const
+		{
+			const Uptr addressBits = reinterpret_cast<Uptr>(address);
+			const Uptr granuleIndex = addressBits >> granuleBytesLog2;
+
+			const Interior* interior
+				= root[granuleIndex >> (interiorBitsLog2 + leafBitsLog2)].load(
+					std::memory_order_acquire);
+			if(!interior) { return false; }
+			const Leaf* leaf = interior->leaves[(granuleIndex >> leafBitsLog2) & interiorIndexMask]
+								   .load(std::memory_order_acquire);
+			if(!leaf) { return false; }
+			const Granule& granule = leaf->granules[granuleIndex & leafIndexMask];
+
+			return findInSlot(granule.tail, addressBits, outOwner, outOffset)
+				   || findInSlot(granule.head, addressBits, outOwner, outOffset);
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<Owner*> owner{nullptr};
+			std::atomic<Uptr> begin{0};
+			std::atomic<Uptr> end{0};
+		};
+
+		struct Granule
+		{
+			// The region that contains the first address of the granule.
+			Slot head;
+
+			// The region that starts after the first address of the granule.
+			Slot tail;
+		};
+
+		static constexpr Uptr numIndexBits = sizeof(Uptr) * 8 - granuleBytesLog2;
+		static constexpr Uptr leafBitsLog2 = numIndexBits / 3;
+		static constexpr Uptr interiorBitsLog2 = numIndexBits / 3;
+		static constexpr Uptr rootBitsLog2 = numIndexBits - leafBitsLog2 - interiorBitsLog2;
+
+		static constexpr Uptr numRootEntries = Uptr(1) << rootBitsLog2;
+		static constexpr Uptr numInteriorEntries = Uptr(1) << interiorBitsLog2;
+		static constexpr Uptr numLeafEntries = Uptr(1) << leafBitsLog2;
+		static constexpr Uptr interiorIndexMask = numInteriorEntries - 1;
+		static constexpr Uptr leafIndexMask = numLeafEntries - 1;
+
+		struct Leaf
+		{
+			Granule granules[numLeafEntries];
+		};
+
+		struct Interior
+		{
+			std::atomic<Leaf*> leaves[numInteriorEntries];
+
+			Interior()
+			{
+				for(Uptr index = 0; index < numInteriorEntries; ++index)
+				{ leaves[index].store(nullptr, std::memory_order_relaxed); }
+			}
+		};
+
+		std::atomic<Interior*> root[numRootEntries] = {};
+
+		// Returns the value of an entry in the tree, creating it if it doesn't exist yet. Nodes are
+		// never freed, so a thread that loses the race to create one just deletes its copy.
+		template<typename Node> static Node* getOrCreate(std::atomic<Node*>& entry)
+		{
+			Node* node = entry.load(std::memory_order_acquire);
+			if(node) { return node; }
+
+			Node* newNode = new Node;
+			if(entry.compare_exchange_strong(
+				   node, newNode, std::memory_order_acq_rel, std::memory_order_acquire))
+			{ return newNode; }
+			delete newNode;
+			return node;
+		}
+
+		Slot& getSlot(Uptr granuleIndex, Uptr regionBeginAddress)
+		{
+			Interior* interior
+				= getOrCreate(root[granuleIndex >> (interiorBitsLog2 + leafBitsLog2)]);
+			Leaf* leaf
+				= getOrCreate(interior->leaves[(granuleIndex >> leafBitsLog2) & interiorIndexMask]);
+			Granule& granule = leaf->granules[granuleIndex & leafIndexMask];
+			return (regionBeginAddress >> granuleBytesLog2) == granuleIndex
+						   && (regionBeginAddress & (granuleBytes - 1))
+					   ? granule.tail
+					   : granule.head;
+		}
+
+		static bool findInSlot(const Slot& slot, Uptr address, Owner*& outOwner, Uptr& outOffset)
+		{
+			Owner* owner = slot.owner.load(std::memory_order_acquire);
+			if(!owner) { return false; }
+			const Uptr begin = slot.begin.load(std::memory_order_acquire);
+			const Uptr end = slot.end.load(std::memory_order_acquire);
+
+			// If the slot was reused for a different region while reading its bounds, the bounds
+			// may not belong to the owner that was read.
+			if(slot.owner.load(std::memory_order_acquire) != owner) { return false; }
+
+			if(address < begin || address >= end) { return false; }
+			outOwner = owner;
+			outOffset = address - begin;
+			return true;
+		}
+	};
+}}
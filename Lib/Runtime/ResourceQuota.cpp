@@ -38,3 +38,50 @@ void Runtime::setResourceQuotaMaxMemoryPages(ResourceQuotaRefParam resourceQuota
 {
 	resourceQuota->memoryPages.setMax(maxMemoryPages);
 }
+
+Uptr Runtime::getResourceQuotaMaxModuleInstances(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->moduleInstances.getMax();
+}
+
+Uptr Runtime::getResourceQuotaCurrentModuleInstances(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->moduleInstances.getCurrent();
+}
+
+void Runtime::setResourceQuotaMaxModuleInstances(ResourceQuotaRefParam resourceQuota,
+												 Uptr maxModuleInstances)
+{
+	resourceQuota->moduleInstances.setMax(maxModuleInstances);
+}
+
+Uptr Runtime::getResourceQuotaMaxContexts(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->contexts.getMax();
+}
+
+Uptr Runtime::getResourceQuotaCurrentContexts(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->contexts.getCurrent();
+}
+
+void Runtime::setResourceQuotaMaxContexts(ResourceQuotaRefParam resourceQuota, Uptr maxContexts)
+{
+	resourceQuota->contexts.setMax(maxContexts);
+}
+
+Uptr Runtime::getResourceQuotaMaxJITCodeBytes(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->jitCodeBytes.getMax();
+}
+
+Uptr Runtime::getResourceQuotaCurrentJITCodeBytes(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->jitCodeBytes.getCurrent();
+}
+
+void Runtime::setResourceQuotaMaxJITCodeBytes(ResourceQuotaRefParam resourceQuota,
+											  Uptr maxJITCodeBytes)
+{
+	resourceQuota->jitCodeBytes.setMax(maxJITCodeBytes);
+}
@@ -11,6 +11,7 @@
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -50,11 +51,18 @@ namespace WAVM { namespace Runtime {
 		Uptr numReservedBytes = 0;
 		Uptr numReservedElements = 0;
 
+		// Points to the TableRuntimeData stored immediately before elements.
+		TableRuntimeData* runtimeData = nullptr;
+
 		mutable Platform::RWMutex resizingMutex;
-		std::atomic<Uptr> numElements{0};
 
 		ResourceQuotaRef resourceQuota;
 
+		// The objects referenced by the table's elements when the garbage collector last scanned
+		// them. The garbage collector visits gcReferences instead of scanning the elements of a
+		// table that hasn't been written since, as indicated by runtimeData->gcReferencesAreStale.
+		std::vector<Object*> gcReferences;
+
 		Table(Compartment* inCompartment,
 			  const IR::TableType& inType,
 			  std::string&& inDebugName,
@@ -73,6 +81,15 @@ namespace WAVM { namespace Runtime {
 	// at the end of the array will, when re-adding this Function's address, point to this Object.
 	extern Object* getOutOfBoundsElement();
 
+	// This is used as a sentinel value for table elements that are null.
+	extern Object* getUninitializedElement();
+
+	// The current epoch. Compiled code loads it directly to check the contexts' epoch deadlines.
+	extern std::atomic<U64> currentEpoch;
+
+	// A snapshot of a memory's contents that memories may be mapped copy-on-write from.
+	struct MemorySnapshot;
+
 	// An instance of a WebAssembly Memory.
 	struct Memory : GCObject
 	{
@@ -86,6 +103,15 @@ namespace WAVM { namespace Runtime {
 		mutable Platform::RWMutex resizingMutex;
 		std::atomic<Uptr> numPages{0};
 
+		// If non-null, the memory was cloned, and its pages are a copy-on-write mapping of this
+		// snapshot, which may be shared with memories cloned from this one. Protected by
+		// resizingMutex.
+		std::shared_ptr<MemorySnapshot> snapshot;
+
+		// Whether any of the memory's pages were ever mapped copy-on-write from a snapshot, even if
+		// the snapshot has since been reset.
+		bool isMappedCopyOnWrite = false;
+
 		ResourceQuotaRef resourceQuota;
 
 		Memory(Compartment* inCompartment,
@@ -133,6 +159,9 @@ namespace WAVM { namespace Runtime {
 		IR::ExceptionType sig;
 		std::string debugName;
 
+		// The maximum number of call stack frames to capture for exceptions of this type.
+		std::atomic<Uptr> maxCallStackFrames{Platform::CallStack::maxFrames};
+
 		ExceptionType(Compartment* inCompartment,
 					  IR::ExceptionType inSig,
 					  std::string&& inDebugName)
@@ -152,14 +181,42 @@ namespace WAVM { namespace Runtime {
 	struct Module
 	{
 		IR::Module ir;
-		std::vector<U8> objectCode;
-
-		Module(IR::Module&& inIR, std::vector<U8>&& inObjectCode)
-		: ir(inIR), objectCode(std::move(inObjectCode))
+		ObjectCodeView objectCode;
+
+		// The tier the object code was compiled at, and the hotness at which its baseline-tier
+		// functions are recompiled at the optimized tier.
+		const LLVMJIT::CompileTier tier;
+		const U64 tierUpHotnessThreshold;
+
+		// Whether the object code meters fuel and checks epoch deadlines.
+		const bool meterFuel;
+		const bool checkEpochDeadlines;
+
+		// Optimized-tier object code for the module's function definitions, compiled when the
+		// function first becomes hot in any instance of the module, and shared by all instances.
+		mutable Platform::Mutex tierUpObjectCodeMutex;
+		mutable std::vector<std::vector<U8>> tierUpObjectCode;
+
+		// The functions defined by the object code and their debug info, which are found when
+		// the first instance of the module is loaded, and reused to load later instances.
+		const std::shared_ptr<LLVMJIT::ObjectCodeInfo> objectCodeInfo;
+
+		Module(IR::Module&& inIR,
+			   ObjectCodeView&& inObjectCode,
+			   const LLVMJIT::CompileOptions& compileOptions = LLVMJIT::CompileOptions())
+		: ir(inIR)
+		, objectCode(std::move(inObjectCode))
+		, tier(compileOptions.tier)
+		, tierUpHotnessThreshold(compileOptions.tierUpHotnessThreshold)
+		, meterFuel(compileOptions.meterFuel)
+		, checkEpochDeadlines(compileOptions.checkEpochDeadlines)
+		, objectCodeInfo(LLVMJIT::createObjectCodeInfo())
 		{
 		}
 	};
 
+	struct JITCodeCharge;
+
 	// An instance of a WebAssembly module.
 	struct ModuleInstance : GCObject
 	{
@@ -187,6 +244,12 @@ namespace WAVM { namespace Runtime {
 
 		ResourceQuotaRef resourceQuota;
 
+		// Whether instantiating the module charged the instance and its JIT code to resourceQuota.
+		// Instances cloned into another compartment share the original's JIT code, and aren't
+		// charged.
+		bool isChargedToResourceQuota = false;
+		std::shared_ptr<JITCodeCharge> jitCodeCharge;
+
 		ModuleInstance(Compartment* inCompartment,
 					   Uptr inID,
 					   HashMap<std::string, Object*>&& inExportMap,
@@ -227,6 +290,8 @@ namespace WAVM { namespace Runtime {
 	{
 		Uptr id = UINTPTR_MAX;
 		struct ContextRuntimeData* runtimeData = nullptr;
+		ResourceQuotaRef resourceQuota;
+		FuelExhaustedHandler fuelExhaustedHandler;
 
 		Context(Compartment* inCompartment) : GCObject(ObjectKind::context, inCompartment) {}
 		~Context();
@@ -249,6 +314,10 @@ namespace WAVM { namespace Runtime {
 		DenseStaticIntSet<U32, maxMutableGlobals> globalDataAllocationMask;
 		IR::UntaggedValue initialContextMutableGlobals[maxMutableGlobals];
 
+		// The call stack depth of the compartment's exception types, which also limits the call
+		// stack depth of the intrinsic exception types when code in the compartment traps.
+		std::atomic<Uptr> exceptionCallStackDepth{Platform::CallStack::maxFrames};
+
 		Compartment();
 		~Compartment();
 	};
@@ -260,54 +329,69 @@ namespace WAVM { namespace Runtime {
 
 	struct ResourceQuota
 	{
+		// Tracks the current usage and limit of a resource. The current usage is updated with
+		// atomic compare-and-swap, so allocations from different threads don't serialize on a lock.
 		template<typename Value> struct CurrentAndMax
 		{
-			CurrentAndMax(Value inMax) : current{0}, max(inMax) {}
+			CurrentAndMax(Value inMax) : current{0}, max{inMax} {}
 
 			bool allocate(Value delta)
 			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-
-				// Make sure the delta doesn't make current overflow.
-				if(current + delta < current) { return false; }
-
-				if(current + delta > max) { return false; }
-
-				current += delta;
+				Value oldCurrent = current.load(std::memory_order_relaxed);
+				Value newCurrent;
+				do
+				{
+					// Make sure the delta doesn't make current overflow.
+					newCurrent = oldCurrent + delta;
+					if(newCurrent < oldCurrent) { return false; }
+
+					if(newCurrent > max.load(std::memory_order_relaxed)) { return false; }
+				} while(!current.compare_exchange_weak(
+					oldCurrent, newCurrent, std::memory_order_relaxed));
 				return true;
 			}
 
 			void free(Value delta)
 			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-				WAVM_ASSERT(current - delta <= current);
-				current -= delta;
+				const Value oldCurrent = current.fetch_sub(delta, std::memory_order_relaxed);
+				WAVM_ASSERT(oldCurrent - delta <= oldCurrent);
+				WAVM_SUPPRESS_UNUSED(oldCurrent);
 			}
 
-			Value getCurrent() const
-			{
-				Platform::RWMutex::ShareableLock lock(mutex);
-				return current;
-			}
-			Value getMax() const
-			{
-				Platform::RWMutex::ShareableLock lock(mutex);
-				return max;
-			}
-			void setMax(Value newMax)
-			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-				max = newMax;
-			}
+			Value getCurrent() const { return current.load(std::memory_order_relaxed); }
+			Value getMax() const { return max.load(std::memory_order_relaxed); }
+			void setMax(Value newMax) { max.store(newMax, std::memory_order_relaxed); }
 
 		private:
-			mutable Platform::RWMutex mutex;
-			Value current;
-			Value max;
+			std::atomic<Value> current;
+			std::atomic<Value> max;
 		};
 
 		CurrentAndMax<Uptr> memoryPages{UINTPTR_MAX};
 		CurrentAndMax<Uptr> tableElems{UINTPTR_MAX};
+		CurrentAndMax<Uptr> moduleInstances{UINTPTR_MAX};
+		CurrentAndMax<Uptr> contexts{UINTPTR_MAX};
+		CurrentAndMax<Uptr> jitCodeBytes{UINTPTR_MAX};
+	};
+
+	// The JIT code bytes charged to a resource quota for a module instance: the code loaded when
+	// the module was instantiated, and the tier-up code loaded into the instance later. The tier-up
+	// job may load code while the instance is being destroyed, so the charge is freed once both
+	// have released their references to it.
+	struct JITCodeCharge
+	{
+		const ResourceQuotaRef resourceQuota;
+		std::atomic<Uptr> numBytes{0};
+
+		JITCodeCharge(ResourceQuotaRefParam inResourceQuota) : resourceQuota(inResourceQuota) {}
+		~JITCodeCharge() { resourceQuota->jitCodeBytes.free(numBytes.load()); }
+
+		bool allocate(Uptr numAllocatedBytes)
+		{
+			if(!resourceQuota->jitCodeBytes.allocate(numAllocatedBytes)) { return false; }
+			numBytes += numAllocatedBytes;
+			return true;
+		}
 	};
 
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsics);
@@ -316,6 +400,14 @@ namespace WAVM { namespace Runtime {
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsicsMemory);
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsicsTable);
 
+	// Reads a table element for the garbage collector, without checking its index against the
+	// table's size. The caller must ensure the index is less than the table's number of elements.
+	Object* getTableElementForGC(const Table* table, Uptr elementIndex);
+
+	// The compartment of the innermost invokeFunction call on the current thread, or null if the
+	// thread isn't running WebAssembly code.
+	extern thread_local Compartment* innermostInvokeCompartment;
+
 	// Checks whether an address is owned by a table or memory.
 	bool isAddressOwnedByTable(U8* address, Table*& outTable, Uptr& outTableIndex);
 	bool isAddressOwnedByMemory(U8* address, Memory*& outMemory, Uptr& outMemoryAddress);
@@ -352,6 +444,51 @@ namespace WAVM { namespace Runtime {
 						 Uptr destOffset,
 						 Uptr sourceOffset,
 						 Uptr numElems);
+
+	// Registers a loaded instance of a module that was compiled at the baseline tier, so its hot
+	// functions will be recompiled at the optimized tier in the background. If jitCodeCharge is
+	// non-null, the tier-up code loaded into the instance is charged to it.
+	void registerBaselineTierCode(ModuleConstRefParam module,
+								  const std::shared_ptr<LLVMJIT::Module>& jitModule,
+								  const std::vector<FunctionMutableData*>& functionDefMutableDatas,
+								  const std::shared_ptr<JITCodeCharge>& jitCodeCharge);
+
+	// Returns the options and object cache set by setGlobalCompileOptions and
+	// setGlobalObjectCache.
+	LLVMJIT::CompileOptions getGlobalCompileOptions();
+	std::shared_ptr<ObjectCacheInterface> getGlobalObjectCache();
+
+	// Object code is cached per partition of a module's function definitions, so a module that
+	// shares most of its function definitions with a cached module only needs to compile the
+	// partitions that differ. Partitions end after the function definitions for which
+	// isCachedPartitionEnd returns true, which only depends on the function definition and the
+	// number of code bytes in the partition so far.
+	bool isCachedPartitionEnd(const IR::FunctionDef& functionDef, Uptr numPartitionCodeBytes);
+
+	// Returns the state of a partition's cache key hash after hashing the part of the key that is
+	// shared by all partitions of the module: the module's declarations that affect the code
+	// compiled for its function definitions.
+	StreamingHash128 getPartitionCacheLayoutKey(const IR::Module& irModule);
+
+	// Looks up the object code for a partition of a module's function definitions in the object
+	// cache, compiling it if it isn't cached.
+	ObjectCodeView getCachedModulePartition(ObjectCacheInterface& objectCache,
+											const IR::Module& irModule,
+											const StreamingHash128& layoutKey,
+											Uptr beginFunctionDefIndex,
+											Uptr endFunctionDefIndex,
+											LLVMJIT::CompileTier tier,
+											bool meterFuel,
+											bool checkEpochDeadlines);
+
+	// Links the object code for a module's partitions. A single partition's object code is
+	// returned without copying it.
+	ObjectCodeView linkModulePartitions(const std::vector<ObjectCodeView>& partitions);
+
+	// Compiles a module, reusing the object code for any of its partitions that are cached.
+	ObjectCodeView compileModuleWithObjectCache(const IR::Module& irModule,
+												const LLVMJIT::CompileOptions& compileOptions,
+												ObjectCacheInterface& objectCache);
 }}
 
 namespace WAVM { namespace Intrinsics {
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Platform/WorkerPool.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+// The number of bytes of function definition code that are loaded before they are compiled as a
+// partition of the module.
+static constexpr Uptr streamingPartitionNumCodeBytes = 256 * 1024;
+
+// An input stream that reads from chunks of bytes that are added by another thread. Reading blocks
+// until enough bytes have been added, or until the end of the stream is signaled.
+struct ChunkedInputStream : Serialization::InputStream
+{
+	ChunkedInputStream() : InputStream(nullptr, nullptr) {}
+
+	void addBytes(const U8* bytes, Uptr numBytes)
+	{
+		{
+			Platform::Mutex::Lock lock(mutex);
+			WAVM_ASSERT(!isFinished);
+			pendingChunks.emplace_back(bytes, bytes + numBytes);
+			numPendingBytes += numBytes;
+		}
+		moreDataEvent.signal();
+	}
+
+	void finish()
+	{
+		{
+			Platform::Mutex::Lock lock(mutex);
+			isFinished = true;
+		}
+		moreDataEvent.signal();
+	}
+
+	// Waits until there is at least one byte available or the end of the stream is signaled.
+	virtual Uptr capacity() const
+	{
+		while(true)
+		{
+			{
+				Platform::Mutex::Lock lock(mutex);
+				if(next != end || numPendingBytes || isFinished)
+				{ return Uptr(end - next) + numPendingBytes; }
+			}
+			moreDataEvent.wait(Time::infinity());
+		};
+	}
+
+private:
+	mutable Platform::Mutex mutex;
+	mutable Platform::Event moreDataEvent;
+
+	// The chunks that have been added but not read yet. Protected by mutex.
+	std::deque<std::vector<U8>> pendingChunks;
+	Uptr numPendingBytes = 0;
+	bool isFinished = false;
+
+	// The buffers that have been read from. Pointers returned by advance must remain valid, so
+	// these are kept until the stream is destroyed.
+	std::vector<std::vector<U8>> buffers;
+
+	virtual void getMoreData(Uptr numBytes)
+	{
+		const Uptr numBufferedBytes = Uptr(end - next);
+		while(true)
+		{
+			{
+				Platform::Mutex::Lock lock(mutex);
+				if(numBufferedBytes + numPendingBytes >= numBytes)
+				{
+					if(!numBufferedBytes && pendingChunks.front().size() >= numBytes)
+					{
+						// If the next chunk has enough bytes, read from it directly.
+						numPendingBytes -= pendingChunks.front().size();
+						buffers.push_back(std::move(pendingChunks.front()));
+						pendingChunks.pop_front();
+					}
+					else
+					{
+						// Otherwise, copy the rest of the current buffer and all the pending chunks
+						// into a new contiguous buffer.
+						std::vector<U8> buffer;
+						buffer.reserve(numBufferedBytes + numPendingBytes);
+						buffer.insert(buffer.end(), next, end);
+						for(const std::vector<U8>& chunk : pendingChunks)
+						{ buffer.insert(buffer.end(), chunk.begin(), chunk.end()); }
+						pendingChunks.clear();
+						numPendingBytes = 0;
+						buffers.push_back(std::move(buffer));
+					}
+
+					next = buffers.back().data();
+					end = next + buffers.back().size();
+					return;
+				}
+				else if(isFinished)
+				{
+					throw Serialization::FatalSerializationException(
+						"expected data but found end of stream");
+				}
+			}
+			moreDataEvent.wait(Time::infinity());
+		};
+	}
+};
+
+struct Runtime::StreamingModuleLoader
+{
+	ChunkedInputStream stream;
+
+	// The module that the load thread loads into. Only accessed by the load thread until it exits.
+	IR::Module irModule;
+
+	// The module that the compile jobs compile from. It is copied from irModule when the first
+	// partition is added, after all the declarations used by compiled code have been loaded. The
+	// function bodies of each later partition are moved into it from irModule when the partition
+	// is added, and moved back to irModule after the compile jobs finish. Compile jobs read the
+	// types of all the module's function definitions, so only the bodies are moved while they may
+	// be running.
+	std::unique_ptr<IR::Module> compileModule;
+
+	const LLVMJIT::CompileOptions compileOptions;
+	const std::shared_ptr<ObjectCacheInterface> objectCache;
+
+	// If there is an object cache, partitions end at the same content-defined boundaries as
+	// compileModuleWithObjectCache uses, so each partition can be looked up in the cache as soon
+	// as it has been loaded. The layout key is computed when the first partition is added, after
+	// the module's declarations have been loaded.
+	const bool shouldUseObjectCache;
+	StreamingHash128 layoutKey;
+
+	Platform::Thread* loadThread = nullptr;
+	std::atomic<bool> hasLoadFailed{false};
+	WASM::LoadError loadError;
+
+	// The partitions of the module's function definitions that have been loaded, and the number
+	// of jobs that are compiling them on the worker pool. Protected by compileMutex, which also
+	// protects adding partitions to compileModule.
+	struct Partition
+	{
+		Uptr beginFunctionDefIndex;
+		Uptr endFunctionDefIndex;
+		ObjectCodeView objectFile;
+	};
+	Platform::Mutex compileMutex;
+	std::deque<Partition> partitions;
+	Uptr numCompiledPartitions = 0;
+	Uptr numRunningCompileJobs = 0;
+
+	// Signaled when a compile job finishes, while compileMutex is locked.
+	Platform::Event compileJobFinishedEvent;
+
+	// The function definitions that have been loaded, but not added to a partition. Only accessed
+	// by the load thread.
+	Uptr nextPartitionBeginFunctionDefIndex = 0;
+	Uptr numUnpartitionedCodeBytes = 0;
+
+	StreamingModuleLoader(const IR::FeatureSpec& featureSpec,
+						  const LLVMJIT::CompileOptions& inCompileOptions,
+						  std::shared_ptr<ObjectCacheInterface>&& inObjectCache)
+	: irModule(featureSpec)
+	, compileOptions(inCompileOptions)
+	, objectCache(std::move(inObjectCache))
+	, shouldUseObjectCache(objectCache && compileOptions.tier != LLVMJIT::CompileTier::baseline)
+	{
+	}
+
+	void addPartition(Uptr endFunctionDefIndex);
+};
+
+static void runCompileJob(StreamingModuleLoader* loader)
+{
+	while(true)
+	{
+		// Find the first partition that hasn't started compiling.
+		Uptr beginFunctionDefIndex;
+		Uptr endFunctionDefIndex;
+		ObjectCodeView* objectFile;
+		{
+			Platform::Mutex::Lock compileLock(loader->compileMutex);
+			if(loader->numCompiledPartitions == loader->partitions.size())
+			{
+				// Signal the event while compileMutex is locked, so finishStreamingModuleLoad
+				// can't destroy the loader before the event is signaled.
+				--loader->numRunningCompileJobs;
+				loader->compileJobFinishedEvent.signal();
+				return;
+			}
+
+			StreamingModuleLoader::Partition& partition
+				= loader->partitions[loader->numCompiledPartitions++];
+			beginFunctionDefIndex = partition.beginFunctionDefIndex;
+			endFunctionDefIndex = partition.endFunctionDefIndex;
+			objectFile = &partition.objectFile;
+		}
+
+		// The partition's function definitions, and the module's declarations, won't be changed
+		// in compileModule while it is compiled.
+		const LLVMJIT::CompileOptions& compileOptions = loader->compileOptions;
+		if(loader->shouldUseObjectCache)
+		{
+			*objectFile = getCachedModulePartition(*loader->objectCache,
+												   *loader->compileModule,
+												   loader->layoutKey,
+												   beginFunctionDefIndex,
+												   endFunctionDefIndex,
+												   compileOptions.tier,
+												   compileOptions.meterFuel,
+												   compileOptions.checkEpochDeadlines);
+		}
+		else
+		{
+			*objectFile = LLVMJIT::compileModulePartition(*loader->compileModule,
+														  LLVMJIT::getHostTargetSpec(),
+														  beginFunctionDefIndex,
+														  endFunctionDefIndex,
+														  compileOptions.tier,
+														  compileOptions.meterFuel,
+														  compileOptions.checkEpochDeadlines);
+		}
+	};
+}
+
+void StreamingModuleLoader::addPartition(Uptr endFunctionDefIndex)
+{
+	Platform::Mutex::Lock compileLock(compileMutex);
+	if(!partitions.size())
+	{
+		compileModule.reset(new IR::Module(irModule));
+		if(shouldUseObjectCache) { layoutKey = getPartitionCacheLayoutKey(*compileModule); }
+	}
+	else
+	{
+		for(Uptr functionDefIndex = nextPartitionBeginFunctionDefIndex;
+			functionDefIndex < endFunctionDefIndex;
+			++functionDefIndex)
+		{
+			IR::FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
+			IR::FunctionDef& compileFunctionDef = compileModule->functions.defs[functionDefIndex];
+			compileFunctionDef.nonParameterLocalTypes
+				= std::move(functionDef.nonParameterLocalTypes);
+			compileFunctionDef.code = std::move(functionDef.code);
+			compileFunctionDef.branchTables = std::move(functionDef.branchTables);
+		}
+	}
+	partitions.push_back({nextPartitionBeginFunctionDefIndex, endFunctionDefIndex, {}});
+	nextPartitionBeginFunctionDefIndex = endFunctionDefIndex;
+	numUnpartitionedCodeBytes = 0;
+
+	// Start another compile job if there are fewer than the compile options allow.
+	if(numRunningCompileJobs < std::max(compileOptions.numThreads, Uptr(1)))
+	{
+		++numRunningCompileJobs;
+		Platform::runAsyncJob([this] { runCompileJob(this); });
+	}
+}
+
+static I64 loadThreadMain(void* loaderVoid)
+{
+	StreamingModuleLoader* loader = (StreamingModuleLoader*)loaderVoid;
+
+	// Decode the function bodies sequentially, so each body is loaded as soon as it arrives.
+	WASM::LoadOptions loadOptions;
+	loadOptions.onFunctionBodyLoaded = [loader](Uptr functionDefIndex) {
+		const IR::FunctionDef& functionDef = loader->irModule.functions.defs[functionDefIndex];
+		loader->numUnpartitionedCodeBytes += functionDef.code.size() + 1;
+		if(loader->shouldUseObjectCache
+			   ? isCachedPartitionEnd(functionDef, loader->numUnpartitionedCodeBytes)
+			   : loader->numUnpartitionedCodeBytes >= streamingPartitionNumCodeBytes)
+		{ loader->addPartition(functionDefIndex + 1); }
+	};
+
+	if(!WASM::loadBinaryModule(loader->stream, loader->irModule, &loader->loadError, loadOptions))
+	{
+		loader->hasLoadFailed.store(true, std::memory_order_release);
+		return 0;
+	}
+
+	// Compile the remaining function definitions. A module without function definitions still
+	// needs to be compiled once.
+	if(loader->nextPartitionBeginFunctionDefIndex < loader->irModule.functions.defs.size()
+	   || !loader->partitions.size())
+	{ loader->addPartition(loader->irModule.functions.defs.size()); }
+
+	return 1;
+}
+
+StreamingModuleLoader* Runtime::createStreamingModuleLoader(const IR::FeatureSpec& featureSpec)
+{
+	StreamingModuleLoader* loader
+		= new StreamingModuleLoader(featureSpec, getGlobalCompileOptions(), getGlobalObjectCache());
+	loader->loadThread = Platform::createThread(8 * 1024 * 1024, loadThreadMain, loader);
+	return loader;
+}
+
+bool Runtime::addStreamingModuleBytes(StreamingModuleLoader* loader,
+									  const U8* bytes,
+									  Uptr numBytes)
+{
+	if(loader->hasLoadFailed.load(std::memory_order_acquire)) { return false; }
+
+	loader->stream.addBytes(bytes, numBytes);
+	return true;
+}
+
+bool Runtime::finishStreamingModuleLoad(StreamingModuleLoader* loader,
+										ModuleRef& outModule,
+										WASM::LoadError* outError)
+{
+	std::unique_ptr<StreamingModuleLoader> loaderOwner(loader);
+
+	// Wait for the load to finish. Once the load thread has exited, no more partitions will be
+	// added, so no more compile jobs will be started.
+	loader->stream.finish();
+	const bool loadSucceeded = Platform::joinThread(loader->loadThread) != 0;
+	while(true)
+	{
+		{
+			Platform::Mutex::Lock compileLock(loader->compileMutex);
+			if(!loader->numRunningCompileJobs) { break; }
+		}
+		loader->compileJobFinishedEvent.wait(Time::infinity());
+	}
+
+	if(!loadSucceeded)
+	{
+		if(outError) { *outError = std::move(loader->loadError); }
+		return false;
+	}
+
+	// Move the function bodies that were moved to compileModule back to irModule.
+	if(loader->partitions.size())
+	{
+		for(Uptr functionDefIndex = loader->partitions.front().endFunctionDefIndex;
+			functionDefIndex < loader->irModule.functions.defs.size();
+			++functionDefIndex)
+		{
+			loader->irModule.functions.defs[functionDefIndex]
+				= std::move(loader->compileModule->functions.defs[functionDefIndex]);
+		}
+	}
+
+	Timing::Timer linkTimer;
+	std::vector<ObjectCodeView> objectFiles;
+	for(StreamingModuleLoader::Partition& partition : loader->partitions)
+	{ objectFiles.push_back(std::move(partition.objectFile)); }
+	ObjectCodeView objectCode = linkModulePartitions(objectFiles);
+	Timing::logTimer("Linked streamed module partitions", linkTimer);
+
+	outModule = std::make_shared<Runtime::Module>(
+		std::move(loader->irModule), std::move(objectCode), loader->compileOptions);
+	return true;
+}
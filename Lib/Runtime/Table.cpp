@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <vector>
+#include "ReservedRegionIndex.h"
 #include "RuntimePrivate.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/Assert.h"
@@ -20,12 +21,16 @@ namespace WAVM { namespace Runtime {
 	WAVM_DEFINE_INTRINSIC_MODULE(wavmIntrinsicsTable)
 }}
 
-// Global lists of tables; used to query whether an address is reserved by one of them.
-static Platform::RWMutex tablesMutex;
-static std::vector<Table*> tables;
+// Global index of the address space reserved by tables; used to query whether an address is
+// reserved by one of them.
+static ReservedRegionIndex<Table> tableRegionIndex;
 
 static constexpr Uptr numGuardPages = 1;
 
+// The TableRuntimeData is stored at the end of a page that is reserved immediately before the
+// table's elements.
+static constexpr Uptr numRuntimeDataPages = 1;
+
 static Uptr getNumPlatformPages(Uptr numBytes)
 {
 	return (numBytes + Platform::getBytesPerPage() - 1) >> Platform::getBytesPerPageLog2();
@@ -46,7 +51,7 @@ Object* Runtime::getOutOfBoundsElement()
 	return asObject(function);
 }
 
-static Object* getUninitializedElement()
+Object* Runtime::getUninitializedElement()
 {
 	static Function* function = makeDummyFunction("uninitialized table element");
 	return asObject(function);
@@ -62,6 +67,16 @@ static Object* biasedTableElementValueToObject(Uptr biasedValue)
 	return reinterpret_cast<Object*>(biasedValue + reinterpret_cast<Uptr>(getOutOfBoundsElement()));
 }
 
+// Marks the table's gcReferences as stale after an element is written. The element write and this
+// are sequentially consistent, so a concurrent garbage collection that clears the flag before
+// scanning the table either reads the new element, or leaves the table marked as stale. Compiled
+// code does the same after it writes an element.
+static void markTableGCReferencesStale(Table* table)
+{
+	if(!table->runtimeData->gcReferencesAreStale.load(std::memory_order_seq_cst))
+	{ table->runtimeData->gcReferencesAreStale.store(1, std::memory_order_seq_cst); }
+}
+
 static Table* createTableImpl(Compartment* compartment,
 							  IR::TableType type,
 							  std::string&& debugName,
@@ -76,21 +91,26 @@ static Table* createTableImpl(Compartment* compartment,
 	const U64 tableMaxBytes = sizeof(Table::Element) * tableMaxElements;
 	const U64 tableMaxPages = tableMaxBytes >> pageBytesLog2;
 
-	table->elements
-		= (Table::Element*)Platform::allocateVirtualPages(tableMaxPages + numGuardPages);
-	table->numReservedBytes = tableMaxBytes;
-	table->numReservedElements = tableMaxElements;
-	if(!table->elements)
+	U8* reservationBase = Platform::allocateVirtualPages(numRuntimeDataPages + tableMaxPages
+														 + numGuardPages);
+	if(!reservationBase)
 	{
 		delete table;
 		return nullptr;
 	}
+	table->elements
+		= (Table::Element*)(reservationBase + (numRuntimeDataPages << pageBytesLog2));
+	table->numReservedBytes = tableMaxBytes;
+	table->numReservedElements = tableMaxElements;
 
-	// Add the table to the global array.
-	{
-		Platform::RWMutex::ExclusiveLock tablesLock(tablesMutex);
-		tables.push_back(table);
-	}
+	// Commit the page that holds the TableRuntimeData, and initialize it.
+	WAVM_ERROR_UNLESS(Platform::commitVirtualPages(reservationBase, numRuntimeDataPages));
+	table->runtimeData = new((TableRuntimeData*)table->elements - 1) TableRuntimeData;
+	table->runtimeData->numElements.store(0, std::memory_order_release);
+	table->runtimeData->gcReferencesAreStale.store(1, std::memory_order_release);
+
+	// Add the table to the global index.
+	tableRegionIndex.add((U8*)table->elements, table->numReservedBytes, table);
 	return table;
 }
 
@@ -101,7 +121,8 @@ static bool growTableImpl(Table* table,
 						  Runtime::Object* initializeToElement = getUninitializedElement())
 {
 	Uptr oldNumElements;
-	if(!numElementsToGrow) { oldNumElements = table->numElements.load(std::memory_order_acquire); }
+	if(!numElementsToGrow)
+	{ oldNumElements = table->runtimeData->numElements.load(std::memory_order_acquire); }
 	else
 	{
 		// Check the table element quota.
@@ -110,7 +131,7 @@ static bool growTableImpl(Table* table,
 
 		Platform::RWMutex::ExclusiveLock resizingLock(table->resizingMutex);
 
-		oldNumElements = table->numElements.load(std::memory_order_acquire);
+		oldNumElements = table->runtimeData->numElements.load(std::memory_order_acquire);
 
 		// If the growth would cause the table's size to exceed its maximum, return -1.
 		if(numElementsToGrow > table->type.size.max
@@ -147,9 +168,10 @@ static bool growTableImpl(Table* table,
 				table->elements[elementIndex].biasedValue.store(biasedTableInitElement,
 																std::memory_order_release);
 			}
+			markTableGCReferencesStale(table);
 		}
 
-		table->numElements.store(newNumElements, std::memory_order_release);
+		table->runtimeData->numElements.store(newNumElements, std::memory_order_release);
 	}
 
 	if(outOldNumElements) { *outOldNumElements = oldNumElements; }
@@ -201,7 +223,7 @@ Table* Runtime::cloneTable(Table* table, Compartment* newCompartment)
 	Platform::RWMutex::ExclusiveLock resizingLock(table->resizingMutex);
 
 	// Create the new table.
-	const Uptr numElements = table->numElements.load(std::memory_order_acquire);
+	const Uptr numElements = table->runtimeData->numElements.load(std::memory_order_acquire);
 	std::string debugName = table->debugName;
 	Table* newTable
 		= createTableImpl(newCompartment, table->type, std::move(debugName), table->resourceQuota);
@@ -251,48 +273,29 @@ Table::~Table()
 		compartment->runtimeData->tableBases[id] = nullptr;
 	}
 
-	// Remove the table from the global array.
-	{
-		Platform::RWMutex::ExclusiveLock tablesLock(tablesMutex);
-		for(Uptr tableIndex = 0; tableIndex < tables.size(); ++tableIndex)
-		{
-			if(tables[tableIndex] == this)
-			{
-				tables.erase(tables.begin() + tableIndex);
-				break;
-			}
-		}
-	}
+	// Remove the table from the global index.
+	if(elements) { tableRegionIndex.remove((U8*)elements, numReservedBytes, this); }
+
+	// Free the allocated quota.
+	if(resourceQuota && runtimeData)
+	{ resourceQuota->tableElems.free(runtimeData->numElements.load(std::memory_order_acquire)); }
 
 	// Free the virtual address space.
 	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
 	if(numReservedBytes > 0)
 	{
-		Platform::freeVirtualPages((U8*)elements,
-								   (numReservedBytes >> pageBytesLog2) + numGuardPages);
+		Platform::freeVirtualPages(
+			(U8*)elements - (numRuntimeDataPages << pageBytesLog2),
+			numRuntimeDataPages + (numReservedBytes >> pageBytesLog2) + numGuardPages);
 	}
-
-	// Free the allocated quota.
-	if(resourceQuota) { resourceQuota->tableElems.free(numElements); }
 }
 
 bool Runtime::isAddressOwnedByTable(U8* address, Table*& outTable, Uptr& outTableIndex)
 {
-	// Iterate over all tables and check if the address is within the reserved address space for
-	// each.
-	Platform::RWMutex::ShareableLock tablesLock(tablesMutex);
-	for(auto table : tables)
-	{
-		U8* startAddress = (U8*)table->elements;
-		U8* endAddress = ((U8*)table->elements) + table->numReservedBytes;
-		if(address >= startAddress && address < endAddress)
-		{
-			outTable = table;
-			outTableIndex = (address - startAddress) / sizeof(Table::Element);
-			return true;
-		}
-	}
-	return false;
+	Uptr tableOffset = 0;
+	if(!tableRegionIndex.find(address, outTable, tableOffset)) { return false; }
+	outTableIndex = tableOffset / sizeof(Table::Element);
+	return true;
 }
 
 static Object* setTableElementNonNull(Table* table, Uptr index, Object* object)
@@ -318,9 +321,10 @@ static Object* setTableElementNonNull(Table* table, Uptr index, Object* object)
 		if(biasedTableElementValueToObject(oldBiasedValue) == getOutOfBoundsElement())
 		{ throwException(ExceptionTypes::outOfBoundsTableAccess, {table, U64(index)}); }
 		if(table->elements[saturatedIndex].biasedValue.compare_exchange_weak(
-			   oldBiasedValue, biasedValue, std::memory_order_acq_rel))
+			   oldBiasedValue, biasedValue, std::memory_order_seq_cst))
 		{ break; }
 	};
+	markTableGCReferencesStale(table);
 
 	return biasedTableElementValueToObject(oldBiasedValue);
 }
@@ -354,6 +358,13 @@ static Object* getTableElementNonNull(const Table* table, Uptr index)
 	return object;
 }
 
+Object* Runtime::getTableElementForGC(const Table* table, Uptr elementIndex)
+{
+	WAVM_ASSERT(elementIndex < table->runtimeData->numElements.load(std::memory_order_acquire));
+	return biasedTableElementValueToObject(
+		table->elements[elementIndex].biasedValue.load(std::memory_order_seq_cst));
+}
+
 Object* Runtime::setTableElement(Table* table, Uptr index, Object* newValue)
 {
 	WAVM_ASSERT(!newValue || isInCompartment(newValue, table->compartment));
@@ -383,7 +394,7 @@ Object* Runtime::getTableElement(const Table* table, Uptr index)
 
 Uptr Runtime::getTableNumElements(const Table* table)
 {
-	return table->numElements.load(std::memory_order_acquire);
+	return table->runtimeData->numElements.load(std::memory_order_acquire);
 }
 
 IR::TableType Runtime::getTableType(const Table* table) { return table->type; }
@@ -668,3 +679,14 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsTable,
 		throwException(ExceptionTypes::indirectCallSignatureMismatch);
 	}
 }
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsTable,
+							   "outOfBoundsTableAccessTrap",
+							   void,
+							   outOfBoundsTableAccessTrap,
+							   U32 index,
+							   Uptr tableId)
+{
+	Table* table = getTableFromRuntimeData(contextRuntimeData, tableId);
+	throwException(ExceptionTypes::outOfBoundsTableAccess, {table, U64(index)});
+}
@@ -0,0 +1,230 @@
+#include <memory>
+#include <utility>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/WorkerPool.h"
+#include "WAVM/Runtime/Intrinsics.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+// A loaded instance of a module that was compiled at the baseline tier.
+struct BaselineTierInstance
+{
+	ModuleConstRef module;
+	std::weak_ptr<LLVMJIT::Module> jitModule;
+
+	// The FunctionMutableData objects are owned by the LLVMJIT::Module, so they may only be
+	// accessed while holding a reference to it.
+	std::vector<FunctionMutableData*> functionDefMutableDatas;
+
+	// The resource quota charge for the instance's JIT code, if it has one. Tier-up code isn't
+	// loaded into an instance whose charge has been released.
+	bool isChargedToResourceQuota;
+	std::weak_ptr<JITCodeCharge> jitCodeCharge;
+};
+
+// A baseline-tier instance that tier-up code is being loaded into.
+struct TierUpTarget
+{
+	std::shared_ptr<LLVMJIT::Module> jitModule;
+	std::shared_ptr<JITCodeCharge> jitCodeCharge;
+};
+
+// A function definition whose optimized-tier code should be loaded into all the baseline-tier
+// instances of its module.
+struct TierUpRequest
+{
+	ModuleConstRef module;
+	Uptr functionDefIndex;
+};
+
+struct TierUpState
+{
+	// Protects the remaining fields.
+	Platform::Mutex mutex;
+
+	// The registered baseline-tier instances, keyed by a unique ID that is stored in the
+	// FunctionTierUpState of each of the instance's functions. The IDs aren't reused, so an
+	// instance that has been unloaded can't be mistaken for a later one. Instances that have been
+	// unloaded are removed when the number of instances doubles.
+	HashMap<U64, BaselineTierInstance> instances;
+	U64 nextInstanceId = 1;
+	Uptr numInstancesAfterLastPrune = 0;
+
+	// Tier-up requests are handled by a single job on the worker pool, which only runs while
+	// there are pending requests.
+	std::vector<TierUpRequest> pendingRequests;
+	bool isJobRunning = false;
+
+	static TierUpState& get()
+	{
+		// The state is never destroyed, so a tier-up job that is running at exit doesn't need to
+		// be waited for.
+		static TierUpState* tierUpState = new TierUpState;
+		return *tierUpState;
+	}
+
+	void pruneUnloadedInstances()
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(mutex);
+		std::vector<U64> unloadedInstanceIds;
+		for(const auto& instancePair : instances)
+		{
+			if(instancePair.value.jitModule.expired())
+			{ unloadedInstanceIds.push_back(instancePair.key); }
+		}
+		for(U64 instanceId : unloadedInstanceIds) { instances.removeOrFail(instanceId); }
+		numInstancesAfterLastPrune = instances.size();
+	}
+};
+
+// Returns the optimized-tier object code for a function definition, compiling it if necessary.
+// Only the tier-up job calls this, so the lock isn't held while compiling.
+static const std::vector<U8>& getTierUpObjectCode(const Runtime::Module& module,
+												  Uptr functionDefIndex)
+{
+	{
+		Platform::Mutex::Lock tierUpObjectCodeLock(module.tierUpObjectCodeMutex);
+		if(!module.tierUpObjectCode.size())
+		{ module.tierUpObjectCode.resize(module.ir.functions.defs.size()); }
+		if(module.tierUpObjectCode[functionDefIndex].size())
+		{ return module.tierUpObjectCode[functionDefIndex]; }
+	}
+
+	Timing::Timer compileTimer;
+	std::vector<U8> objectCode = LLVMJIT::compileTierUpFunction(module.ir,
+																LLVMJIT::getHostTargetSpec(),
+																functionDefIndex,
+																module.meterFuel,
+																module.checkEpochDeadlines);
+	Timing::logTimer("Compiled tier-up function", compileTimer);
+
+	Platform::Mutex::Lock tierUpObjectCodeLock(module.tierUpObjectCodeMutex);
+	module.tierUpObjectCode[functionDefIndex] = std::move(objectCode);
+	return module.tierUpObjectCode[functionDefIndex];
+}
+
+static void tierUpJob()
+{
+	TierUpState& tierUpState = TierUpState::get();
+	while(true)
+	{
+		// Take the next request, and find the live instances of its module.
+		TierUpRequest request;
+		std::vector<TierUpTarget> targets;
+		{
+			Platform::Mutex::Lock tierUpLock(tierUpState.mutex);
+			if(!tierUpState.pendingRequests.size())
+			{
+				tierUpState.isJobRunning = false;
+				return;
+			}
+
+			request = std::move(tierUpState.pendingRequests.back());
+			tierUpState.pendingRequests.pop_back();
+
+			for(const auto& instancePair : tierUpState.instances)
+			{
+				const BaselineTierInstance& instance = instancePair.value;
+				if(instance.module != request.module) { continue; }
+
+				std::shared_ptr<LLVMJIT::Module> jitModule = instance.jitModule.lock();
+				std::shared_ptr<JITCodeCharge> jitCodeCharge = instance.jitCodeCharge.lock();
+				if(!jitModule || (instance.isChargedToResourceQuota && !jitCodeCharge))
+				{ continue; }
+
+				FunctionMutableData* functionMutableData
+					= instance.functionDefMutableDatas[request.functionDefIndex];
+				if(!functionMutableData->tierUpState.optimizedCode.load(std::memory_order_acquire))
+				{ targets.push_back({std::move(jitModule), std::move(jitCodeCharge)}); }
+			}
+		}
+
+		if(!targets.size()) { continue; }
+
+		// Compile the function once for the module, and load the code into each of the module's
+		// instances that doesn't have it yet. Each instance needs its own copy of the code, since
+		// it is linked against the instance's imports. If loading the code would exceed the
+		// instance's JIT code quota, the instance keeps running the baseline-tier code.
+		const std::vector<U8>& objectCode
+			= getTierUpObjectCode(*request.module, request.functionDefIndex);
+		for(const TierUpTarget& target : targets)
+		{
+			LLVMJIT::loadTierUpCode(
+				target.jitModule.get(), objectCode, [&target](Uptr numLoadedBytes) {
+					return !target.jitCodeCharge || target.jitCodeCharge->allocate(numLoadedBytes);
+				});
+		}
+	}
+}
+
+static void queueTierUpRequest(TierUpState& tierUpState, TierUpRequest&& request)
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(tierUpState.mutex);
+	tierUpState.pendingRequests.push_back(std::move(request));
+	if(!tierUpState.isJobRunning)
+	{
+		tierUpState.isJobRunning = true;
+		Platform::runAsyncJob(tierUpJob);
+	}
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
+							   "requestTierUp",
+							   void,
+							   requestTierUp,
+							   const Function* function)
+{
+	// Baseline-tier code calls this when a function's hotness reaches its threshold.
+	TierUpState& tierUpState = TierUpState::get();
+	Platform::Mutex::Lock tierUpLock(tierUpState.mutex);
+	const FunctionMutableData* functionMutableData = function->mutableData;
+	if(const BaselineTierInstance* instance
+	   = tierUpState.instances.get(functionMutableData->tierUpState.baselineInstanceId))
+	{
+		queueTierUpRequest(tierUpState,
+						   {instance->module, functionMutableData->tierUpState.functionDefIndex});
+	}
+}
+
+void Runtime::registerBaselineTierCode(
+	ModuleConstRefParam module,
+	const std::shared_ptr<LLVMJIT::Module>& jitModule,
+	const std::vector<FunctionMutableData*>& functionDefMutableDatas,
+	const std::shared_ptr<JITCodeCharge>& jitCodeCharge)
+{
+	WAVM_ASSERT(module->tier == LLVMJIT::CompileTier::baseline);
+
+	TierUpState& tierUpState = TierUpState::get();
+	Platform::Mutex::Lock tierUpLock(tierUpState.mutex);
+	if(tierUpState.instances.size() >= tierUpState.numInstancesAfterLastPrune * 2)
+	{ tierUpState.pruneUnloadedInstances(); }
+
+	// Identify the instance's functions with a new instance ID. The instance's code can't run
+	// until it has been registered, so the IDs are set before requestTierUp can read them.
+	const U64 instanceId = tierUpState.nextInstanceId++;
+	for(FunctionMutableData* functionMutableData : functionDefMutableDatas)
+	{ functionMutableData->tierUpState.baselineInstanceId = instanceId; }
+	tierUpState.instances.addOrFail(
+		instanceId,
+		BaselineTierInstance{
+			module, jitModule, functionDefMutableDatas, jitCodeCharge != nullptr, jitCodeCharge});
+
+	// Load the optimized-tier code that was already compiled for other instances of the module.
+	Platform::Mutex::Lock tierUpObjectCodeLock(module->tierUpObjectCodeMutex);
+	for(Uptr functionDefIndex = 0; functionDefIndex < module->tierUpObjectCode.size();
+		++functionDefIndex)
+	{
+		if(module->tierUpObjectCode[functionDefIndex].size())
+		{ queueTierUpRequest(tierUpState, {module, functionDefIndex}); }
+	}
+}
@@ -1,4 +1,7 @@
 #include <stdint.h>
+#include <algorithm>
+#include <exception>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -12,10 +15,14 @@
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/LEB128.h"
 #include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Time.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Inline/Unicode.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/WorkerPool.h"
 #include "WAVM/WASM/WASM.h"
 
 using namespace WAVM;
@@ -429,6 +436,7 @@ static void serialize(OutputStream& stream, SectionID sectionID)
 struct ModuleSerializationState
 {
 	bool hadDataCountSection = false;
+	WASM::LoadOptions loadOptions;
 };
 
 template<typename Stream>
@@ -897,15 +905,13 @@ static void serializeFunctionBody(OutputStream& sectionStream,
 	serialize(sectionStream, bodyBytes);
 }
 
-static void serializeFunctionBody(InputStream& sectionStream,
-								  Module& module,
-								  FunctionDef& functionDef,
-								  const ModuleSerializationState& moduleState)
+static void decodeFunctionBody(const U8* bodyBytes,
+							   Uptr numBodyBytes,
+							   const Module& module,
+							   FunctionDef& functionDef,
+							   const ModuleSerializationState& moduleState)
 {
-	Uptr numBodyBytes = 0;
-	serializeVarUInt32(sectionStream, numBodyBytes);
-
-	MemoryInputStream bodyStream(sectionStream.advance(numBodyBytes), numBodyBytes);
+	MemoryInputStream bodyStream(bodyBytes, numBodyBytes);
 
 	// Deserialize local sets and unpack them into a linear array of local types.
 	Uptr numLocalSets = 0;
@@ -976,6 +982,225 @@ static void serializeFunctionBody(InputStream& sectionStream,
 	functionDef.code = std::move(irCodeByteStream.getBytes());
 }
 
+static void serializeFunctionBody(InputStream& sectionStream,
+								  Module& module,
+								  FunctionDef& functionDef,
+								  const ModuleSerializationState& moduleState)
+{
+	Uptr numBodyBytes = 0;
+	serializeVarUInt32(sectionStream, numBodyBytes);
+	const U8* bodyBytes = sectionStream.advance(numBodyBytes);
+	decodeFunctionBody(bodyBytes, numBodyBytes, module, functionDef, moduleState);
+}
+
+// The state shared by the jobs that decode function bodies in parallel. Function bodies are queued
+// as soon as their boundaries are found, so decoding doesn't wait for the whole code section.
+struct ParallelDecodeState
+{
+	const Module& module;
+	const ModuleSerializationState& moduleState;
+
+	// The function bodies; sized for all the module's function definitions up front, so the
+	// decode jobs may read the queued bodies while more are queued.
+	std::vector<FunctionDef*> functionDefs;
+	std::vector<std::pair<const U8*, Uptr>> bodies;
+
+	// The exception thrown while decoding each function body, if any. Only written by the job that
+	// decodes the body.
+	std::vector<std::exception_ptr> exceptions;
+
+	// Protects the remaining fields.
+	Platform::Mutex mutex;
+	Uptr numQueuedBodies = 0;
+	Uptr nextBodyIndex = 0;
+	Uptr numDecodedBodies = 0;
+	Uptr numRunningJobs = 0;
+	bool isQueueingFinished = false;
+
+	// Signaled when all the queued function bodies have been decoded after queueing has finished.
+	Platform::Event finishedEvent;
+
+	ParallelDecodeState(const Module& inModule, const ModuleSerializationState& inModuleState)
+	: module(inModule), moduleState(inModuleState)
+	{
+	}
+};
+
+// Decodes queued function bodies until there are none left in the queue.
+static void decodeQueuedFunctionBodies(ParallelDecodeState& state, bool isJob)
+{
+	while(true)
+	{
+		Uptr bodyIndex;
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			if(state.nextBodyIndex == state.numQueuedBodies)
+			{
+				if(isJob) { --state.numRunningJobs; }
+				return;
+			}
+			bodyIndex = state.nextBodyIndex++;
+		}
+
+		try
+		{
+			decodeFunctionBody(state.bodies[bodyIndex].first,
+							   state.bodies[bodyIndex].second,
+							   state.module,
+							   *state.functionDefs[bodyIndex],
+							   state.moduleState);
+		}
+		catch(...)
+		{
+			state.exceptions[bodyIndex] = std::current_exception();
+		}
+
+		Platform::Mutex::Lock lock(state.mutex);
+		++state.numDecodedBodies;
+		if(state.isQueueingFinished && state.numDecodedBodies == state.numQueuedBodies)
+		{ state.finishedEvent.signal(); }
+	}
+}
+
+// Finds the boundaries of the function bodies in the code section, and decodes and validates each
+// body on the worker pool as soon as it is found. If any function body is malformed or invalid,
+// the error for the first one is thrown, so the error is the same as it would be for a sequential
+// load.
+static void decodeFunctionBodiesInParallel(InputStream& sectionStream,
+										   Module& module,
+										   const ModuleSerializationState& moduleState)
+{
+	// The state is shared with the decode jobs, which may not start running until after this
+	// function has returned.
+	std::shared_ptr<ParallelDecodeState> state
+		= std::make_shared<ParallelDecodeState>(module, moduleState);
+	const Uptr numFunctionDefs = module.functions.defs.size();
+	state->functionDefs.resize(numFunctionDefs);
+	state->bodies.resize(numFunctionDefs);
+	state->exceptions.resize(numFunctionDefs);
+
+	// This thread decodes the bodies that remain once it has found all of them, so start at most
+	// numThreads - 1 decode jobs.
+	const Uptr maxJobs = moduleState.loadOptions.numThreads - 1;
+
+	// Find the boundaries of the function bodies. If the section ends before the last function
+	// body, the error is thrown after the bodies that precede the truncated body are decoded.
+	std::exception_ptr boundaryException;
+	try
+	{
+		for(Uptr bodyIndex = 0; bodyIndex < numFunctionDefs; ++bodyIndex)
+		{
+			Uptr numBodyBytes = 0;
+			serializeVarUInt32(sectionStream, numBodyBytes);
+			const U8* bodyBytes = sectionStream.advance(numBodyBytes);
+
+			Platform::Mutex::Lock lock(state->mutex);
+			state->functionDefs[bodyIndex] = &module.functions.defs[bodyIndex];
+			state->bodies[bodyIndex] = {bodyBytes, numBodyBytes};
+			++state->numQueuedBodies;
+			if(state->numRunningJobs < maxJobs
+			   && state->numQueuedBodies - state->nextBodyIndex > state->numRunningJobs)
+			{
+				++state->numRunningJobs;
+				Platform::runAsyncJob([state]() { decodeQueuedFunctionBodies(*state, true); });
+			}
+		}
+	}
+	catch(...)
+	{
+		boundaryException = std::current_exception();
+	}
+
+	// Decode the function bodies that the jobs haven't started, and wait for the jobs to finish
+	// the rest.
+	{
+		Platform::Mutex::Lock lock(state->mutex);
+		state->isQueueingFinished = true;
+	}
+	decodeQueuedFunctionBodies(*state, false);
+	while(true)
+	{
+		{
+			Platform::Mutex::Lock lock(state->mutex);
+			if(state->numDecodedBodies == state->numQueuedBodies) { break; }
+		}
+		state->finishedEvent.wait(Time::infinity());
+	}
+
+	for(Uptr bodyIndex = 0; bodyIndex < state->numQueuedBodies; ++bodyIndex)
+	{
+		if(state->exceptions[bodyIndex]) { std::rethrow_exception(state->exceptions[bodyIndex]); }
+	}
+	if(boundaryException) { std::rethrow_exception(boundaryException); }
+
+	if(moduleState.loadOptions.onFunctionBodyLoaded)
+	{
+		for(Uptr bodyIndex = 0; bodyIndex < numFunctionDefs; ++bodyIndex)
+		{ moduleState.loadOptions.onFunctionBodyLoaded(bodyIndex); }
+	}
+}
+
+// An input stream that reads a fixed number of bytes from another input stream. Unlike the
+// MemoryInputStream that serializeSection uses, it doesn't need all the bytes to be available in
+// the other stream before reading the first of them.
+struct BoundedInputStream : InputStream
+{
+	BoundedInputStream(InputStream& inParent, Uptr inNumBytes)
+	: InputStream(nullptr, nullptr), parent(inParent), numRemainingBytes(inNumBytes)
+	{
+	}
+
+	virtual Uptr capacity() const { return numRemainingBytes - Uptr(next - windowBegin); }
+
+	// Advances the parent stream past the bytes that have been read from this stream.
+	void commit()
+	{
+		const Uptr numReadBytes = Uptr(next - windowBegin);
+		parent.advance(numReadBytes);
+		numRemainingBytes -= numReadBytes;
+		windowBegin = next = end = nullptr;
+	}
+
+private:
+	InputStream& parent;
+	Uptr numRemainingBytes;
+	const U8* windowBegin = nullptr;
+
+	virtual void getMoreData(Uptr numBytes)
+	{
+		commit();
+		if(numBytes > numRemainingBytes)
+		{ throw FatalSerializationException("expected data but found end of stream"); }
+		windowBegin = next = parent.peek(numBytes);
+		end = next + numBytes;
+	}
+};
+
+static void serializeFunctionBodies(InputStream& sectionStream,
+									Module& module,
+									const ModuleSerializationState& moduleState)
+{
+	Uptr numFunctionBodies = module.functions.defs.size();
+	serializeVarUInt32(sectionStream, numFunctionBodies);
+	if(numFunctionBodies != module.functions.defs.size())
+	{
+		throw FatalSerializationException(
+			"function and code sections have mismatched function counts");
+	}
+	if(moduleState.loadOptions.numThreads > 1 && numFunctionBodies > 1)
+	{ decodeFunctionBodiesInParallel(sectionStream, module, moduleState); }
+	else
+	{
+		for(Uptr functionDefIndex = 0; functionDefIndex < numFunctionBodies; ++functionDefIndex)
+		{
+			serializeFunctionBody(
+				sectionStream, module, module.functions.defs[functionDefIndex], moduleState);
+			if(moduleState.loadOptions.onFunctionBodyLoaded)
+			{ moduleState.loadOptions.onFunctionBodyLoaded(functionDefIndex); }
+		}
+	}
+}
+
 template<typename Stream> void serializeTypeSection(Stream& moduleStream, Module& module)
 {
 	serializeSection(moduleStream, SectionID::type, [&module](Stream& sectionStream) {
@@ -1216,18 +1441,27 @@ static void serializeCodeSection(InputStream& moduleStream,
 								 Module& module,
 								 const ModuleSerializationState& moduleState)
 {
-	serializeSection(
-		moduleStream, SectionID::code, [&module, &moduleState](InputStream& sectionStream) {
-			Uptr numFunctionBodies = module.functions.defs.size();
-			serializeVarUInt32(sectionStream, numFunctionBodies);
-			if(numFunctionBodies != module.functions.defs.size())
-			{
-				throw FatalSerializationException(
-					"function and code sections have mismatched function counts");
-			}
-			for(FunctionDef& functionDef : module.functions.defs)
-			{ serializeFunctionBody(sectionStream, module, functionDef, moduleState); }
-		});
+	if(!moduleState.loadOptions.onFunctionBodyLoaded)
+	{
+		serializeSection(
+			moduleStream, SectionID::code, [&module, &moduleState](InputStream& sectionStream) {
+				serializeFunctionBodies(sectionStream, module, moduleState);
+			});
+	}
+	else
+	{
+		// If the caller wants to know when each function body is loaded, read the section
+		// through a BoundedInputStream, so each function body is decoded as soon as its bytes
+		// are available. This means that if the input ends before the end of the code section,
+		// the error is only reported after decoding the function bodies that precede the end.
+		Uptr numSectionBytes = 0;
+		serializeVarUInt32(moduleStream, numSectionBytes);
+		BoundedInputStream sectionStream(moduleStream, numSectionBytes);
+		serializeFunctionBodies(sectionStream, module, moduleState);
+		if(sectionStream.capacity())
+		{ throw FatalSerializationException("section contained more data than expected"); }
+		sectionStream.commit();
+	}
 }
 
 void serializeCodeSection(OutputStream& moduleStream,
@@ -1343,13 +1577,16 @@ static void serializeModule(OutputStream& moduleStream, Module& module)
 	serializeCustomSectionsAfterKnownSection(moduleStream, module, OrderedSectionID::data);
 }
 
-static void serializeModule(InputStream& moduleStream, Module& module)
+static void serializeModule(InputStream& moduleStream,
+							Module& module,
+							const WASM::LoadOptions& options)
 {
 	serializeConstant(moduleStream, "magic number", U32(magicNumber));
 	serializeConstant(moduleStream, "version", U32(currentVersion));
 
 	OrderedSectionID lastKnownOrderedSectionID = OrderedSectionID::moduleBeginning;
 	ModuleSerializationState moduleState;
+	moduleState.loadOptions = options;
 	bool hadFunctionDefinitions = false;
 	bool hadDataSection = false;
 	while(moduleStream.capacity())
@@ -1485,7 +1722,10 @@ void WASM::saveBinaryModule(Serialization::OutputStream& stream, const Module& m
 	}
 }
 
-bool WASM::loadBinaryModule(InputStream& stream, IR::Module& outModule, LoadError* outError)
+bool WASM::loadBinaryModule(InputStream& stream,
+							IR::Module& outModule,
+							LoadError* outError,
+							const WASM::LoadOptions& options)
 {
 	// Load the module from a binary WebAssembly file.
 	try
@@ -1493,7 +1733,7 @@ bool WASM::loadBinaryModule(InputStream& stream, IR::Module& outModule, LoadErro
 		Timing::Timer loadTimer;
 		const Uptr streamNumBytes = stream.capacity();
 
-		serializeModule(stream, outModule);
+		serializeModule(stream, outModule, options);
 
 		Timing::logRatePerSecond("Loaded WASM", loadTimer, streamNumBytes / 1024.0 / 1024.0, "MiB");
 		return true;
@@ -438,6 +438,10 @@ static std::unique_ptr<Command> parseCommand(CursorState* cursor,
 				{
 					expectedType = ExpectedTrapType::invalidArgument;
 				}
+				else if(!strcmp(expectedErrorMessage.c_str(), "out of fuel"))
+				{
+					expectedType = ExpectedTrapType::outOfFuel;
+				}
 				else
 				{
 					parseErrorf(cursor->parseState, errorToken, "unrecognized trap type");
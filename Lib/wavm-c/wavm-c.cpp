@@ -1,10 +1,13 @@
 #include <string.h>
+#include <functional>
 #include <string>
+#include <utility>
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/OptionalStorage.h"
 #include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Time.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Diagnostics.h"
@@ -48,6 +51,7 @@ struct wasm_externtype_t;
 
 struct wasm_module_t;
 typedef struct wasm_module_t wasm_shared_module_t;
+struct wasm_compile_request_t;
 
 #include "WAVM/wavm-c/wavm-c.h"
 
@@ -107,6 +111,16 @@ struct wasm_module_t
 	wasm_module_t(ModuleRef inModule) : module(inModule) {}
 };
 
+struct wasm_compile_request_t
+{
+	CompileRequestRef request;
+};
+
+static_assert(WASM_COMPILE_PRIORITY_HIGH == wasm_compile_priority_t(CompilePriority::high),
+			  "wasm_compile_priority_t should match CompilePriority");
+static_assert(WASM_COMPILE_CANCELLED == wasm_compile_status_t(CompileStatus::cancelled),
+			  "wasm_compile_status_t should match CompileStatus");
+
 static wasm_limits_t as_limits(const SizeConstraints& size)
 {
 	WAVM_ERROR_UNLESS(size.min <= UINT32_MAX);
@@ -679,6 +693,72 @@ bool wasm_module_validate(const char* binary, size_t numBinaryBytes)
 	}
 }
 
+void wasm_compile_request_delete(wasm_compile_request_t* request) { delete request; }
+
+bool wasm_compile_set_num_threads(size_t num_threads)
+{
+	AsyncCompileConfig config;
+	config.numThreads = num_threads;
+	return setAsyncCompileConfig(config);
+}
+
+wasm_compile_request_t* wasm_module_compile_async(wasm_engine_t*,
+												  const char* binary,
+												  size_t num_binary_bytes,
+												  wasm_compile_priority_t priority,
+												  wasm_compile_callback_t callback,
+												  void* env)
+{
+	WAVM_ERROR_UNLESS(priority <= WASM_COMPILE_PRIORITY_HIGH);
+
+	std::function<void(CompileStatus)> onComplete;
+	if(callback)
+	{
+		onComplete = [callback, env](CompileStatus status) {
+			callback(env, wasm_compile_status_t(status));
+		};
+	}
+
+	return new wasm_compile_request_t{loadBinaryModuleAsync((const U8*)binary,
+															num_binary_bytes,
+															IR::FeatureSpec(),
+															CompilePriority(priority),
+															std::move(onComplete))};
+}
+
+wasm_compile_status_t wasm_compile_request_status(const wasm_compile_request_t* request)
+{
+	return wasm_compile_status_t(getCompileStatus(request->request));
+}
+
+wasm_compile_status_t wasm_compile_request_wait(const wasm_compile_request_t* request,
+												int64_t timeout_ns)
+{
+	return wasm_compile_status_t(waitForCompile(
+		request->request, timeout_ns < 0 ? Time::infinity() : Time{I128(timeout_ns)}));
+}
+
+wasm_module_t* wasm_compile_request_module(const wasm_compile_request_t* request)
+{
+	ModuleRef module;
+	WASM::LoadError loadError;
+	switch(getCompileResult(request->request, module, &loadError))
+	{
+	case CompileStatus::succeeded: return new wasm_module_t{module};
+	case CompileStatus::failed:
+		Log::printf(Log::debug, "%s\n", loadError.message.c_str());
+		return nullptr;
+	case CompileStatus::pending:
+	case CompileStatus::cancelled: return nullptr;
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+void wasm_compile_request_cancel(wasm_compile_request_t* request)
+{
+	cancelCompile(request->request);
+}
+
 size_t wasm_module_num_imports(const wasm_module_t* module)
 {
 	return getModuleIR(module->module).imports.size();
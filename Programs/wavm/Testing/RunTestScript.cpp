@@ -1,5 +1,6 @@
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 #include <cstdarg>
 #include <cstdio>
@@ -17,6 +18,7 @@
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
@@ -42,6 +44,7 @@ struct Config
 	bool strictAssertInvalid{false};
 	bool strictAssertMalformed{false};
 	bool testCloning{false};
+	I64 fuel{INT64_MAX};
 };
 
 struct TestScriptState
@@ -64,6 +67,9 @@ struct TestScriptState
 	, compartment(Runtime::createCompartment())
 	, context(Runtime::createContext(compartment))
 	{
+		// The fuel is shared by all the script's commands, and cloning the state clones it.
+		setContextFuel(context, config.fuel);
+
 		moduleNameToInstanceMap.set(
 			"spectest",
 			Intrinsics::instantiateModule(
@@ -214,6 +220,7 @@ static Runtime::ExceptionType* getExpectedTrapType(WAST::ExpectedTrapType expect
 	case WAST::ExpectedTrapType::misalignedAtomicMemoryAccess:
 		return Runtime::ExceptionTypes::misalignedAtomicMemoryAccess;
 	case WAST::ExpectedTrapType::invalidArgument: return Runtime::ExceptionTypes::invalidArgument;
+	case WAST::ExpectedTrapType::outOfFuel: return Runtime::ExceptionTypes::outOfFuel;
 
 	case WAST::ExpectedTrapType::outOfBounds:
 	default: WAVM_UNREACHABLE();
@@ -955,15 +962,29 @@ static void showHelp()
 		"                             module was invalid\n"
 		"  --test-cloning             Run each test command in the original compartment\n"
 		"                             and a clone of it, and compare the resulting state\n"
+		"  --compile-threads=<n>      Compile each module's functions on <n> threads\n"
+		"  --tier=<tier>              Compile modules at a tier:\n"
+		"                             - optimized (default)\n"
+		"                             - baseline: quickly compiled code that recompiles\n"
+		"                               its hot functions with full optimization\n"
+		"  --fuel=<n>                 Compile modules with fuel metering, and run the\n"
+		"                             script's commands with <n> fuel in total\n"
 		"  --trace                    Prints instructions to stdout as they are compiled.\n");
 }
 
+template<Uptr numPrefixChars>
+static bool stringStartsWith(const char* string, const char (&prefix)[numPrefixChars])
+{
+	return !strncmp(string, prefix, numPrefixChars - 1);
+}
+
 int execRunTestScript(int argc, char** argv)
 {
 	// Parse the command-line.
 	Uptr numLoops = 1;
 	std::vector<const char*> filenames;
 	Config config;
+	LLVMJIT::CompileOptions compileOptions;
 	for(int argIndex = 0; argIndex < argc; ++argIndex)
 	{
 		if(!strcmp(argv[argIndex], "--help") || !strcmp(argv[argIndex], "-h"))
@@ -1001,6 +1022,42 @@ int execRunTestScript(int argc, char** argv)
 		{
 			config.testCloning = true;
 		}
+		else if(stringStartsWith(argv[argIndex], "--compile-threads="))
+		{
+			const int numThreads = atoi(argv[argIndex] + strlen("--compile-threads="));
+			if(numThreads <= 0)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			compileOptions.numThreads = Uptr(numThreads);
+		}
+		else if(stringStartsWith(argv[argIndex], "--tier="))
+		{
+			const char* tierName = argv[argIndex] + strlen("--tier=");
+			if(!strcmp(tierName, "optimized"))
+			{ compileOptions.tier = LLVMJIT::CompileTier::optimized; }
+			else if(!strcmp(tierName, "baseline"))
+			{
+				compileOptions.tier = LLVMJIT::CompileTier::baseline;
+			}
+			else
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+		}
+		else if(stringStartsWith(argv[argIndex], "--fuel="))
+		{
+			const long long fuel = strtoll(argv[argIndex] + strlen("--fuel="), nullptr, 10);
+			if(fuel <= 0)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			config.fuel = I64(fuel);
+			compileOptions.meterFuel = true;
+		}
 		else if(!strcmp(argv[argIndex], "--trace"))
 		{
 			Log::setCategoryEnabled(Log::traceValidation, true);
@@ -1018,6 +1075,8 @@ int execRunTestScript(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	Runtime::setGlobalCompileOptions(compileOptions);
+
 	Uptr loopIndex = 0;
 	while(true)
 	{
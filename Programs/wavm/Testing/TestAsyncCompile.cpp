@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// The number of functions in the test module.
+static constexpr Uptr numTestFunctions = 64;
+
+// Returns the binary encoding of a module that exports functions f0..fN, where fI adds I to its
+// argument.
+static std::vector<U8> getTestModuleBytes()
+{
+	std::string wast = "(module\n";
+	for(Uptr functionIndex = 0; functionIndex < numTestFunctions; ++functionIndex)
+	{
+		wast += "  (func (export \"f" + std::to_string(functionIndex)
+				+ "\") (param i32) (result i32)\n"
+				  "    (i32.add (local.get 0) (i32.const "
+				+ std::to_string(functionIndex) + "))\n  )\n";
+	}
+	wast += ")";
+
+	std::vector<WAST::Error> parseErrors;
+	IR::Module irModule;
+	if(!WAST::parseModule(wast.c_str(), wast.size() + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("compile test module", wast.c_str(), parseErrors);
+		Errors::fatal("Failed to parse compile test module WAST");
+	}
+
+	Serialization::ArrayOutputStream stream;
+	WASM::saveBinaryModule(stream, irModule);
+	return stream.getBytes();
+}
+
+// Instantiates a module loaded from getTestModuleBytes, and checks that each of its functions adds
+// the right value to its argument.
+static void runTestModule(ModuleConstRefParam module)
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		ModuleInstance* moduleInstance = instantiateModule(compartment, module, {}, "compileTest");
+		Context* context = createContext(compartment);
+		for(Uptr functionIndex = 0; functionIndex < numTestFunctions; ++functionIndex)
+		{
+			Function* function = asFunction(
+				getInstanceExport(moduleInstance, "f" + std::to_string(functionIndex)));
+
+			UntaggedValue args[1]{I32(100)};
+			UntaggedValue results[1];
+			invokeFunction(context,
+						   function,
+						   FunctionType({ValueType::i32}, {ValueType::i32}),
+						   args,
+						   results);
+			WAVM_ERROR_UNLESS(results[0].i32 == I32(100 + functionIndex));
+		}
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+}
+
+static void testAsyncCompile(const std::vector<U8>& wasmBytes)
+{
+	AsyncCompileConfig config;
+	config.numThreads = 2;
+	WAVM_ERROR_UNLESS(setAsyncCompileConfig(config));
+
+	// Concurrent requests for the same module both succeed.
+	CompileRequestRef request
+		= loadBinaryModuleAsync(wasmBytes.data(), wasmBytes.size(), FeatureSpec());
+	CompileRequestRef highPriorityRequest = loadBinaryModuleAsync(
+		wasmBytes.data(), wasmBytes.size(), FeatureSpec(), CompilePriority::high);
+	WAVM_ERROR_UNLESS(waitForCompile(request) == CompileStatus::succeeded);
+	WAVM_ERROR_UNLESS(waitForCompile(highPriorityRequest) == CompileStatus::succeeded);
+
+	ModuleRef module;
+	WAVM_ERROR_UNLESS(getCompileResult(request, module) == CompileStatus::succeeded);
+	runTestModule(module);
+
+	module = nullptr;
+	WAVM_ERROR_UNLESS(getCompileResult(highPriorityRequest, module) == CompileStatus::succeeded);
+	runTestModule(module);
+
+	// A malformed module fails, and reports the load error.
+	const std::vector<U8> truncatedBytes(wasmBytes.begin(),
+										 wasmBytes.begin() + wasmBytes.size() / 2);
+	CompileRequestRef truncatedRequest
+		= loadBinaryModuleAsync(truncatedBytes.data(), truncatedBytes.size(), FeatureSpec());
+	WAVM_ERROR_UNLESS(waitForCompile(truncatedRequest) == CompileStatus::failed);
+
+	module = nullptr;
+	WASM::LoadError loadError;
+	WAVM_ERROR_UNLESS(getCompileResult(truncatedRequest, module, &loadError)
+					  == CompileStatus::failed);
+	WAVM_ERROR_UNLESS(!module);
+	WAVM_ERROR_UNLESS(loadError.type == WASM::LoadError::Type::malformed);
+}
+
+static void testStreamingCompile(const std::vector<U8>& wasmBytes)
+{
+	// Add the module's bytes in small chunks, so sections and function bodies are split across
+	// chunks.
+	static constexpr Uptr numChunkBytes = 7;
+
+	StreamingModuleLoader* loader = createStreamingModuleLoader();
+	for(Uptr offset = 0; offset < wasmBytes.size(); offset += numChunkBytes)
+	{
+		const Uptr numBytes = std::min(numChunkBytes, wasmBytes.size() - offset);
+		WAVM_ERROR_UNLESS(addStreamingModuleBytes(loader, wasmBytes.data() + offset, numBytes));
+	}
+
+	ModuleRef module;
+	WAVM_ERROR_UNLESS(finishStreamingModuleLoad(loader, module));
+	runTestModule(module);
+
+	// A module that is truncated fails when it is finished.
+	loader = createStreamingModuleLoader();
+	addStreamingModuleBytes(loader, wasmBytes.data(), wasmBytes.size() / 2);
+
+	module = nullptr;
+	WASM::LoadError loadError;
+	WAVM_ERROR_UNLESS(!finishStreamingModuleLoad(loader, module, &loadError));
+	WAVM_ERROR_UNLESS(!module);
+	WAVM_ERROR_UNLESS(loadError.type == WASM::LoadError::Type::malformed);
+}
+
+I32 execAsyncCompileTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test async-compile\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	const std::vector<U8> wasmBytes = getTestModuleBytes();
+	testAsyncCompile(wasmBytes);
+	testStreamingCompile(wasmBytes);
+
+	Timing::logTimer("AsyncCompileTest", timer);
+	return 0;
+}
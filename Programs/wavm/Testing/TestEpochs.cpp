@@ -0,0 +1,186 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char epochTestModuleWAST[]
+	= "(module\n"
+	  "  (func (export \"add\") (param i32 i32) (result i32)\n"
+	  "    (i32.add (local.get 0) (local.get 1))\n"
+	  "  )\n"
+	  "  (func (export \"spin\")\n"
+	  "    (loop $loop (br $loop))\n"
+	  "  )\n"
+	  ")";
+
+struct EpochTestState
+{
+	GCPointer<Compartment> compartment;
+	Function* addFunction = nullptr;
+	Function* spinFunction = nullptr;
+};
+
+// Invokes a function, and returns the type of the runtime exception it threw, or nullptr if it
+// returned normally.
+static Runtime::ExceptionType* invokeAndCatch(Context* context,
+											  Function* function,
+											  FunctionType invokeSig,
+											  const UntaggedValue* args,
+											  UntaggedValue* results)
+{
+	Runtime::ExceptionType* exceptionType = nullptr;
+	catchRuntimeExceptions(
+		[&] { invokeFunction(context, function, invokeSig, args, results); },
+		[&](Exception* exception) {
+			exceptionType = getExceptionType(exception);
+			destroyException(exception);
+		});
+	return exceptionType;
+}
+
+static Runtime::ExceptionType* invokeAdd(const EpochTestState& state, Context* context)
+{
+	UntaggedValue args[2]{I32(1), I32(2)};
+	UntaggedValue results[1];
+	Runtime::ExceptionType* exceptionType = invokeAndCatch(
+		context,
+		state.addFunction,
+		FunctionType({ValueType::i32}, {ValueType::i32, ValueType::i32}),
+		args,
+		results);
+	if(!exceptionType) { WAVM_ERROR_UNLESS(results[0].i32 == 3); }
+	return exceptionType;
+}
+
+static Runtime::ExceptionType* invokeSpin(const EpochTestState& state, Context* context)
+{
+	return invokeAndCatch(context, state.spinFunction, FunctionType(), nullptr, nullptr);
+}
+
+static void testEpochDeadline(const EpochTestState& state)
+{
+	Context* context = createContext(state.compartment);
+
+	// A context isn't interrupted until its deadline is set.
+	WAVM_ERROR_UNLESS(getContextEpochDeadline(context) == UINT64_MAX);
+	WAVM_ERROR_UNLESS(!invokeAdd(state, context));
+
+	// A deadline that has already been reached interrupts the function at its entry.
+	setContextEpochDeadline(context, getCurrentEpoch());
+	WAVM_ERROR_UNLESS(invokeAdd(state, context) == ExceptionTypes::interrupted);
+
+	// A deadline in the future doesn't.
+	setContextEpochDeadline(context, getCurrentEpoch() + 1);
+	WAVM_ERROR_UNLESS(!invokeAdd(state, context));
+
+	// The deadline is copied to clones of the context.
+	setContextEpochDeadline(context, getCurrentEpoch());
+	Context* clonedContext = cloneContext(context, state.compartment);
+	WAVM_ERROR_UNLESS(getContextEpochDeadline(clonedContext) == getCurrentEpoch());
+	WAVM_ERROR_UNLESS(invokeAdd(state, clonedContext) == ExceptionTypes::interrupted);
+
+	// Setting the deadline again stops interrupting the context.
+	setContextEpochDeadline(context, UINT64_MAX);
+	WAVM_ERROR_UNLESS(!invokeAdd(state, context));
+}
+
+static I64 incrementEpochThreadEntry(void*)
+{
+	incrementEpoch();
+	return 0;
+}
+
+static I64 interruptContextThreadEntry(void* context)
+{
+	interruptContext((Context*)context);
+	return 0;
+}
+
+static void testInterruptLoop(const EpochTestState& state)
+{
+	Context* context = createContext(state.compartment);
+
+	// An infinite loop is interrupted at its header once another thread advances the epoch to the
+	// context's deadline.
+	setContextEpochDeadline(context, getCurrentEpoch() + 1);
+	Platform::Thread* thread = Platform::createThread(0, incrementEpochThreadEntry, nullptr);
+	WAVM_ERROR_UNLESS(invokeSpin(state, context) == ExceptionTypes::interrupted);
+	Platform::joinThread(thread);
+
+	// interruptContext interrupts the loop without advancing the epoch, and keeps interrupting
+	// the context until its deadline is set again.
+	setContextEpochDeadline(context, UINT64_MAX);
+	thread = Platform::createThread(0, interruptContextThreadEntry, context);
+	WAVM_ERROR_UNLESS(invokeSpin(state, context) == ExceptionTypes::interrupted);
+	Platform::joinThread(thread);
+	WAVM_ERROR_UNLESS(getContextEpochDeadline(context) == 0);
+	WAVM_ERROR_UNLESS(invokeAdd(state, context) == ExceptionTypes::interrupted);
+}
+
+I32 execEpochTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test epochs\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	std::vector<WAST::Error> parseErrors;
+	IR::Module irModule;
+	if(!WAST::parseModule(
+		   epochTestModuleWAST, strlen(epochTestModuleWAST) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("epoch test module", epochTestModuleWAST, parseErrors);
+		Errors::fatal("Failed to parse epoch test module WAST");
+	}
+
+	// Code compiled without epoch deadline checks is never interrupted.
+	EpochTestState state;
+	state.compartment = createCompartment();
+	ModuleInstance* moduleInstance
+		= instantiateModule(state.compartment, compileModule(irModule), {}, "epochTest");
+	state.addFunction = asFunction(getInstanceExport(moduleInstance, "add"));
+	Context* context = createContext(state.compartment);
+	setContextEpochDeadline(context, getCurrentEpoch());
+	WAVM_ERROR_UNLESS(!invokeAdd(state, context));
+
+	LLVMJIT::CompileOptions compileOptions;
+	compileOptions.checkEpochDeadlines = true;
+	setGlobalCompileOptions(compileOptions);
+	moduleInstance
+		= instantiateModule(state.compartment, compileModule(irModule), {}, "epochTest");
+	setGlobalCompileOptions(LLVMJIT::CompileOptions());
+	state.addFunction = asFunction(getInstanceExport(moduleInstance, "add"));
+	state.spinFunction = asFunction(getInstanceExport(moduleInstance, "spin"));
+
+	testEpochDeadline(state);
+	testInterruptLoop(state);
+
+	context = nullptr;
+
+	state.addFunction = nullptr;
+	state.spinFunction = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(state.compartment)));
+
+	Timing::logTimer("EpochTest", timer);
+	return 0;
+}
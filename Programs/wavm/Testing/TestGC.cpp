@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Enough elements that collections scan the table in parallel chunks.
+static constexpr Uptr numTestTableElements = 300 * 1024;
+
+static void setFlagFinalizer(void* userData) { *(bool*)userData = true; }
+
+// Creates a memory that sets a flag when it is deleted.
+static Memory* createWatchedMemory(Compartment* compartment, bool* wasDeleted)
+{
+	Memory* memory
+		= createMemory(compartment, MemoryType(false, SizeConstraints{0, 1}), "watched memory");
+	WAVM_ERROR_UNLESS(memory);
+	setUserData(memory, wasDeleted, setFlagFinalizer);
+	return memory;
+}
+
+I32 execGCTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test gc\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	GCPointer<Compartment> compartment = createCompartment();
+	Table* table = createTable(
+		compartment,
+		TableType(ReferenceType::anyref,
+				  false,
+				  SizeConstraints{numTestTableElements, numTestTableElements}),
+		nullptr,
+		"gc test table");
+	WAVM_ERROR_UNLESS(table);
+	addGCRoot(table);
+
+	// The first collection scans the new table.
+	GCMetrics metrics = getGCMetrics();
+	collectCompartmentGarbage(compartment);
+	WAVM_ERROR_UNLESS(getGCMetrics().numScannedTables == metrics.numScannedTables + 1);
+
+	// An object written to the table after a collection is kept alive by the next collection,
+	// which rescans the table.
+	bool wasDeleted = false;
+	setTableElement(
+		table, numTestTableElements - 1, asObject(createWatchedMemory(compartment, &wasDeleted)));
+	metrics = getGCMetrics();
+	collectCompartmentGarbage(compartment);
+	WAVM_ERROR_UNLESS(!wasDeleted);
+	WAVM_ERROR_UNLESS(getGCMetrics().numScannedTables == metrics.numScannedTables + 1);
+	WAVM_ERROR_UNLESS(getGCMetrics().numScannedTableElements
+					  == metrics.numScannedTableElements + numTestTableElements);
+
+	// A collection after no writes reuses the references found by the previous scan, and they
+	// still keep the object alive.
+	metrics = getGCMetrics();
+	collectCompartmentGarbage(compartment);
+	WAVM_ERROR_UNLESS(!wasDeleted);
+	WAVM_ERROR_UNLESS(getGCMetrics().numScannedTables == metrics.numScannedTables);
+	WAVM_ERROR_UNLESS(getGCMetrics().numReusedTables == metrics.numReusedTables + 1);
+
+	// Clearing the element lets the next collection delete the object.
+	setTableElement(table, numTestTableElements - 1, nullptr);
+	collectCompartmentGarbage(compartment);
+	WAVM_ERROR_UNLESS(wasDeleted);
+
+	removeGCRoot(table);
+	table = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("GCTest", timer);
+	return 0;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BLAKE2b.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+
+static std::string toHex(const U8* bytes, Uptr numBytes)
+{
+	std::string hex;
+	for(Uptr byteIndex = 0; byteIndex < numBytes; ++byteIndex)
+	{
+		char byteHex[3];
+		snprintf(byteHex, sizeof(byteHex), "%02x", bytes[byteIndex]);
+		hex += byteHex;
+	}
+	return hex;
+}
+
+static std::string toHex(const Hash128& hash)
+{
+	U8 bytes[16];
+	for(Uptr byteIndex = 0; byteIndex < 8; ++byteIndex)
+	{
+		bytes[byteIndex] = U8(hash.low >> (byteIndex * 8));
+		bytes[byteIndex + 8] = U8(hash.high >> (byteIndex * 8));
+	}
+	return toHex(bytes, sizeof(bytes));
+}
+
+static std::vector<U8> getTestBytes(Uptr numBytes)
+{
+	std::vector<U8> bytes(numBytes);
+	for(Uptr byteIndex = 0; byteIndex < numBytes; ++byteIndex)
+	{ bytes[byteIndex] = U8(byteIndex * 7 + 3); }
+	return bytes;
+}
+
+// Hashes bytes with StreamingHash128, adding them in chunks of numChunkBytes.
+static Hash128 getStreamingHash(const std::vector<U8>& bytes, Uptr numChunkBytes)
+{
+	StreamingHash128 streamingHash;
+	for(Uptr offset = 0; offset < bytes.size(); offset += numChunkBytes)
+	{
+		const Uptr numRemainingBytes = bytes.size() - offset;
+		streamingHash.add(bytes.data() + offset,
+						  numRemainingBytes < numChunkBytes ? numRemainingBytes : numChunkBytes);
+	}
+	return streamingHash.getHash();
+}
+
+I32 execHashTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test hash\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	// The BLAKE2b-512 test vector from RFC 7693.
+	BLAKE2b blake2b;
+	blake2b.add("abc", 3);
+	U8 digest[BLAKE2b::maxDigestBytes];
+	blake2b.getDigest(digest);
+	WAVM_ERROR_UNLESS(toHex(digest, sizeof(digest))
+					  == "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+						 "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923");
+
+	// StreamingHash128 is BLAKE2b with a 128-bit digest. Check it for lengths around the 128-byte
+	// block size, and with the bytes added in various chunk sizes.
+	struct TestVector
+	{
+		Uptr numBytes;
+		const char* hashHex;
+	};
+	static const TestVector testVectors[] = {
+		{0, "cae66941d9efbd404e4d88758ea67670"},
+		{3, "09e03a807474593d5cb98909e5d502cd"},
+		{127, "e00ab0ead4d729de8fbe7745d642e416"},
+		{128, "8e0cf9bb1b36fa6c42aa6490f719b575"},
+		{129, "6cefde50e4008690e61cf8225d101256"},
+		{1000, "add263669b4eb2158678a360fa6f007a"},
+	};
+	for(const TestVector& testVector : testVectors)
+	{
+		const std::vector<U8> bytes = getTestBytes(testVector.numBytes);
+		for(Uptr numChunkBytes : {Uptr(1), Uptr(13), Uptr(128), Uptr(1000)})
+		{ WAVM_ERROR_UNLESS(toHex(getStreamingHash(bytes, numChunkBytes)) == testVector.hashHex); }
+	}
+
+	// A copy of the state hashes the bytes added to it after the bytes it shares with the
+	// original.
+	const std::vector<U8> bytes = getTestBytes(1000);
+	StreamingHash128 prefixHash;
+	prefixHash.add(bytes.data(), 129);
+	StreamingHash128 copiedHash = prefixHash;
+	copiedHash.add(bytes.data() + 129, bytes.size() - 129);
+	WAVM_ERROR_UNLESS(toHex(copiedHash.getHash()) == "add263669b4eb2158678a360fa6f007a");
+	WAVM_ERROR_UNLESS(toHex(prefixHash.getHash()) == "6cefde50e4008690e61cf8225d101256");
+
+	Timing::logTimer("HashTest", timer);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <string.h>
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static constexpr Uptr numTestMemoryPages = 16;
+static constexpr Uptr numTestMemoryBytes = numTestMemoryPages * IR::numBytesPerPage;
+
+static U8 getPatternByte(Uptr address) { return U8(address * 7 + address / IR::numBytesPerPage); }
+
+static void checkPattern(Memory* memory)
+{
+	const U8* baseAddress = getMemoryBaseAddress(memory);
+	for(Uptr address = 0; address < numTestMemoryBytes; ++address)
+	{ WAVM_ERROR_UNLESS(baseAddress[address] == getPatternByte(address)); }
+}
+
+static U64 getNumMemorySnapshots() { return getMemoryPoolMetrics().numSnapshots; }
+
+I32 execMemorySnapshotTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test snapshots\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	GCPointer<Compartment> templateCompartment = createCompartment();
+	Memory* templateMemory = createMemory(
+		templateCompartment,
+		MemoryType(false, SizeConstraints{numTestMemoryPages, numTestMemoryPages}),
+		"template memory");
+	WAVM_ERROR_UNLESS(templateMemory);
+
+	U8* templateBase = getMemoryBaseAddress(templateMemory);
+	for(Uptr address = 0; address < numTestMemoryBytes; ++address)
+	{ templateBase[address] = getPatternByte(address); }
+
+	// Snapshotting a memory doesn't change its contents. If the platform doesn't support
+	// copy-on-write snapshots, clones copy the memory, so only check the clones' contents.
+	const bool hasSnapshot = snapshotMemory(templateMemory);
+	checkPattern(templateMemory);
+
+	// Snapshotting an unmodified snapshot mapping doesn't copy the memory again.
+	const U64 numSnapshotsBeforeClones = getNumMemorySnapshots();
+	WAVM_ERROR_UNLESS(snapshotMemory(templateMemory) == hasSnapshot);
+	if(hasSnapshot) { WAVM_ERROR_UNLESS(getNumMemorySnapshots() == numSnapshotsBeforeClones); }
+
+	// Cloning the template maps every clone from its snapshot, without copying the memory.
+	GCPointer<Compartment> cloneA = cloneCompartment(templateCompartment);
+	GCPointer<Compartment> cloneB = cloneCompartment(templateCompartment);
+	if(hasSnapshot) { WAVM_ERROR_UNLESS(getNumMemorySnapshots() == numSnapshotsBeforeClones); }
+
+	Memory* memoryA = remapToClonedCompartment(templateMemory, cloneA);
+	Memory* memoryB = remapToClonedCompartment(templateMemory, cloneB);
+	checkPattern(memoryA);
+	checkPattern(memoryB);
+
+	// Writes to a clone aren't visible to the template or the other clone.
+	U8* baseA = getMemoryBaseAddress(memoryA);
+	baseA[0] = ~getPatternByte(0);
+	baseA[numTestMemoryBytes - 1] = ~getPatternByte(numTestMemoryBytes - 1);
+	checkPattern(templateMemory);
+	checkPattern(memoryB);
+
+	// Writes to the template aren't visible to the clones, and the next clone of the modified
+	// template gets the template's new contents.
+	templateBase[IR::numBytesPerPage] = ~getPatternByte(IR::numBytesPerPage);
+	checkPattern(memoryB);
+	WAVM_ERROR_UNLESS(baseA[IR::numBytesPerPage] == getPatternByte(IR::numBytesPerPage));
+
+	GCPointer<Compartment> cloneC = cloneCompartment(templateCompartment);
+	Memory* memoryC = remapToClonedCompartment(templateMemory, cloneC);
+	WAVM_ERROR_UNLESS(getMemoryBaseAddress(memoryC)[IR::numBytesPerPage]
+					  == U8(~getPatternByte(IR::numBytesPerPage)));
+	if(hasSnapshot) { WAVM_ERROR_UNLESS(getNumMemorySnapshots() == numSnapshotsBeforeClones + 1); }
+	checkPattern(memoryB);
+
+	templateMemory = nullptr;
+	memoryA = memoryB = memoryC = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(cloneA)));
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(cloneB)));
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(cloneC)));
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(templateCompartment)));
+
+	Timing::logTimer("MemorySnapshotTest", timer);
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/ObjectCache/ObjectCache.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/VFS/VFS.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Counts the lookups in an object cache, and the lookups that missed and had to compile the object
+// code.
+struct CountingObjectCache : ObjectCacheInterface
+{
+	std::atomic<Uptr> numLookups{0};
+	std::atomic<Uptr> numMisses{0};
+
+	CountingObjectCache(std::shared_ptr<ObjectCacheInterface>&& inInnerCache)
+	: innerCache(std::move(inInnerCache))
+	{
+	}
+
+	virtual ObjectCodeView getCachedObject(const Hash128& key,
+										   std::function<std::vector<U8>()>&& compileThunk) override
+	{
+		++numLookups;
+		return innerCache->getCachedObject(key, [this, &compileThunk]() {
+			++numMisses;
+			return compileThunk();
+		});
+	}
+
+private:
+	std::shared_ptr<ObjectCacheInterface> innerCache;
+};
+
+static IR::Module parseAddModule(I32 addend)
+{
+	const std::string wast = "(module\n"
+							 "  (func (export \"add\") (param i32) (result i32)\n"
+							 "    (i32.add (local.get 0) (i32.const "
+							 + std::to_string(addend)
+							 + "))\n"
+							   "  )\n"
+							   ")";
+
+	std::vector<WAST::Error> parseErrors;
+	IR::Module irModule;
+	if(!WAST::parseModule(wast.c_str(), wast.size() + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("object cache test module", wast.c_str(), parseErrors);
+		Errors::fatal("Failed to parse object cache test module WAST");
+	}
+	return irModule;
+}
+
+// Compiles a module created by parseAddModule, and checks that the compiled code adds addend to
+// its argument.
+static void compileAndRunAddModule(const IR::Module& irModule, I32 addend)
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		ModuleInstance* moduleInstance
+			= instantiateModule(compartment, compileModule(irModule), {}, "objectCacheTest");
+		Function* function = asFunction(getInstanceExport(moduleInstance, "add"));
+
+		UntaggedValue args[1]{I32(100)};
+		UntaggedValue results[1];
+		invokeFunction(createContext(compartment),
+					   function,
+					   FunctionType({ValueType::i32}, {ValueType::i32}),
+					   args,
+					   results);
+		WAVM_ERROR_UNLESS(results[0].i32 == 100 + addend);
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+}
+
+// Opens the object cache database in a directory, and sets it as the global object cache.
+static std::shared_ptr<CountingObjectCache> openObjectCache(const std::string& path, U64 codeKey)
+{
+	std::shared_ptr<ObjectCacheInterface> objectCache;
+	WAVM_ERROR_UNLESS(ObjectCache::open(path.c_str(), 64 * 1024 * 1024, codeKey, objectCache)
+					  == ObjectCache::OpenResult::success);
+
+	std::shared_ptr<CountingObjectCache> countingCache
+		= std::make_shared<CountingObjectCache>(std::move(objectCache));
+	setGlobalObjectCache(std::shared_ptr<ObjectCacheInterface>(countingCache));
+	return countingCache;
+}
+
+static void closeObjectCache(std::shared_ptr<CountingObjectCache>& countingCache)
+{
+	setGlobalObjectCache(nullptr);
+	countingCache.reset();
+}
+
+static void testCacheHits(const std::string& path)
+{
+	std::shared_ptr<CountingObjectCache> cache = openObjectCache(path, 1);
+	const IR::Module add1Module = parseAddModule(1);
+	const IR::Module add2Module = parseAddModule(2);
+
+	// The first compile of a module misses, and the second is loaded from the cache.
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numLookups > 0);
+	WAVM_ERROR_UNLESS(cache->numMisses == cache->numLookups);
+
+	const Uptr numFirstCompileLookups = cache->numLookups;
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numLookups == 2 * numFirstCompileLookups);
+	WAVM_ERROR_UNLESS(cache->numMisses == numFirstCompileLookups);
+
+	// Changing the module's code misses.
+	Uptr numMisses = cache->numMisses;
+	compileAndRunAddModule(add2Module, 2);
+	WAVM_ERROR_UNLESS(cache->numMisses > numMisses);
+
+	// Changing the compile options that affect the object code misses.
+	LLVMJIT::CompileOptions compileOptions;
+	compileOptions.meterFuel = true;
+	setGlobalCompileOptions(compileOptions);
+	numMisses = cache->numMisses;
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numMisses > numMisses);
+
+	numMisses = cache->numMisses;
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numMisses == numMisses);
+
+	compileOptions.checkEpochDeadlines = true;
+	setGlobalCompileOptions(compileOptions);
+	numMisses = cache->numMisses;
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numMisses > numMisses);
+	setGlobalCompileOptions(LLVMJIT::CompileOptions());
+
+	closeObjectCache(cache);
+}
+
+static void testCodeKey(const std::string& path)
+{
+	const IR::Module add1Module = parseAddModule(1);
+
+	// Reopening the database with the same code key hits the object code cached by testCacheHits.
+	std::shared_ptr<CountingObjectCache> cache = openObjectCache(path, 1);
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numLookups > 0);
+	WAVM_ERROR_UNLESS(cache->numMisses == 0);
+	closeObjectCache(cache);
+
+	// Reopening it with a different code key, e.g. for a different version of WAVM, misses.
+	cache = openObjectCache(path, 2);
+	compileAndRunAddModule(add1Module, 1);
+	WAVM_ERROR_UNLESS(cache->numLookups > 0);
+	WAVM_ERROR_UNLESS(cache->numMisses == cache->numLookups);
+	closeObjectCache(cache);
+}
+
+I32 execObjectCacheTest(int argc, char** argv)
+{
+	if(argc != 1)
+	{
+		Log::printf(Log::error, "Usage: wavm test object-cache <directory>\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	// Start with an empty database in the directory.
+	const std::string path = argv[0];
+	VFS::FileSystem& hostFS = Platform::getHostFS();
+	hostFS.createDir(path);
+	hostFS.unlinkFile(path + "/data.mdb");
+	hostFS.unlinkFile(path + "/lock.mdb");
+
+	testCacheHits(path);
+	testCodeKey(path);
+
+	Timing::logTimer("ObjectCacheTest", timer);
+	return 0;
+}
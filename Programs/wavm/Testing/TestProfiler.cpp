@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char profilerTestModuleWAST[]
+	= "(module\n"
+	  "  (func $spin (export \"spin\") (param $n i32)\n"
+	  "    (loop $loop\n"
+	  "      (br_if $loop (local.tee $n (i32.sub (local.get $n) (i32.const 1))))\n"
+	  "    )\n"
+	  "  )\n"
+	  ")";
+
+// The debug name the runtime gives the spin function in the module instance created by
+// instantiateTestModule.
+static const char spinFunctionDebugName[] = "wasm!profilerTest!spin";
+
+struct ProfilerTestInstance
+{
+	GCPointer<Compartment> compartment;
+	Context* context = nullptr;
+	Function* spinFunction = nullptr;
+
+	~ProfilerTestInstance()
+	{
+		context = nullptr;
+		spinFunction = nullptr;
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	}
+};
+
+static void instantiateTestModule(ProfilerTestInstance& instance)
+{
+	std::vector<WAST::Error> parseErrors;
+	IR::Module irModule;
+	if(!WAST::parseModule(
+		   profilerTestModuleWAST, strlen(profilerTestModuleWAST) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("profiler test module", profilerTestModuleWAST, parseErrors);
+		Errors::fatal("Failed to parse profiler test module WAST");
+	}
+
+	instance.compartment = createCompartment();
+	ModuleInstance* moduleInstance
+		= instantiateModule(instance.compartment, compileModule(irModule), {}, "profilerTest");
+	instance.context = createContext(instance.compartment);
+	instance.spinFunction = asFunction(getInstanceExport(moduleInstance, "spin"));
+}
+
+static void spin(const ProfilerTestInstance& instance, I32 numIterations)
+{
+	UntaggedValue args[1]{numIterations};
+	invokeFunction(
+		instance.context, instance.spinFunction, FunctionType({}, {ValueType::i32}), args);
+}
+
+static void testProfiler()
+{
+	ProfilerTestInstance instance;
+	instantiateTestModule(instance);
+
+	if(!startProfiling(1000))
+	{
+		Log::printf(Log::output, "Sampling isn't supported: skipping the profiler test.\n");
+		return;
+	}
+	WAVM_ERROR_UNLESS(!startProfiling(1000));
+
+	// Spend enough CPU time in the spin function to take a few hundred samples of it.
+	Timing::Timer timer;
+	while(timer.getMilliseconds() < 500.0) { spin(instance, 1000000); }
+	stopProfiling();
+
+	// All the samples should be attributed to the spin function.
+	WAVM_ERROR_UNLESS(getProfileNumSamples() > 0);
+	const std::vector<ProfiledFunction> profiledFunctions = getProfiledFunctions();
+	WAVM_ERROR_UNLESS(profiledFunctions.size() > 0);
+	const ProfiledFunction& spinProfile = profiledFunctions[0];
+	WAVM_ERROR_UNLESS(spinProfile.debugName == spinFunctionDebugName);
+	WAVM_ERROR_UNLESS(spinProfile.numSelfSamples > 0);
+	WAVM_ERROR_UNLESS(spinProfile.numTotalSamples >= spinProfile.numSelfSamples);
+	WAVM_ERROR_UNLESS(spinProfile.opIndexSamples.size() > 0);
+	WAVM_ERROR_UNLESS(getProfileCollapsedStacks().find(spinFunctionDebugName)
+					  != std::string::npos);
+
+	// Resetting the profile discards the samples.
+	resetProfile();
+	WAVM_ERROR_UNLESS(getProfileNumSamples() == 0);
+	WAVM_ERROR_UNLESS(getProfiledFunctions().empty());
+	WAVM_ERROR_UNLESS(getProfileCollapsedStacks().empty());
+}
+
+#if defined(__linux__)
+static std::string readFile(const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	WAVM_ERROR_UNLESS(file);
+
+	std::string contents;
+	char buffer[4096];
+	Uptr numBytesRead;
+	while((numBytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{ contents.append(buffer, numBytesRead); }
+	fclose(file);
+	return contents;
+}
+#endif
+
+static void testPerfMaps()
+{
+#if defined(__linux__)
+	const std::string perfMapPath = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+	const std::string jitdumpPath = "/tmp/jit-" + std::to_string(getpid()) + ".dump";
+
+	if(!LLVMJIT::enablePerfMap(LLVMJIT::PerfMapFormat::perfMap))
+	{
+		Log::printf(Log::output,
+					"Couldn't create %s: skipping the perf map test.\n",
+					perfMapPath.c_str());
+		return;
+	}
+	const bool isJITDumpEnabled = LLVMJIT::enablePerfMap(LLVMJIT::PerfMapFormat::jitdump);
+
+	// Functions in modules instantiated after the perf maps are enabled are added to them.
+	{
+		ProfilerTestInstance instance;
+		instantiateTestModule(instance);
+		spin(instance, 1);
+	}
+
+	// The perf map has a line for each function: its address and size in hex, and its name.
+	const std::string perfMap = readFile(perfMapPath);
+	WAVM_ERROR_UNLESS(perfMap.find(std::string(" ") + spinFunctionDebugName + "\n")
+					  != std::string::npos);
+	unlink(perfMapPath.c_str());
+
+	// The jitdump file starts with the magic number, and has a code load record with each
+	// function's name.
+	if(isJITDumpEnabled)
+	{
+		const std::string jitdump = readFile(jitdumpPath);
+		WAVM_ERROR_UNLESS(jitdump.size() >= sizeof(U32));
+		U32 magic;
+		memcpy(&magic, jitdump.data(), sizeof(U32));
+		WAVM_ERROR_UNLESS(magic == 0x4A695444);
+		WAVM_ERROR_UNLESS(jitdump.find(std::string(spinFunctionDebugName) + '\0')
+						  != std::string::npos);
+		unlink(jitdumpPath.c_str());
+	}
+#else
+	// Perf maps are only supported on Linux.
+	WAVM_ERROR_UNLESS(!LLVMJIT::enablePerfMap(LLVMJIT::PerfMapFormat::perfMap));
+	WAVM_ERROR_UNLESS(!LLVMJIT::enablePerfMap(LLVMJIT::PerfMapFormat::jitdump));
+#endif
+}
+
+I32 execProfilerTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test profiler\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+	testProfiler();
+	testPerfMaps();
+	Timing::logTimer("ProfilerTest", timer);
+	return 0;
+}
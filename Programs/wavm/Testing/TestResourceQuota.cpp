@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char quotaTestModuleWAST[] = "(module\n"
+										  "  (memory 1)\n"
+										  "  (table 10 funcref)\n"
+										  "  (func (export \"f\") (result i32) (i32.const 1))\n"
+										  ")";
+
+// Checks that nothing is charged to a quota.
+static void checkQuotaIsUnused(ResourceQuotaConstRefParam resourceQuota)
+{
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 0);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) == 0);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentModuleInstances(resourceQuota) == 0);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentContexts(resourceQuota) == 0);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentJITCodeBytes(resourceQuota) == 0);
+}
+
+// Instantiates a module, and returns the type of the runtime exception it threw, or nullptr if it
+// succeeded.
+static Runtime::ExceptionType* tryInstantiate(Compartment* compartment,
+											  ModuleConstRefParam module,
+											  ResourceQuotaRefParam resourceQuota)
+{
+	Runtime::ExceptionType* exceptionType = nullptr;
+	catchRuntimeExceptions(
+		[&] { instantiateModule(compartment, module, {}, "quotaTest", resourceQuota); },
+		[&](Exception* exception) {
+			exceptionType = getExceptionType(exception);
+			destroyException(exception);
+		});
+	return exceptionType;
+}
+
+static void testContextQuota()
+{
+	ResourceQuotaRef resourceQuota = createResourceQuota();
+	setResourceQuotaMaxContexts(resourceQuota, 2);
+
+	GCPointer<Compartment> compartment = createCompartment();
+	WAVM_ERROR_UNLESS(createContext(compartment, resourceQuota));
+	WAVM_ERROR_UNLESS(createContext(compartment, resourceQuota));
+	WAVM_ERROR_UNLESS(!createContext(compartment, resourceQuota));
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentContexts(resourceQuota) == 2);
+
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	checkQuotaIsUnused(resourceQuota);
+}
+
+static void testMemoryQuota()
+{
+	ResourceQuotaRef resourceQuota = createResourceQuota();
+	setResourceQuotaMaxMemoryPages(resourceQuota, 4);
+
+	GCPointer<Compartment> compartment = createCompartment();
+	Memory* memory = createMemory(
+		compartment, MemoryType(false, SizeConstraints{2, 16}), "quotaTest", resourceQuota);
+	WAVM_ERROR_UNLESS(memory);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 2);
+
+	// Growing the memory up to the quota succeeds, and growing it past the quota fails without
+	// changing its size or the quota's usage.
+	WAVM_ERROR_UNLESS(growMemory(memory, 2));
+	WAVM_ERROR_UNLESS(!growMemory(memory, 1));
+	WAVM_ERROR_UNLESS(getMemoryNumPages(memory) == 4);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 4);
+
+	// Creating a memory that would exceed the quota fails.
+	WAVM_ERROR_UNLESS(!createMemory(
+		compartment, MemoryType(false, SizeConstraints{1, 16}), "quotaTest", resourceQuota));
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 4);
+
+	// Growing a memory past its own maximum size releases the pages it charged to the quota.
+	setResourceQuotaMaxMemoryPages(resourceQuota, 64);
+	WAVM_ERROR_UNLESS(!growMemory(memory, 13));
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 4);
+
+	memory = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	checkQuotaIsUnused(resourceQuota);
+}
+
+struct ConcurrentGrowState
+{
+	Memory* memory;
+	std::atomic<Uptr> numGrownPages{0};
+};
+
+static constexpr Uptr numConcurrentGrowThreads = 8;
+static constexpr Uptr numGrowsPerThread = 16;
+static constexpr Uptr maxConcurrentGrowPages = 64;
+
+static I64 concurrentGrowThreadEntry(void* stateVoid)
+{
+	ConcurrentGrowState* state = (ConcurrentGrowState*)stateVoid;
+	for(Uptr growIndex = 0; growIndex < numGrowsPerThread; ++growIndex)
+	{
+		if(growMemory(state->memory, 1)) { ++state->numGrownPages; }
+	}
+	return 0;
+}
+
+static void testConcurrentMemoryGrows()
+{
+	ResourceQuotaRef resourceQuota = createResourceQuota();
+	setResourceQuotaMaxMemoryPages(resourceQuota, maxConcurrentGrowPages);
+
+	// Grow a memory from several threads at once, trying to grow it by more pages in total than
+	// the quota allows. Exactly the quota's maximum number of pages should be grown.
+	GCPointer<Compartment> compartment = createCompartment();
+	ConcurrentGrowState state;
+	state.memory = createMemory(compartment,
+								MemoryType(false, SizeConstraints{0, 1024}),
+								"quotaTest",
+								resourceQuota);
+	WAVM_ERROR_UNLESS(state.memory);
+
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 0; threadIndex < numConcurrentGrowThreads; ++threadIndex)
+	{ threads.push_back(Platform::createThread(0, concurrentGrowThreadEntry, &state)); }
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+	WAVM_ERROR_UNLESS(state.numGrownPages == maxConcurrentGrowPages);
+	WAVM_ERROR_UNLESS(getMemoryNumPages(state.memory) == maxConcurrentGrowPages);
+	WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == maxConcurrentGrowPages);
+
+	state.memory = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	checkQuotaIsUnused(resourceQuota);
+}
+
+static void testInstanceQuota(ModuleConstRefParam module)
+{
+	// Instantiating more module instances than the quota allows fails.
+	{
+		ResourceQuotaRef resourceQuota = createResourceQuota();
+		setResourceQuotaMaxModuleInstances(resourceQuota, 1);
+
+		GCPointer<Compartment> compartment = createCompartment();
+		WAVM_ERROR_UNLESS(!tryInstantiate(compartment, module, resourceQuota));
+		WAVM_ERROR_UNLESS(tryInstantiate(compartment, module, resourceQuota)
+						  == ExceptionTypes::outOfMemory);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentModuleInstances(resourceQuota) == 1);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 1);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) == 10);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentJITCodeBytes(resourceQuota) > 0);
+
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+		checkQuotaIsUnused(resourceQuota);
+	}
+
+	// An instantiation that fails because its memory exceeds the quota releases the module
+	// instance it charged.
+	{
+		ResourceQuotaRef resourceQuota = createResourceQuota();
+		setResourceQuotaMaxMemoryPages(resourceQuota, 0);
+
+		GCPointer<Compartment> compartment = createCompartment();
+		WAVM_ERROR_UNLESS(tryInstantiate(compartment, module, resourceQuota)
+						  == ExceptionTypes::outOfMemory);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentModuleInstances(resourceQuota) == 0);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentMemoryPages(resourceQuota) == 0);
+
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+		checkQuotaIsUnused(resourceQuota);
+	}
+
+	// An instantiation that fails because its code exceeds the quota releases the module instance
+	// and the code it charged.
+	{
+		ResourceQuotaRef resourceQuota = createResourceQuota();
+		setResourceQuotaMaxJITCodeBytes(resourceQuota, 1);
+
+		GCPointer<Compartment> compartment = createCompartment();
+		WAVM_ERROR_UNLESS(tryInstantiate(compartment, module, resourceQuota)
+						  == ExceptionTypes::outOfMemory);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentModuleInstances(resourceQuota) == 0);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentJITCodeBytes(resourceQuota) == 0);
+
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+		checkQuotaIsUnused(resourceQuota);
+	}
+}
+
+I32 execResourceQuotaTest(int argc, char** argv)
+{
+	if(argc != 0)
+	{
+		Log::printf(Log::error, "Usage: wavm test quotas\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	std::vector<WAST::Error> parseErrors;
+	IR::Module irModule;
+	if(!WAST::parseModule(
+		   quotaTestModuleWAST, strlen(quotaTestModuleWAST) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("resource quota test module", quotaTestModuleWAST, parseErrors);
+		Errors::fatal("Failed to parse resource quota test module WAST");
+	}
+	ModuleRef module = compileModule(irModule);
+
+	testContextQuota();
+	testMemoryQuota();
+	testConcurrentMemoryGrows();
+	testInstanceQuota(module);
+
+	Timing::logTimer("ResourceQuotaTest", timer);
+	return 0;
+}
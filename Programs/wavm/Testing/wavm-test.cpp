@@ -10,14 +10,22 @@ enum class Command
 	invalid,
 
 	dumpModules,
+	hash,
 	hashMap,
 	hashSet,
 	i128,
 
 #if WAVM_ENABLE_RUNTIME
 	cAPI,
+	asyncCompile,
 	benchmark,
+	epochs,
+	gc,
+	objectCache,
+	profiler,
+	resourceQuota,
 	script,
+	memorySnapshot,
 #endif
 };
 
@@ -28,12 +36,20 @@ static const char* getCommandListHelpText()
 		   "  c-api         Test the C API\n"
 #endif
 		   "  dumpmodules   Dump WAST/WASM modules from WAST test scripts\n"
+		   "  hash          Test hash functions\n"
 		   "  hashmap       Test HashMap\n"
 		   "  hashset       Test HashSet\n"
 		   "  i128          Test I128\n"
 #if WAVM_ENABLE_RUNTIME
+		   "  async-compile Test asynchronous and streaming compilation\n"
 		   "  benchmark     Benchmark WAVM\n"
+		   "  epochs        Test interrupting code with epoch deadlines\n"
+		   "  gc            Test garbage collection\n"
+		   "  object-cache  Test the object cache\n"
+		   "  profiler      Test the sampling profiler and perf maps\n"
+		   "  quotas        Test resource quotas\n"
 		   "  script        Run WAST test scripts\n"
+		   "  snapshots     Test cloning memories from copy-on-write snapshots\n"
 #endif
 		;
 }
@@ -50,6 +66,10 @@ void showTestHelp(Log::Category outputCategory)
 static Command parseCommand(const char* string)
 {
 	if(!strcmp(string, "dumpmodules")) { return Command::dumpModules; }
+	else if(!strcmp(string, "hash"))
+	{
+		return Command::hash;
+	}
 	else if(!strcmp(string, "hashmap"))
 	{
 		return Command::hashMap;
@@ -67,14 +87,42 @@ static Command parseCommand(const char* string)
 	{
 		return Command::cAPI;
 	}
+	else if(!strcmp(string, "async-compile"))
+	{
+		return Command::asyncCompile;
+	}
 	else if(!strcmp(string, "benchmark"))
 	{
 		return Command::benchmark;
 	}
+	else if(!strcmp(string, "epochs"))
+	{
+		return Command::epochs;
+	}
+	else if(!strcmp(string, "gc"))
+	{
+		return Command::gc;
+	}
+	else if(!strcmp(string, "object-cache"))
+	{
+		return Command::objectCache;
+	}
+	else if(!strcmp(string, "profiler"))
+	{
+		return Command::profiler;
+	}
+	else if(!strcmp(string, "quotas"))
+	{
+		return Command::resourceQuota;
+	}
 	else if(!strcmp(string, "script"))
 	{
 		return Command::script;
 	}
+	else if(!strcmp(string, "snapshots"))
+	{
+		return Command::memorySnapshot;
+	}
 #endif
 	else
 	{
@@ -95,13 +143,21 @@ int execTestCommand(int argc, char** argv)
 		switch(command)
 		{
 		case Command::dumpModules: return execDumpTestModules(argc - 1, argv + 1);
+		case Command::hash: return execHashTest(argc - 1, argv + 1);
 		case Command::hashMap: return execHashMapTest(argc - 1, argv + 1);
 		case Command::hashSet: return execHashSetTest(argc - 1, argv + 1);
 		case Command::i128: return execI128Test(argc - 1, argv + 1);
 #if WAVM_ENABLE_RUNTIME
 		case Command::cAPI: return execCAPITest(argc - 1, argv + 1);
+		case Command::asyncCompile: return execAsyncCompileTest(argc - 1, argv + 1);
 		case Command::benchmark: return execBenchmark(argc - 1, argv + 1);
+		case Command::epochs: return execEpochTest(argc - 1, argv + 1);
+		case Command::gc: return execGCTest(argc - 1, argv + 1);
+		case Command::objectCache: return execObjectCacheTest(argc - 1, argv + 1);
+		case Command::profiler: return execProfilerTest(argc - 1, argv + 1);
+		case Command::resourceQuota: return execResourceQuotaTest(argc - 1, argv + 1);
 		case Command::script: return execRunTestScript(argc - 1, argv + 1);
+		case Command::memorySnapshot: return execMemorySnapshotTest(argc - 1, argv + 1);
 #endif
 
 		case Command::invalid:
@@ -3,12 +3,20 @@
 #include "WAVM/Inline/Config.h"
 
 int execDumpTestModules(int argc, char** argv);
+int execHashTest(int argc, char** argv);
 int execHashMapTest(int argc, char** argv);
 int execHashSetTest(int argc, char** argv);
 int execI128Test(int argc, char** argv);
 
 #if WAVM_ENABLE_RUNTIME
+int execAsyncCompileTest(int argc, char** argv);
 int execBenchmark(int argc, char** argv);
+int execEpochTest(int argc, char** argv);
+int execGCTest(int argc, char** argv);
+int execMemorySnapshotTest(int argc, char** argv);
+int execObjectCacheTest(int argc, char** argv);
+int execProfilerTest(int argc, char** argv);
+int execResourceQuotaTest(int argc, char** argv);
 int execRunTestScript(int argc, char** argv);
 
 #ifdef __cplusplus
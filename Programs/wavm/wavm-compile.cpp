@@ -77,6 +77,8 @@ void showCompileHelp(Log::Category outputCategory)
 				"                            supported features below.\n"
 				"  --format=<format>         Specifies the format of the output file. See the\n"
 				"                            list of supported output formats below.\n"
+				"  --compile-threads=<n>     Compile the module's functions on <n> threads\n"
+				"                            (default: 1). Ignored for the object format.\n"
 				"\n"
 				"Output formats:\n"
 				"%s"
@@ -112,6 +114,7 @@ int execCompileCommand(int argc, char** argv)
 	LLVMJIT::TargetSpec targetSpec = LLVMJIT::getHostTargetSpec();
 	IR::FeatureSpec featureSpec;
 	OutputFormat outputFormat = OutputFormat::unspecified;
+	LLVMJIT::CompileOptions compileOptions;
 	for(int argIndex = 0; argIndex < argc; ++argIndex)
 	{
 		if(!strcmp(argv[argIndex], "--target-triple"))
@@ -183,6 +186,19 @@ int execCompileCommand(int argc, char** argv)
 				return EXIT_FAILURE;
 			}
 		}
+		else if(stringStartsWith(argv[argIndex], "--compile-threads="))
+		{
+			const char* numThreadsString = argv[argIndex] + strlen("--compile-threads=");
+			const int numThreads = atoi(numThreadsString);
+			if(numThreads <= 0)
+			{
+				Log::printf(
+					Log::error, "Invalid number of compile threads: %s\n", numThreadsString);
+				return EXIT_FAILURE;
+			}
+
+			compileOptions.numThreads = Uptr(numThreads);
+		}
 		else if(!inputFilename)
 		{
 			inputFilename = argv[argIndex];
@@ -242,7 +258,7 @@ int execCompileCommand(int argc, char** argv)
 	{
 	case OutputFormat::precompiledModule: {
 		// Compile the module to object code.
-		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
+		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec, compileOptions);
 
 		// Extract the compiled object code and add it to the IR module as a user section.
 		irModule.customSections.push_back(CustomSection{
@@ -263,7 +279,7 @@ int execCompileCommand(int argc, char** argv)
 																			: EXIT_FAILURE;
 	}
 	case OutputFormat::object: {
-		// Compile the module to object code.
+		// Compile the module to a single object file in the target's native format.
 		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
 
 		// Write the object code to the output file.
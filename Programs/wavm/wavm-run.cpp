@@ -1,6 +1,7 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -211,6 +212,18 @@ void showRunHelp(Log::Category outputCategory)
 				"  --wasi-trace=<level>  Sets the level of WASI tracing:\n"
 				"                        - syscalls\n"
 				"                        - syscalls-with-callstacks\n"
+				"  --compile-threads=<n> Compile the module's functions on <n> threads\n"
+				"                        (default: 1)\n"
+				"  --tiered              Start running the module with quickly compiled\n"
+				"                        code, and recompile its hot functions with full\n"
+				"                        optimization in the background\n"
+				"  --fuel=<n>            Meter the WebAssembly code's execution, and stop it\n"
+				"                        after it has executed <n> operators\n"
+				"  --profile=<file>      Sample the running code's call stacks, and write them\n"
+				"                        to <file> as collapsed stacks for flame graph tools\n"
+				"  --perf-map=<format>   Describe the compiled code to Linux perf in a file:\n"
+				"                        - map: /tmp/perf-<pid>.map\n"
+				"                        - jitdump: /tmp/jit-<pid>.dump, for perf inject\n"
 				"\n"
 				"ABIs:\n"
 				"%s"
@@ -248,6 +261,9 @@ struct State
 	ABI abi = ABI::detect;
 	bool precompiled = false;
 	WASI::SyscallTraceLevel wasiTraceLavel = WASI::SyscallTraceLevel::none;
+	LLVMJIT::CompileOptions compileOptions;
+	I64 fuel = 0;
+	const char* profileFilename = nullptr;
 
 	// Objects that need to be cleaned up before exiting.
 	GCPointer<Compartment> compartment = createCompartment();
@@ -371,6 +387,60 @@ struct State
 					return false;
 				}
 			}
+			else if(stringStartsWith(*nextArg, "--compile-threads="))
+			{
+				const char* numThreadsString = *nextArg + strlen("--compile-threads=");
+				const int numThreads = atoi(numThreadsString);
+				if(numThreads <= 0)
+				{
+					Log::printf(
+						Log::error, "Invalid number of compile threads: %s\n", numThreadsString);
+					return false;
+				}
+
+				compileOptions.numThreads = Uptr(numThreads);
+			}
+			else if(!strcmp(*nextArg, "--tiered"))
+			{
+				compileOptions.tier = LLVMJIT::CompileTier::baseline;
+			}
+			else if(stringStartsWith(*nextArg, "--fuel="))
+			{
+				const char* fuelString = *nextArg + strlen("--fuel=");
+				fuel = atoll(fuelString);
+				if(fuel <= 0)
+				{
+					Log::printf(Log::error, "Invalid amount of fuel: %s\n", fuelString);
+					return false;
+				}
+
+				compileOptions.meterFuel = true;
+			}
+			else if(stringStartsWith(*nextArg, "--profile="))
+			{
+				profileFilename = *nextArg + strlen("--profile=");
+			}
+			else if(stringStartsWith(*nextArg, "--perf-map="))
+			{
+				const char* formatString = *nextArg + strlen("--perf-map=");
+				LLVMJIT::PerfMapFormat format;
+				if(!strcmp(formatString, "map")) { format = LLVMJIT::PerfMapFormat::perfMap; }
+				else if(!strcmp(formatString, "jitdump"))
+				{
+					format = LLVMJIT::PerfMapFormat::jitdump;
+				}
+				else
+				{
+					Log::printf(Log::error, "Unknown perf map format: %s\n", formatString);
+					return false;
+				}
+
+				if(!LLVMJIT::enablePerfMap(format))
+				{
+					Log::printf(Log::error, "Couldn't create the perf map file.\n");
+					return false;
+				}
+			}
 			else if((*nextArg)[0] != '-')
 			{
 				filename = *nextArg;
@@ -415,6 +485,8 @@ struct State
 		default: WAVM_UNREACHABLE();
 		};
 
+		Runtime::setGlobalCompileOptions(compileOptions);
+
 		const char* objectCachePath
 			= WAVM_SCOPED_DISABLE_SECURE_CRT_WARNINGS(getenv("WAVM_OBJECT_CACHE_DIR"));
 		if(objectCachePath && *objectCachePath)
@@ -450,6 +522,11 @@ struct State
 			codeKey = Hash<U64>()(WAVM_VERSION_MINOR, codeKey);
 			codeKey = Hash<U64>()(WAVM_VERSION_PATCH, codeKey);
 
+			// Fuel-metered code and code that checks epoch deadlines are different from code
+			// compiled without those options for the same module.
+			codeKey = Hash<U64>()(compileOptions.meterFuel, codeKey);
+			codeKey = Hash<U64>()(compileOptions.checkEpochDeadlines, codeKey);
+
 			// Initialize the object cache.
 			std::shared_ptr<Runtime::ObjectCacheInterface> objectCache;
 			ObjectCache::OpenResult openResult
@@ -582,6 +659,7 @@ struct State
 	{
 		// Create a WASM execution context.
 		Context* context = Runtime::createContext(compartment);
+		if(compileOptions.meterFuel) { setContextFuel(context, fuel); }
 
 		// Call the module start function, if it has one.
 		Function* startFunction = getStartFunction(moduleInstance);
@@ -718,6 +796,11 @@ struct State
 		invokeFunction(
 			context, function, invokeSig, untaggedInvokeArgs.data(), untaggedInvokeResults.data());
 		Timing::logTimer("Invoked function", executionTimer);
+		if(compileOptions.meterFuel)
+		{
+			Log::printf(
+				Log::metrics, "Consumed fuel: %" PRIi64 "\n", fuel - getContextFuel(context));
+		}
 
 		if(untaggedInvokeResults.size() == 1 && invokeSig.results()[0] == ValueType::i32)
 		{ return untaggedInvokeResults[0].i32; }
@@ -810,6 +893,13 @@ struct State
 			WASI::setProcessMemory(*wasiProcess, memory);
 		}
 
+		// Start sampling the program's call stacks if a profile was requested.
+		if(profileFilename && !startProfiling())
+		{
+			Log::printf(Log::error, "Profiling isn't supported on this platform.\n");
+			return EXIT_FAILURE;
+		}
+
 		// Execute the program.
 		auto executeThunk = [&] { return execute(irModule, moduleInstance); };
 		int result;
@@ -823,6 +913,8 @@ struct State
 			result = executeThunk();
 		}
 
+		if(profileFilename && !writeProfile()) { return EXIT_FAILURE; }
+
 		// Log the peak memory usage.
 		Uptr peakMemoryUsage = Platform::getPeakMemoryUsageBytes();
 		Log::printf(
@@ -831,6 +923,40 @@ struct State
 		return result;
 	}
 
+	bool writeProfile()
+	{
+		stopProfiling();
+
+		const std::string collapsedStacks = getProfileCollapsedStacks();
+		if(!saveFile(profileFilename, collapsedStacks.data(), collapsedStacks.size()))
+		{ return false; }
+
+		// Log the functions with the most samples, and the operators in them with the most samples.
+		const U64 numSamples = getProfileNumSamples();
+		Log::printf(Log::metrics, "Profile samples: %" PRIu64 "\n", numSamples);
+		const std::vector<ProfiledFunction> profiledFunctions = getProfiledFunctions();
+		for(Uptr functionIndex = 0; functionIndex < profiledFunctions.size() && functionIndex < 10;
+			++functionIndex)
+		{
+			const ProfiledFunction& function = profiledFunctions[functionIndex];
+			Log::printf(Log::metrics,
+						"  %5.1f%% self %5.1f%% total  %s\n",
+						100.0 * F64(function.numSelfSamples) / F64(numSamples),
+						100.0 * F64(function.numTotalSamples) / F64(numSamples),
+						function.debugName.c_str());
+			const Uptr numOpsToLog = std::min(function.opIndexSamples.size(), Uptr(3));
+			for(Uptr opRank = 0; opRank < numOpsToLog; ++opRank)
+			{
+				Log::printf(Log::metrics,
+							"      %5.1f%% at operator %" WAVM_PRIuPTR "\n",
+							100.0 * F64(function.opIndexSamples[opRank].second) / F64(numSamples),
+							function.opIndexSamples[opRank].first);
+			}
+		}
+
+		return true;
+	}
+
 	int runAndCatchRuntimeExceptions(char** argv)
 	{
 		int result = EXIT_FAILURE;
@@ -0,0 +1,17 @@
+;; Tests fuel metering. This script is run with --fuel, which gives its commands a fixed amount of
+;; fuel in total. With --test-cloning, each command also runs in a clone of the test context, which
+;; must start with the fuel the original context has left.
+
+(module
+  (func (export "add") (param i32 i32) (result i32)
+    (i32.add (local.get 0) (local.get 1))
+  )
+
+  (func (export "spin")
+    (loop $loop (br $loop))
+  )
+)
+
+(assert_return (invoke "add" (i32.const 1) (i32.const 2)) (i32.const 3))
+(assert_trap (invoke "spin") "out of fuel")
+(assert_trap (invoke "spin") "out of fuel")